@@ -1,11 +1,9 @@
 #include <vector>
 using namespace std;
 #include "ISA.h"
+#include "isaengine.h"
 #include <stdio.h>
-#include <fcntl.h>
-#include <io.h>
 #include <stdarg.h>
-#include <windows.h>
 #include <time.h>
 #include <errno.h>
 #include <string.h>
@@ -14,7 +12,9 @@ using namespace std;
 /*********************************************************
         Globals signal setup
 *********************************************************/
+#ifdef WITH_DEBUG
 static FILE *logfile = NULL;
+#endif
 const char *modeinfo_names[MODEINFO_MAX] = {
     "MAX_BUS",
     "MAX_GROUP",
@@ -45,6 +45,8 @@ const char *refresh_support[] = { "Disabled", "Enabled", NULL };
 const char *irq_support[] = { "Disabled", "Enabled", NULL };
 const char *timing_mode[] = { "Fast Mode", "Normal Mode", "Slow Mode", "AT Mode", "ISA Mode", NULL };
 const char *error_detection[] = { "Basic", "Advanced", NULL };
+const char *result_ram[] = { "4 MB", "16 MB", "64 MB", "Unlimited", NULL };
+const char *glitch_filter[] = { "Off", "2 Samples", "3 Samples", "4 Samples", "8 Samples", NULL };
 
 const struct modeinfo modeinfo[] = { 
     { "ADDR_WIDTH", addr_width, 0, 2 },
@@ -53,7 +55,62 @@ const struct modeinfo modeinfo[] = {
     { "REFRESH_SUPPORT", refresh_support, 1, 1 },
     { "IRQ_SUPPORT", irq_support, 1, 1 },
     { "TIMING_MODE", timing_mode, 3, 4 },
-    { "ERROR_DETECTION", error_detection, 1, 1 }
+    { "ERROR_DETECTION", error_detection, 1, 1 },
+    { "RESULT_RAM", result_ram, 1, 3 },
+    { "GLITCH_FILTER", glitch_filter, 0, 4 }
+};
+
+// RAM budget of the result store for each RESULT_RAM choice, 0 = no limit
+const size_t result_ram_bytes[] = { 4 << 20, 16 << 20, 64 << 20, 0 };
+
+// Shortest pulse kept for each GLITCH_FILTER choice, 0 = filter off
+const int glitch_filter_width[] = { 0, 2, 3, 4, 8 };
+
+// Channels the decoder tests, by the .tla user group they are wired in
+const TChannelGroupDef channel_groups[] = {
+    { TISALayout::CONTROL_GROUP, "ISA_Control" },
+    { TISALayout::ADDR_GROUP, "ISA_Address" },
+    { TISALayout::DATA_GROUP, "ISA_Data" },
+    { TISALayout::DMA_GROUP, "ISA_DMA" },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ" }
+};
+
+const TChannelDef channels[] = {
+    { TISALayout::CONTROL_GROUP, "ISA_BCLK", ISA_BCLK, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_ALE", ISA_ALE, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_IOR", ISA_IOR, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_IOW", ISA_IOW, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_MEMR", ISA_MEMR, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_MEMW", ISA_MEMW, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_REFRESH", ISA_REFRESH, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_MASTER", ISA_MASTER, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_SBHE", ISA_SBHE, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_IOCHRDY", ISA_IOCHRDY, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_AEN", ISA_AEN, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_IOCHK", ISA_IOCHK, 0 },
+    { TISALayout::CONTROL_GROUP, "ISA_RESET", ISA_RESET, 0 },
+    { TISALayout::ADDR_GROUP, "ISA_ADDR_", ISA_ADDR_MASK, 1 },
+    { TISALayout::DATA_GROUP, "ISA_DATA_", ISA_DATA_MASK, 1 },
+    { TISALayout::DMA_GROUP, "ISA_DACK0", ISA_DACK0, 0 },
+    { TISALayout::DMA_GROUP, "ISA_DACK1", ISA_DACK1, 0 },
+    { TISALayout::DMA_GROUP, "ISA_DACK2", ISA_DACK2, 0 },
+    { TISALayout::DMA_GROUP, "ISA_DACK3", ISA_DACK3, 0 },
+    { TISALayout::DMA_GROUP, "ISA_DACK5", ISA_DACK5, 0 },
+    { TISALayout::DMA_GROUP, "ISA_DACK6", ISA_DACK6, 0 },
+    { TISALayout::DMA_GROUP, "ISA_DACK7", ISA_DACK7, 0 },
+    { TISALayout::DMA_GROUP, "ISA_TC", ISA_TC, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ2", ISA_IRQ2, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ3", ISA_IRQ3, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ4", ISA_IRQ4, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ5", ISA_IRQ5, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ6", ISA_IRQ6, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ7", ISA_IRQ7, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ9", ISA_IRQ9, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ10", ISA_IRQ10, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ11", ISA_IRQ11, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ12", ISA_IRQ12, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ14", ISA_IRQ14, 0 },
+    { TISALayout::IRQ_GROUP, "ISA_IRQ15", ISA_IRQ15, 0 }
 };
 
 // Names for the transaction types (for better readability)
@@ -80,6 +137,7 @@ const char* transaction_names[] = {
 *********************************************************/
 static TISAData ISAData[1];       // Active transaction data
 static TISABusData ISABusData[1]; // Bus state tracking
+static TISACarry ISACarry;        // Signal levels after the last sample decoded
 static int set_addr_width;        // Address width setting
 static int set_bus_speed;         // Bus speed setting
 static int set_dma_support;       // DMA support setting
@@ -87,8 +145,35 @@ static int set_refresh_support;   // Refresh support setting
 static int set_irq_support;       // IRQ support setting
 static int set_timing_mode;       // Timing mode setting
 static int set_error_detection;   // Error detection setting
+static int set_result_ram;        // RAM budget of the result store
+static int set_glitch_filter;     // Minimum pulse width on the control lines
 static int processing_done;
-TVSeqData SeqDataVector;          // Vector with analysis results
+static TPageArena ResultArena;    // Pages of SeqDataVector, from the host's heap
+TSeqDataStore SeqDataVector;      // Paged store with analysis results
+static TRowIndex SeqDataIndex;    // Sequence number -> row in SeqDataVector
+static int CaptureFirst;          // First sample of the capture
+static int ResyncSeq;             // First sample of the trigger-first pass
+static int ResumeSeq;             // First sample the host asked for
+static int EarlyPending;          // Samples before ResyncSeq still to be decoded
+static int EarlyOverrun;          // Early pass is past ResyncSeq, where the late pass has the rows
+static int EarlyRunning;          // Early pass is decoding; its rows are indexed once moved in front
+static int CaptureLast;           // Last sample of the capture
+static int LateDone;              // Last published sample from ResyncSeq on
+static int PublishedRows;         // Rows ParseSeq may look at
+static int RenderAddrWidth;       // Address width the rows were decoded with
+static TThread DecodeThread;      // Background decoder
+static volatile long DecodeCancel; // Ask the decoder to stop at the next chunk
+static int DecodeAborted;         // Decoding stopped by the host's abort request
+static TLock DecodeLock;          // Guards the rows and the published range
+static struct sequence RowSlots[ISA_ROW_SLOTS]; // Rows rendered for the host
+static struct sequence PendingRow; // Placeholder for samples not decoded yet
+static TMarkSet UserMarks;        // Sequences marked by the user
+static TChannelMap ChannelMap;    // Probe wiring read from ISA.tla
+static TSampleMirror SampleMirror; // Compressed copy of the samples read from the host
+static TGlitchFilter GlitchFilter; // Removes short pulses ahead of the state machine
+static TBitPlanes ControlPlanes;  // Control group sliced for the resync search
+static TISAPipeline SamplePipeline; // Blocks fetched ahead of the state machine
+static TCheckpoints<TISACheckpoint> Checkpoints; // Decoder state after each chunk
 
 /*********************************************************
         Helpers
@@ -112,145 +197,551 @@ static void LogDebug(struct pctx *pctx, int level, const char *fmt, ...)
 }
 #endif
 
-// Helper function to get address width in bits based on setting
-static int GetAddressWidthBits()
+// Group values with the channels moved to the ISA.h layout, used in place
+// of the host's LAGroupValue when ISA.tla wires a group differently
+static int MappedGroupValue(struct lactx *lactx, int seqno, int group)
 {
-    switch (set_addr_width)
-    {
-        case 0: return 16;
-        case 1: return 20;
-        case 2: return 24;
-        default: return 16;
-    }
+    return ChannelMap.value(lactx, seqno, group);
 }
 
-// Helper function to get bus clock period in nanoseconds based on setting
-static double GetClockPeriodNS()
+// Group values through the sample mirror, so a re-decode of the same
+// capture does not read them from the host again
+static int MirroredGroupValue(struct lactx *lactx, int seqno, int group)
 {
-    switch (set_bus_speed)
-    {
-        case 0: return 209.64;  // 4.77 MHz = 209.64 ns
-        case 1: return 166.67;  // 6 MHz = 166.67 ns
-        case 2: return 125.0;   // 8 MHz = 125 ns
-        case 3: return 100.0;   // 10 MHz = 100 ns
-        case 4: return 83.33;   // 12 MHz = 83.33 ns
-        default: return 125.0;  // Default to 8 MHz
-    }
+    return (int)SampleMirror.value(lactx, seqno, group);
 }
 
 // Helper function to format address based on address width
-static void FormatAddress(char* buf, size_t buf_size, uint32_t addr)
+static void FormatAddress(TTextOut& text, uint32_t addr, int addr_width)
 {
-    switch (set_addr_width)
+    text.put("0x");
+    switch (addr_width)
     {
         case 0: // 16-bit
-            snprintf(buf, buf_size, "0x%04X", addr & 0xFFFF);
+            text.hex(addr & 0xFFFF, 4);
             break;
         case 1: // 20-bit
-            snprintf(buf, buf_size, "0x%05X", addr & 0xFFFFF);
+            text.hex(addr & 0xFFFFF, 5);
             break;
         case 2: // 24-bit
-            snprintf(buf, buf_size, "0x%06X", addr & 0xFFFFFF);
+            text.hex(addr & 0xFFFFFF, 6);
             break;
         default:
-            snprintf(buf, buf_size, "0x%04X", addr & 0xFFFF);
+            text.hex(addr & 0xFFFF, 4);
             break;
     }
 }
 
-// Helper to check if the given value is active low (normally high)
-static int IsActiveLow(uint32_t signal, uint32_t value)
+// Helper function to create a new sequence data entry. Only the fields are
+// stored; RenderRow produces the text when the host asks for the row.
+static void CreateSequenceEntry(int seq_number, int kind, int trans_type, int error_flag,
+                                uint32_t address, uint16_t data, int count, int detail)
 {
-    return (value & signal) == 0 ? MY_TRUE : MY_FALSE;
+    if (EarlyOverrun && seq_number >= ResyncSeq)
+    {
+        return;
+    }
+    
+    TSeqData SeqData;
+    SeqData.seq_number = seq_number;
+    SeqData.address = address;
+    SeqData.data = data;
+    SeqData.count = (uint16_t)(count > 0xFFFF ? 0xFFFF : count);
+    SeqData.kind = (uint8_t)kind;
+    SeqData.trans_type = (uint8_t)trans_type;
+    SeqData.detail = (uint8_t)detail;
+    
+    // Set flags based on transaction type and error status
+    if (error_flag)
+    {
+        SeqData.flags = 4;  // Red background for errors
+    }
+    else if (trans_type == ISA_TRANS_REFRESH || kind == ISA_ROW_GLITCHES)
+    {
+        SeqData.flags = 2;  // Grey background for refresh cycles and status
+    }
+    else if (trans_type >= ISA_TRANS_DMA_READ_BYTE && trans_type <= ISA_TRANS_DMA_WRITE_WORD)
+    {
+        SeqData.flags = 8;  // Yellow background for DMA
+    }
+    else
+    {
+        SeqData.flags = 1;  // Normal white background
+    }
+    
+    if (!EarlyRunning)
+    {
+        SeqDataIndex.add(seq_number, SeqDataVector.size());
+    }
+    SeqDataVector.push_back(SeqData);
+    
+    LogDebug(NULL, 0, "Created sequence: %d kind %d", seq_number, kind);
 }
 
-// Helper to check if the given value is active high (normally low)
-static int IsActiveHigh(uint32_t signal, uint32_t value)
+// Produce the display text of a row into one of the host row slots
+static void RenderRow(struct sequence *seqinfo, const TSeqData& SeqData)
 {
-    return (value & signal) != 0 ? MY_TRUE : MY_FALSE;
+    memset(seqinfo, 0, sizeof(*seqinfo));
+    TTextOut text(seqinfo->text, sizeof(seqinfo->text));
+    
+    switch (SeqData.kind)
+    {
+        case ISA_ROW_RESET:
+            text.put("SYSTEM RESET");
+            break;
+            
+        case ISA_ROW_TRANSACTION:
+            // Format for 8-bit vs 16-bit data
+            text.put(transaction_names[SeqData.trans_type]).put(" | Addr: ");
+            FormatAddress(text, SeqData.address, RenderAddrWidth);
+            text.put(" | Data: 0x").hex(SeqData.data, Is16BitTransaction(SeqData.trans_type) ? 4 : 2);
+            text.put(" | Wait: ").dec(SeqData.count);
+            break;
+            
+        case ISA_ROW_TIMEOUT:
+            text.put("ERROR: ").put(transaction_names[SeqData.trans_type]);
+            text.put(" transaction timed out | Addr: ");
+            FormatAddress(text, SeqData.address, RenderAddrWidth);
+            text.put(" | Cycles: ").dec(SeqData.count);
+            break;
+            
+        case ISA_ROW_DMA:
+            text.put(transaction_names[SeqData.trans_type]);
+            text.put(" | Channel: ").dec(SeqData.detail & ~ISA_ROW_DMA_TC).put(" | Addr: ");
+            FormatAddress(text, SeqData.address, RenderAddrWidth);
+            text.put(" | Data: 0x").hex(SeqData.data, 4);
+            text.put(" | TC: ").put((SeqData.detail & ISA_ROW_DMA_TC) ? "Yes" : "No");
+            break;
+            
+        case ISA_ROW_REFRESH:
+            text.put("Memory Refresh Cycle | Cycles: ").dec(SeqData.count);
+            break;
+            
+        case ISA_ROW_REFRESH_TIMEOUT:
+            text.put("ERROR: Refresh cycle timed out | Cycles: ").dec(SeqData.count);
+            break;
+            
+        case ISA_ROW_IRQ:
+            text.put("Interrupt Request | IRQ Line: ").dec(SeqData.detail);
+            break;
+            
+        case ISA_ROW_IOCHK:
+            text.put("ERROR: I/O Channel Check (IOCHK#) detected");
+            break;
+            
+        case ISA_ROW_INCOMPLETE:
+            text.put("WARNING: Incomplete ").put(transaction_names[SeqData.trans_type]).put(" | Addr: ");
+            if (SeqData.detail)
+            {
+                FormatAddress(text, SeqData.address, RenderAddrWidth);
+            }
+            else
+            {
+                text.put("Unknown");
+            }
+            text.put(" | State: ").dec(SeqData.count);
+            break;
+            
+        case ISA_ROW_GLITCHES:
+            text.put("Glitch filter: ").udec(SeqData.address).put(" pulses shorter than ");
+            text.dec(SeqData.count).put(" samples removed");
+            break;
+            
+        default:
+            break;
+    }
+    
+    seqinfo->flags = SeqData.flags;
+    seqinfo->textp = seqinfo->text;
+    seqinfo->text2 = seqinfo->text2_buf;
 }
 
-// Helper function to identify active DMA channel from DACKn signals
-static int IdentifyActiveDMAChannel(uint32_t value)
+/*********************************************************
+        ISA decoder
+*********************************************************/
+// Decode one range of samples into sequence rows with the decoder instance
+// for the address width setting
+static void DecodeRange(struct pctx *pctx, int firstseq, int lastseq)
 {
-    if (IsActiveLow(ISA_DACK0, value)) return 0;
-    if (IsActiveLow(ISA_DACK1, value)) return 1;
-    if (IsActiveLow(ISA_DACK2, value)) return 2;
-    if (IsActiveLow(ISA_DACK3, value)) return 3;
-    if (IsActiveLow(ISA_DACK5, value)) return 5;
-    if (IsActiveLow(ISA_DACK6, value)) return 6;
-    if (IsActiveLow(ISA_DACK7, value)) return 7;
-    return -1; // No DMA channel active
+    TISAEngineContext ctx;
+    ctx.pctx = pctx;
+    ctx.capture_first = CaptureFirst;
+    ctx.capture_last = CaptureLast;
+    ctx.cycle = &ISAData[0];
+    ctx.bus = &ISABusData[0];
+    ctx.carry = &ISACarry;
+    ctx.dma_support = set_dma_support;
+    ctx.refresh_support = set_refresh_support;
+    ctx.irq_support = set_irq_support;
+    ctx.error_detection = set_error_detection;
+    ctx.glitch_filter = GlitchFilter.enabled() ? &GlitchFilter : NULL;
+    ctx.pipeline = &SamplePipeline;
+    ctx.add_row = CreateSequenceEntry;
+    
+    switch (set_addr_width)
+    {
+        case 1:
+            TISAEngine<TISALayout, ISA_DECODE_FEATURES | ISA_FEATURE_20BIT_ADDR>::decode(ctx, firstseq, lastseq);
+            break;
+        case 2:
+            TISAEngine<TISALayout, ISA_DECODE_FEATURES | ISA_FEATURE_24BIT_ADDR>::decode(ctx, firstseq, lastseq);
+            break;
+        default:
+            TISAEngine<TISALayout, ISA_DECODE_FEATURES>::decode(ctx, firstseq, lastseq);
+            break;
+    }
+}
+/*********************************************************
+        Trigger-first decoding
+*********************************************************/
+// Return the state machine to idle ahead of a decode pass
+static void ResetDecoder()
+{
+    memset(ISAData, 0, sizeof(ISAData));
+    memset(ISABusData, 0, sizeof(ISABusData));
+    memset(&ISACarry, 0, sizeof(ISACarry));
+    
+    ISAData[0].state = ISA_STATE_IDLE;
+    ISAData[0].transaction_type = ISA_TRANS_NONE;
+    ISAData[0].active_dma_channel = -1;
+    ISAData[0].active_irq_line = -1;
 }
 
-// Helper function to identify active IRQ line from IRQn signals
-static int IdentifyActiveIRQLine(uint32_t value)
+// Settings the decoder state depends on; checkpoints taken with any of them
+// set differently are dropped
+static uint32_t CheckpointKey()
 {
-    if (IsActiveHigh(ISA_IRQ2, value)) return 2;
-    if (IsActiveHigh(ISA_IRQ3, value)) return 3;
-    if (IsActiveHigh(ISA_IRQ4, value)) return 4;
-    if (IsActiveHigh(ISA_IRQ5, value)) return 5;
-    if (IsActiveHigh(ISA_IRQ6, value)) return 6;
-    if (IsActiveHigh(ISA_IRQ7, value)) return 7;
-    if (IsActiveHigh(ISA_IRQ9, value)) return 9;
-    if (IsActiveHigh(ISA_IRQ10, value)) return 10;
-    if (IsActiveHigh(ISA_IRQ11, value)) return 11;
-    if (IsActiveHigh(ISA_IRQ12, value)) return 12;
-    if (IsActiveHigh(ISA_IRQ14, value)) return 14;
-    if (IsActiveHigh(ISA_IRQ15, value)) return 15;
-    return -1; // No IRQ line active
+    return (uint32_t)set_addr_width | ((uint32_t)set_dma_support << 4) | ((uint32_t)set_refresh_support << 8) |
+           ((uint32_t)set_error_detection << 12) | ((uint32_t)set_glitch_filter << 16);
 }
 
-// Helper function to create a new sequence data entry
-static void CreateSequenceEntry(int seq_number, int trans_type, bool error_flag, const char* format, ...)
+// Snapshot of the decoder state before the next sample
+static void SaveCheckpoint(TISACheckpoint& checkpoint)
 {
-    TSeqData SeqData;
-    memset(&SeqData, 0, sizeof(SeqData));
+    checkpoint.cycle = ISAData[0];
+    checkpoint.bus = ISABusData[0];
+    checkpoint.carry = ISACarry;
+    GlitchFilter.save(checkpoint.glitch_out, checkpoint.glitch_dev);
+}
+
+// Put the decoder back into a saved state
+static void ResumeCheckpoint(const TISACheckpoint& checkpoint)
+{
+    ISAData[0] = checkpoint.cycle;
+    ISABusData[0] = checkpoint.bus;
+    ISACarry = checkpoint.carry;
+    if (GlitchFilter.enabled())
+    {
+        GlitchFilter.resume(checkpoint.carry.next_seq, checkpoint.glitch_out, checkpoint.glitch_dev);
+    }
+}
+
+// Find where the trigger-first pass starts: the sample after a command
+// strobe or REFRESH# is released with ALE low, where the state machine has
+// completed a cycle and is back to idle. Returns firstseq when the host
+// reports no trigger or there is no such point near it.
+static int FindResyncPoint(struct pctx *pctx, int firstseq, int lastseq)
+{
+    if (pctx->func.LABusModTrigSample == NULL)
+    {
+        return firstseq;
+    }
+    
+    int trigger = pctx->func.LABusModTrigSample(pctx->lactx, -1);
+    if (trigger <= firstseq || trigger > lastseq)
+    {
+        return firstseq;
+    }
     
-    va_list args;
-    va_start(args, format);
-    vsnprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), format, args);
-    va_end(args);
+    int limit = trigger - ISA_RESYNC_WINDOW;
+    if (limit < firstseq)
+        limit = firstseq;
     
-    // Set flags based on transaction type and error status
-    if (error_flag)
+    // Strobes are active low: all high at seq, at least one low before it.
+    // The window is sliced into bit-planes a block at a time back from the
+    // trigger, so 64 samples are tested at once.
+    ControlPlanes.select(ISA_STROBE_MASK | ISA_ALE);
+    for (int block_last = trigger - 1; block_last > limit; block_last -= BITPLANE_BLOCK)
     {
-        SeqData.seq_data.flags = 4;  // Red background for errors
+        int block_first = block_last - BITPLANE_BLOCK + 1;
+        if (block_first <= limit)
+            block_first = limit + 1;
+        
+        ControlPlanes.load(pctx->func.LAGroupValue, pctx->lactx, 0, block_first, block_last - block_first + 1,
+                           pctx->func.LAGroupValue(pctx->lactx, block_first - 1, 0));
+        for (int w = ControlPlanes.words() - 1; w >= 0; w--)
+        {
+            uint64_t released = ControlPlanes.all(ISA_STROBE_MASK, w) &
+                                ~ControlPlanes.all_before(ISA_STROBE_MASK, w) &
+                                ~ControlPlanes.level(ISA_ALE, w);
+            if (released != 0)
+            {
+                return block_first + w * 64 + TBitPlanes::highest(released) + 1;
+            }
+        }
     }
-    else if (trans_type == ISA_TRANS_REFRESH)
+    return firstseq;
+}
+
+/*********************************************************
+        Background decoding
+*********************************************************/
+// Stop at the next chunk if decoding was cancelled or the host asked to abort
+static int DecodeStopped(struct pctx *pctx)
+{
+    if (DecodeCancel)
     {
-        SeqData.seq_data.flags = 2;  // Grey background for refresh cycles
+        return MY_TRUE;
     }
-    else if (trans_type >= ISA_TRANS_DMA_READ_BYTE && trans_type <= ISA_TRANS_DMA_WRITE_WORD)
+    if (pctx->func.LAProgAbort != NULL && pctx->func.LAProgAbort(pctx->lactx))
     {
-        SeqData.seq_data.flags = 8;  // Yellow background for DMA
+        DecodeAborted = MY_TRUE;
+        return MY_TRUE;
+    }
+    return MY_FALSE;
+}
+
+// Last sample of a decoded chunk whose rows are all in. A transaction still
+// in flight adds its row, at its first sample, only once it completes. One
+// resumed from a checkpoint may have started ahead of the resync point,
+// where the early pass covers it.
+static int PublishLimit(int chunk_last)
+{
+    if (ISAData[0].state != ISA_STATE_IDLE && ISAData[0].sequence <= chunk_last)
+    {
+        return ISAData[0].sequence > ResyncSeq ? ISAData[0].sequence - 1 : ResyncSeq - 1;
+    }
+    return chunk_last;
+}
+
+// Decode a range a chunk at a time, holding the lock only while a chunk is
+// decoded. With publish set, each chunk becomes visible once it is done.
+static int DecodeChunks(struct pctx *pctx, int firstseq, int lastseq, int publish)
+{
+    for (int seq = firstseq; seq <= lastseq; seq += ISA_DECODE_CHUNK)
+    {
+        if (DecodeStopped(pctx))
+        {
+            return MY_FALSE;
+        }
+        
+        int chunk_last = lastseq - seq < ISA_DECODE_CHUNK ? lastseq : seq + ISA_DECODE_CHUNK - 1;
+        DecodeLock.enter();
+        DecodeRange(pctx, seq, chunk_last);
+        if (chunk_last < CaptureLast)
+        {
+            TISACheckpoint checkpoint;
+            SaveCheckpoint(checkpoint);
+            Checkpoints.record(chunk_last + 1, checkpoint);
+        }
+        if (publish)
+        {
+            PublishedRows = SeqDataVector.size();
+            LateDone = PublishLimit(chunk_last);
+        }
+        DecodeLock.leave();
+    }
+    return MY_TRUE;
+}
+
+// Report what the glitch filter removed as a grey row on the last sample,
+// once the whole capture has been through it
+static void AddGlitchSummary()
+{
+    if (GlitchFilter.enabled())
+    {
+        CreateSequenceEntry(CaptureLast, ISA_ROW_GLITCHES, ISA_TRANS_NONE, 0,
+                            (uint32_t)GlitchFilter.removed, 0, GlitchFilter.width(), 0);
+    }
+}
+
+// Warning row for a cycle still open at the end of the capture
+static void AddIncompleteRow(struct pctx *pctx)
+{
+    if (ISAData[0].state != ISA_STATE_IDLE && ISAData[0].transaction_type != ISA_TRANS_NONE)
+    {
+        LogDebug(pctx, 0, "Warning: Incomplete transaction at end of capture");
+        
+        // Create a warning entry for the incomplete transaction
+        CreateSequenceEntry(
+            ISAData[0].sequence,
+            ISA_ROW_INCOMPLETE,
+            ISAData[0].transaction_type,
+            true,
+            ISAData[0].address,
+            0,
+            ISAData[0].state,
+            ISABusData[0].addr_valid ? 1 : 0
+        );
+    }
+}
+
+// Carry the early pass on past the resync point until the cycle open there
+// completes, such as one that times out after its strobe was released. Its
+// row is kept; the rows from the resync point on are the late pass's and
+// are not added again, nor are the glitches counted twice.
+static int FinishEarlyCycle(struct pctx *pctx)
+{
+    unsigned long removed = GlitchFilter.removed;
+    EarlyOverrun = 1;
+    for (int seq = ResyncSeq; seq <= CaptureLast && ISAData[0].state != ISA_STATE_IDLE; seq += BITPLANE_BLOCK)
+    {
+        if (DecodeStopped(pctx))
+        {
+            EarlyOverrun = 0;
+            return MY_FALSE;
+        }
+        
+        int last = CaptureLast - seq < BITPLANE_BLOCK ? CaptureLast : seq + BITPLANE_BLOCK - 1;
+        DecodeLock.enter();
+        DecodeRange(pctx, seq, last);
+        if (last == CaptureLast)
+        {
+            AddIncompleteRow(pctx);
+        }
+        DecodeLock.leave();
+    }
+    GlitchFilter.removed = removed;
+    EarlyOverrun = 0;
+    return MY_TRUE;
+}
+
+// Decode the samples ahead of the resync point and move their rows in
+// front of the ones already published
+static int DecodeEarly(struct pctx *pctx)
+{
+    int late_rows = SeqDataVector.size();
+    ResetDecoder();
+    EarlyRunning = 1;
+    int done = DecodeChunks(pctx, CaptureFirst, ResyncSeq - 1, MY_FALSE) && FinishEarlyCycle(pctx);
+    EarlyRunning = 0;
+    if (!done)
+    {
+        return MY_FALSE;
+    }
+    
+    DecodeLock.enter();
+    SeqDataVector.rotate(late_rows);
+    SeqDataIndex.clear();
+    for (int row = 0; row < (int)SeqDataVector.size(); row++)
+    {
+        SeqDataIndex.add(SeqDataVector[row].seq_number, row);
+    }
+    PublishedRows = SeqDataVector.size();
+    EarlyPending = 0;
+    DecodeLock.leave();
+    
+    LogDebug(pctx, 0, "Early pass: %d sequences before seq %d", SeqDataVector.size() - late_rows, ResyncSeq);
+    return MY_TRUE;
+}
+
+// Worker thread: rows from the resync point on are published a chunk at a
+// time, the early ones in one go once they have been moved in front. A
+// re-decode of the same capture resumes from the checkpoint before the
+// first sample asked for, so the rows there are back first and exact.
+static unsigned THREAD_CALL DecodeWorker(void *arg)
+{
+    struct pctx *pctx = (struct pctx *)arg;
+    
+    int resync;
+    const TISACheckpoint *checkpoint = Checkpoints.nearest(ResumeSeq, resync);
+    if (checkpoint != NULL)
+    {
+        ResumeCheckpoint(*checkpoint);
+        LogDebug(pctx, 0, "Resuming at checkpoint seq %d", resync);
     }
     else
     {
-        SeqData.seq_data.flags = 1;  // Normal white background
+        resync = FindResyncPoint(pctx, CaptureFirst, CaptureLast);
     }
+    DecodeLock.enter();
+    ResyncSeq = resync;
+    LateDone = resync - 1;
+    EarlyPending = resync > CaptureFirst;
+    DecodeLock.leave();
     
-    SeqData.seq_number = seq_number;
-    SeqDataVector.push_back(SeqData);
+    if (!DecodeChunks(pctx, resync, CaptureLast, MY_TRUE))
+    {
+        return 0;
+    }
+    
+    // Final check for any incomplete transactions
+    DecodeLock.enter();
+    AddIncompleteRow(pctx);
+    if (!EarlyPending)
+    {
+        AddGlitchSummary();
+    }
+    PublishedRows = SeqDataVector.size();
+    
+    // The filter's count is complete only after the early pass
+    LateDone = (EarlyPending && GlitchFilter.enabled()) ? CaptureLast - 1 : CaptureLast;
+    DecodeLock.leave();
     
-    LogDebug(NULL, 0, "Created sequence: %s", SeqData.seq_data.text);
+    LogDebug(pctx, 0, "Processing completed - found %d sequences", SeqDataVector.size());
+    
+    if (EarlyPending && DecodeEarly(pctx))
+    {
+        DecodeLock.enter();
+        AddGlitchSummary();
+        PublishedRows = SeqDataVector.size();
+        LateDone = CaptureLast;
+        DecodeLock.leave();
+    }
+    return 0;
 }
 
-// Helper function to determine if a transaction is 16-bit
-static int Is16BitTransaction(int trans_type)
+// Start decoding the whole capture in the background
+static void StartDecode(struct pctx *pctx)
 {
-    switch (trans_type)
+    if (!DecodeThread.start(DecodeWorker, pctx))
     {
-        case ISA_TRANS_IO_READ_WORD:
-        case ISA_TRANS_IO_WRITE_WORD:
-        case ISA_TRANS_MEM_READ_WORD:
-        case ISA_TRANS_MEM_WRITE_WORD:
-        case ISA_TRANS_DMA_READ_WORD:
-        case ISA_TRANS_DMA_WRITE_WORD:
-            return MY_TRUE;
-        default:
-            return MY_FALSE;
+        // No thread available, decode in the caller instead
+        DecodeWorker(pctx);
+    }
+}
+
+// Cancel a running decode and wait for the worker to exit
+static void StopDecode()
+{
+    if (DecodeThread.active())
+    {
+        AtomicExchange(&DecodeCancel, 1);
+        DecodeThread.join();
+        AtomicExchange(&DecodeCancel, 0);
+    }
+}
+
+// First sample of the undecoded range holding seq, or -1 once seq is decoded
+static int PendingRange(int seq)
+{
+    if (seq >= ResyncSeq)
+    {
+        return seq > LateDone ? LateDone + 1 : -1;
+    }
+    return EarlyPending ? CaptureFirst : -1;
+}
+
+/*********************************************************
+        User marks
+*********************************************************/
+// Fingerprint of the capture, so marks survive a re-decode of the same
+// capture but not a new acquisition
+static uint32_t CaptureSignature(struct pctx *pctx, int firstseq, int lastseq)
+{
+    uint32_t hash = 2166136261UL;   // FNV-1a
+    int step = (lastseq - firstseq) / MARKSET_SIGNATURE_SAMPLES + 1;
+    for (int seq = firstseq; seq <= lastseq; seq += step)
+    {
+        uint32_t values[2];
+        values[0] = SampleMirror.fetch(pctx->lactx, seq, 0);
+        values[1] = SampleMirror.fetch(pctx->lactx, seq, 2);
+        for (int byte = 0; byte < 8; byte++)
+        {
+            hash = (hash ^ ((values[byte / 4] >> ((byte % 4) * 8)) & 0xFF)) * 16777619UL;
+        }
     }
+    return hash;
 }
 
 /*********************************************************
@@ -260,7 +751,10 @@ struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *
 {
     // Called upon DLL startup and refreshing the data
     struct pctx *ret;
+    StopDecode();
     SeqDataVector.clear();
+    SeqDataIndex.clear();
+    ResultArena.release();
     processing_done = 0;
     
     // Check if already initialized
@@ -280,6 +774,23 @@ struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *
     ret->func.rda_calloc = func->rda_calloc;
     ret->func.rda_free = func->rda_free;
     ret->func.LAInfo = func->LAInfo;
+    ret->func.LABusModTrigSample = func->LABusModTrigSample;
+    ret->func.LAProgAbort = func->LAProgAbort;
+    ResultArena.attach(func->rda_malloc, func->rda_free);
+    SeqDataVector.set_arena(&ResultArena);
+    SeqDataIndex.set_arena(&ResultArena);
+    
+    // Read the probe wiring once; groups that match ISA.h are read directly
+    char tla_path[512];
+    if (SupportFilePath(tla_path, sizeof(tla_path), func->support_path, func->support_sep,
+                        func->support_name, func->support_ext) &&
+        ChannelMap.load(tla_path, func->LAGroupValue, channel_groups, ARRAY_SIZE(channel_groups),
+                        channels, ARRAY_SIZE(channels)) > 0)
+    {
+        ret->func.LAGroupValue = MappedGroupValue;
+    }
+    SampleMirror.attach(ret->func.LAGroupValue);
+    ret->func.LAGroupValue = MirroredGroupValue;
     
     // default settings
     set_addr_width = 0;         // 16-bit
@@ -289,8 +800,11 @@ struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *
     set_irq_support = 1;        // IRQ enabled
     set_timing_mode = 3;        // AT Mode
     set_error_detection = 1;    // Advanced error detection
+    set_result_ram = 1;         // 16 MB
+    set_glitch_filter = 0;      // Off
     
     SeqDataVector.clear();
+    SeqDataIndex.clear();
     processing_done = 0;
     
     #ifdef WITH_DEBUG
@@ -314,7 +828,14 @@ int ParseExtInfo_(struct pctx *pctx)
 int ParseFinish(struct pctx *pctx)
 {
     LogDebug(pctx, 0, "%s", "ParseFinish");
+    StopDecode();
+    SamplePipeline.close();
     SeqDataVector.clear();
+    SeqDataIndex.clear();
+    ResultArena.release();
+    UserMarks.clear();
+    Checkpoints.clear();
+    SampleMirror.clear();
     
 #ifdef WITH_DEBUG
     if (logfile)
@@ -331,7 +852,6 @@ int ParseFinish(struct pctx *pctx)
 struct sequence *ParseSeq(struct pctx *pctx, int initseq)
 {
     // TSeqData SeqData;        // array to hold the new vector element
-    TVSeqData::iterator it;
     struct sequence *seqinfo = NULL;
     
     if (pctx == NULL)
@@ -342,6 +862,7 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
     
     if (processing_done == 0)
     {
+        StopDecode();
         processing_done = 1;
         
         // Get the sequence range
@@ -350,662 +871,66 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
         LogDebug(pctx, 0, "Processing sequences: initseq=%d, firstseq=%d, lastseq=%d", 
                  initseq, firstseq, lastseq);
         
-        // Initialize ISA data structures
-        memset(ISAData, 0, sizeof(ISAData));
-        memset(ISABusData, 0, sizeof(ISABusData));
-        
-        ISAData[0].state = ISA_STATE_IDLE;
-        ISAData[0].transaction_type = ISA_TRANS_NONE;
-        ISAData[0].active_dma_channel = -1;
-        ISAData[0].active_irq_line = -1;
-        
-        // Previous signal states for edge detection
-        uint32_t prev_ctrl_signals = 0;
-        uint32_t prev_dma_signals = 0;
-        uint32_t prev_irq_signals = 0;
-        uint32_t prev_address = 0;
-        uint32_t prev_data = 0;
-        
-        int bclk_cycles = 0; // Counter for BCLK cycles
-        
-        // Now loop through all the samples
-        for (int seq = firstseq; seq <= lastseq; seq++)
+        // Keep the user marks if this is the capture they were set on, the
+        // mirrored samples if they still match the host, and the checkpoints
+        // if the decoder state is also the same
+        uint32_t signature = CaptureSignature(pctx, firstseq, lastseq);
+        UserMarks.bind(firstseq, lastseq, signature);
+        if (!SampleMirror.bind(pctx->lactx, firstseq, lastseq, signature))
         {
-            // Get signal values for each group
-            uint32_t ctrl_signals = pctx->func.LAGroupValue(pctx->lactx, seq, 0); // Control signals
-            uint32_t address = pctx->func.LAGroupValue(pctx->lactx, seq, 1);      // Address bus
-            uint16_t data = pctx->func.LAGroupValue(pctx->lactx, seq, 2);         // Data bus
-            uint32_t dma_signals = pctx->func.LAGroupValue(pctx->lactx, seq, 3);  // DMA signals
-            uint32_t irq_signals = pctx->func.LAGroupValue(pctx->lactx, seq, 4);  // IRQ signals
-            
-            LogDebug(pctx, 5, "Seq: %d, Ctrl: 0x%08X, Addr: 0x%08X, Data: 0x%04X, DMA: 0x%08X, IRQ: 0x%08X", 
-                     seq, ctrl_signals, address, data, dma_signals, irq_signals);
-            
-            // Decode control signals
-            bool bclk = IsActiveHigh(ISA_BCLK, ctrl_signals) ? true : false;
-            bool ale = IsActiveHigh(ISA_ALE, ctrl_signals) ? true : false;
-            bool ior = IsActiveLow(ISA_IOR, ctrl_signals) ? true : false;
-            bool iow = IsActiveLow(ISA_IOW, ctrl_signals) ? true : false;
-            bool memr = IsActiveLow(ISA_MEMR, ctrl_signals) ? true : false;
-            bool memw = IsActiveLow(ISA_MEMW, ctrl_signals) ? true : false;
-            bool refresh = IsActiveLow(ISA_REFRESH, ctrl_signals) ? true : false;
-            bool master = IsActiveLow(ISA_MASTER, ctrl_signals) ? true : false;
-            bool sbhe = IsActiveLow(ISA_SBHE, ctrl_signals) ? true : false;
-            bool iochrdy = IsActiveHigh(ISA_IOCHRDY, ctrl_signals) ? true : false;
-            bool aen = IsActiveHigh(ISA_AEN, ctrl_signals) ? true : false;
-            bool iochk = IsActiveLow(ISA_IOCHK, ctrl_signals) ? true : false;
-            bool reset = IsActiveHigh(ISA_RESET, ctrl_signals) ? true : false;
-            
-            // Decode DMA signals
-            bool tc = IsActiveHigh(ISA_TC, dma_signals) ? true : false;
-            int active_dma_channel = IdentifyActiveDMAChannel(dma_signals);
-            
-            // Decode IRQ signals
-            int active_irq_line = IdentifyActiveIRQLine(irq_signals);
-            
-            // Edge detection
-            bool bclk_rising_edge = bclk && !IsActiveHigh(ISA_BCLK, prev_ctrl_signals);
-            bool bclk_falling_edge = !bclk && IsActiveHigh(ISA_BCLK, prev_ctrl_signals);
-            bool ale_rising_edge = ale && !IsActiveHigh(ISA_ALE, prev_ctrl_signals);
-            bool ale_falling_edge = !ale && IsActiveHigh(ISA_ALE, prev_ctrl_signals);
-            
-            bool ior_falling_edge = ior && !IsActiveLow(ISA_IOR, prev_ctrl_signals);
-            bool iow_falling_edge = iow && !IsActiveLow(ISA_IOW, prev_ctrl_signals);
-            bool memr_falling_edge = memr && !IsActiveLow(ISA_MEMR, prev_ctrl_signals);
-            bool memw_falling_edge = memw && !IsActiveLow(ISA_MEMW, prev_ctrl_signals);
-            bool refresh_falling_edge = refresh && !IsActiveLow(ISA_REFRESH, prev_ctrl_signals);
-            
-            bool ior_rising_edge = !ior && IsActiveLow(ISA_IOR, prev_ctrl_signals);
-            bool iow_rising_edge = !iow && IsActiveLow(ISA_IOW, prev_ctrl_signals);
-            bool memr_rising_edge = !memr && IsActiveLow(ISA_MEMR, prev_ctrl_signals);
-            bool memw_rising_edge = !memw && IsActiveLow(ISA_MEMW, prev_ctrl_signals);
-            bool refresh_rising_edge = !refresh && IsActiveLow(ISA_REFRESH, prev_ctrl_signals);
-            
-            // Track BCLK cycles
-            if (bclk_rising_edge)
-            {
-                bclk_cycles++;
-                LogDebug(pctx, 7, "BCLK Rising Edge: cycle %d", bclk_cycles);
-            }
-            
-            // ISA bus state machine
-            switch (ISAData[0].state)
-            {
-                case ISA_STATE_IDLE:
-                    if (reset)
-                    {
-                        // System reset detected
-                        LogDebug(pctx, 0, "SYSTEM RESET detected");
-                        CreateSequenceEntry(seq, ISA_TRANS_NONE, false, "SYSTEM RESET");
-                        continue; // Skip further processing during reset
-                    }
-                    
-                    // Initialize transaction data
-                    if (ale_rising_edge || ior_falling_edge || iow_falling_edge || 
-                        memr_falling_edge || memw_falling_edge || refresh_falling_edge)
-                    {
-                        LogDebug(pctx, 1, "Starting new transaction");
-                        
-                        // Initialize new transaction
-                        ISAData[0].sequence = seq;
-                        ISAData[0].last_sequence = seq;
-                        ISAData[0].state = ISA_STATE_T1;
-                        ISAData[0].wait_states = 0;
-                        ISAData[0].bus_timing_cycles = 0;
-                        ISAData[0].is_16bit = sbhe;
-                        ISAData[0].start_time_ps = 0; // Would use timestamp here if available
-                        ISAData[0].timed_out = false;
-                        ISAData[0].protocol_error = false;
-                        
-                        // Track active command signals
-                        ISAData[0].ior_active = ior;
-                        ISAData[0].iow_active = iow;
-                        ISAData[0].memr_active = memr;
-                        ISAData[0].memw_active = memw;
-                        ISAData[0].refresh_active = refresh;
-                        ISAData[0].master_active = master;
-                        ISAData[0].sbhe_active = sbhe;
-                        ISAData[0].iochrdy_active = iochrdy;
-                        ISAData[0].aen_active = aen;
-                        
-                        // Capture address (first part from address lines)
-                        ISABusData[0].addr_latch_state = 1;
-                        ISABusData[0].partial_addr = address & ISA_ADDR_MASK;
-                        ISABusData[0].addr_valid = false;
-                        ISABusData[0].data_valid = false;
-                        
-                        // Determine if this is a DMA cycle
-                        if (active_dma_channel != -1 && set_dma_support)
-                        {
-                            ISAData[0].state = ISA_STATE_DMA_ACTIVE;
-                            ISAData[0].active_dma_channel = active_dma_channel;
-                            ISAData[0].tc_active = tc;
-                            LogDebug(pctx, 1, "DMA cycle for channel %d detected", active_dma_channel);
-                        }
-                        // Check for refresh cycle
-                        else if (refresh && set_refresh_support)
-                        {
-                            ISAData[0].state = ISA_STATE_REFRESH;
-                            ISAData[0].transaction_type = ISA_TRANS_REFRESH;
-                            LogDebug(pctx, 1, "Memory refresh cycle detected");
-                        }
-                        // Normal bus cycle
-                        else
-                        {
-                            // Determine the transaction type
-                            if (ior)
-                            {
-                                ISAData[0].transaction_type = sbhe ? ISA_TRANS_IO_READ_WORD : ISA_TRANS_IO_READ_BYTE;
-                                ISAData[0].use_io_space = true;
-                                LogDebug(pctx, 1, "I/O Read (%d-bit) transaction started", sbhe ? 16 : 8);
-                            }
-                            else if (iow)
-                            {
-                                ISAData[0].transaction_type = sbhe ? ISA_TRANS_IO_WRITE_WORD : ISA_TRANS_IO_WRITE_BYTE;
-                                ISAData[0].use_io_space = true;
-                                LogDebug(pctx, 1, "I/O Write (%d-bit) transaction started", sbhe ? 16 : 8);
-                            }
-                            else if (memr)
-                            {
-                                ISAData[0].transaction_type = sbhe ? ISA_TRANS_MEM_READ_WORD : ISA_TRANS_MEM_READ_BYTE;
-                                ISAData[0].use_io_space = false;
-                                LogDebug(pctx, 1, "Memory Read (%d-bit) transaction started", sbhe ? 16 : 8);
-                            }
-                            else if (memw)
-                            {
-                                ISAData[0].transaction_type = sbhe ? ISA_TRANS_MEM_WRITE_WORD : ISA_TRANS_MEM_WRITE_BYTE;
-                                ISAData[0].use_io_space = false;
-                                LogDebug(pctx, 1, "Memory Write (%d-bit) transaction started", sbhe ? 16 : 8);
-                            }
-                            else
-                            {
-                                // No command line active - could be address latch only
-                                ISAData[0].transaction_type = ISA_TRANS_NONE;
-                                LogDebug(pctx, 1, "Address latch or unknown transaction");
-                            }
-                        }
-                    }
-                    break;
-                    
-                case ISA_STATE_T1:
-                    // T1 state - Address phase
-                    if (ale_falling_edge)
-                    {
-                        // Address latch complete on falling edge of ALE
-                        ISABusData[0].addr_latch_state = 2;
-                        ISABusData[0].latched_addr = ISABusData[0].partial_addr;
-                        ISABusData[0].addr_valid = true;
-                        ISAData[0].address = ISABusData[0].latched_addr & ((1 << GetAddressWidthBits()) - 1);
-                        LogDebug(pctx, 2, "Address latched: 0x%08X", ISAData[0].address);
-                    }
-                    
-                    // Check for command signals (normally asserted in T1 state)
-                    if (ior_falling_edge || iow_falling_edge || memr_falling_edge || memw_falling_edge)
-                    {
-                        // Update transaction type if it wasn't determined yet
-                        if (ISAData[0].transaction_type == ISA_TRANS_NONE)
-                        {
-                            if (ior_falling_edge)
-                            {
-                                ISAData[0].transaction_type = sbhe ? ISA_TRANS_IO_READ_WORD : ISA_TRANS_IO_READ_BYTE;
-                                ISAData[0].use_io_space = true;
-                            }
-                            else if (iow_falling_edge)
-                            {
-                                ISAData[0].transaction_type = sbhe ? ISA_TRANS_IO_WRITE_WORD : ISA_TRANS_IO_WRITE_BYTE;
-                                ISAData[0].use_io_space = true;
-                            }
-                            else if (memr_falling_edge)
-                            {
-                                ISAData[0].transaction_type = sbhe ? ISA_TRANS_MEM_READ_WORD : ISA_TRANS_MEM_READ_BYTE;
-                                ISAData[0].use_io_space = false;
-                            }
-                            else if (memw_falling_edge)
-                            {
-                                ISAData[0].transaction_type = sbhe ? ISA_TRANS_MEM_WRITE_WORD : ISA_TRANS_MEM_WRITE_BYTE;
-                                ISAData[0].use_io_space = false;
-                            }
-                            
-                            LogDebug(pctx, 2, "Transaction type updated to %s", 
-                                     transaction_names[ISAData[0].transaction_type]);
-                        }
-                    }
-                    
-                    // Move to T2 state on the next BCLK rising edge
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].state = ISA_STATE_T2;
-                        ISAData[0].bus_timing_cycles++;
-                        LogDebug(pctx, 2, "Advancing to T2 state");
-                    }
-                    break;
-                    
-                case ISA_STATE_T2:
-                    // T2 state - Data phase
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].bus_timing_cycles++;
-                        
-                        // Check for IOCHRDY (wait state insertion)
-                        if (!iochrdy)
-                        {
-                            ISAData[0].state = ISA_STATE_TW;
-                            LogDebug(pctx, 2, "Wait state inserted (IOCHRDY inactive)");
-                        }
-                        else
-                        {
-                            // Capture data on rising edge of T2 for write operations
-                            if (ISAData[0].transaction_type == ISA_TRANS_IO_WRITE_BYTE ||
-                                ISAData[0].transaction_type == ISA_TRANS_IO_WRITE_WORD ||
-                                ISAData[0].transaction_type == ISA_TRANS_MEM_WRITE_BYTE ||
-                                ISAData[0].transaction_type == ISA_TRANS_MEM_WRITE_WORD)
-                            {
-                                // For write operations, data should be valid during T2
-                                ISABusData[0].data = data;
-                                ISABusData[0].data_valid = true;
-                                ISAData[0].data = data;
-                                LogDebug(pctx, 2, "Data captured for write operation: 0x%04X", data);
-                            }
-                            
-                            // Move to T3 state
-                            ISAData[0].state = ISA_STATE_T3;
-                            LogDebug(pctx, 2, "Advancing to T3 state");
-                        }
-                    }
-                    
-                    // For read operations, check data availability
-                    if ((ISAData[0].transaction_type == ISA_TRANS_IO_READ_BYTE ||
-                         ISAData[0].transaction_type == ISA_TRANS_IO_READ_WORD ||
-                         ISAData[0].transaction_type == ISA_TRANS_MEM_READ_BYTE ||
-                         ISAData[0].transaction_type == ISA_TRANS_MEM_READ_WORD) && 
-                        data != prev_data)
-                    {
-                        // Data changed, might be target providing data
-                        ISABusData[0].pending_data = data;
-                        LogDebug(pctx, 5, "Potential data seen: 0x%04X", data);
-                    }
-                    break;
-                    
-                case ISA_STATE_TW:
-                    // TW state - Wait states
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].bus_timing_cycles++;
-                        ISAData[0].wait_states++;
-                        
-                        // Check if wait state is released
-                        if (iochrdy)
-                        {
-                            ISAData[0].state = ISA_STATE_T3;
-                            LogDebug(pctx, 2, "Wait state released, advancing to T3 (total wait states: %d)", 
-                                     ISAData[0].wait_states);
-                        }
-                        else
-                        {
-                            LogDebug(pctx, 5, "Still in wait state (%d)", ISAData[0].wait_states);
-                        }
-                    }
-                    
-                    // Check for timeout condition
-                    if (ISAData[0].wait_states > 20 && set_error_detection)
-                    {
-                        ISAData[0].timed_out = true;
-                        ISAData[0].protocol_error = true;
-                        snprintf(ISAData[0].error_message, sizeof(ISAData[0].error_message), 
-                                 "Excessive wait states (%d) - possible timeout", ISAData[0].wait_states);
-                        LogDebug(pctx, 0, "ERROR: %s", ISAData[0].error_message);
-                        
-                        // Force to T3 to complete transaction
-                        ISAData[0].state = ISA_STATE_T3;
-                    }
-                    break;
-                    
-                case ISA_STATE_T3:
-                    // T3 state - Completion phase
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].bus_timing_cycles++;
-                        
-                        // For read operations, data should be valid during T3
-                        if ((ISAData[0].transaction_type == ISA_TRANS_IO_READ_BYTE ||
-                             ISAData[0].transaction_type == ISA_TRANS_IO_READ_WORD ||
-                             ISAData[0].transaction_type == ISA_TRANS_MEM_READ_BYTE ||
-                             ISAData[0].transaction_type == ISA_TRANS_MEM_READ_WORD) && 
-                            !ISABusData[0].data_valid)
-                        {
-                            ISABusData[0].data = data;
-                            ISABusData[0].data_valid = true;
-                            ISAData[0].data = data;
-                            LogDebug(pctx, 2, "Data captured for read operation: 0x%04X", data);
-                        }
-                    }
-                    
-                    // Check for command signal deassertion to mark the end of transaction
-                    if (ior_rising_edge || iow_rising_edge || memr_rising_edge || memw_rising_edge)
-                    {
-                        // Command signals deasserted, transaction is complete
-                        ISAData[0].last_sequence = seq;
-                        ISAData[0].end_time_ps = 0; // Would use timestamp here if available
-                        
-                        // Create sequence entry for the transaction
-                        char addr_str[20];
-                        FormatAddress(addr_str, sizeof(addr_str), ISAData[0].address);
-                        
-                        // Format for 8-bit vs 16-bit data
-                        if (Is16BitTransaction(ISAData[0].transaction_type))
-                        {
-                            // 16-bit transaction
-                            CreateSequenceEntry(
-                                ISAData[0].sequence,
-                                ISAData[0].transaction_type,
-                                ISAData[0].protocol_error,
-                                "%s | Addr: %s | Data: 0x%04X | Wait: %d",
-                                transaction_names[ISAData[0].transaction_type],
-                                addr_str,
-                                ISABusData[0].data_valid ? ISAData[0].data : 0xFFFF,
-                                ISAData[0].wait_states
-                            );
-                        }
-                        else
-                        {
-                            // 8-bit transaction
-                            CreateSequenceEntry(
-                                ISAData[0].sequence,
-                                ISAData[0].transaction_type,
-                                ISAData[0].protocol_error,
-                                "%s | Addr: %s | Data: 0x%02X | Wait: %d",
-                                transaction_names[ISAData[0].transaction_type],
-                                addr_str,
-                                ISABusData[0].data_valid ? (ISAData[0].data & 0xFF) : 0xFF,
-                                ISAData[0].wait_states
-                            );
-                        }
-                        
-                        // Reset for next transaction
-                        ISAData[0].state = ISA_STATE_IDLE;
-                        ISAData[0].transaction_type = ISA_TRANS_NONE;
-                        LogDebug(pctx, 1, "Transaction completed");
-                    }
-                    
-                    // Check for timeout (if commands stay asserted for too long)
-                    if (ISAData[0].bus_timing_cycles > 10 && set_error_detection)
-                    {
-                        ISAData[0].timed_out = true;
-                        ISAData[0].protocol_error = true;
-                        snprintf(ISAData[0].error_message, sizeof(ISAData[0].error_message), 
-                                 "Command signals remain asserted too long - possible timeout");
-                        LogDebug(pctx, 0, "ERROR: %s", ISAData[0].error_message);
-                        
-                        // Create an error entry and reset state machine
-                        char addr_str[20];
-                        FormatAddress(addr_str, sizeof(addr_str), ISAData[0].address);
-                        
-                        CreateSequenceEntry(
-                            ISAData[0].sequence,
-                            ISA_TRANS_ERROR,
-                            true,
-                            "ERROR: %s transaction timed out | Addr: %s | Cycles: %d",
-                            transaction_names[ISAData[0].transaction_type],
-                            addr_str,
-                            ISAData[0].bus_timing_cycles
-                        );
-                        
-                        // Reset for next transaction
-                        ISAData[0].state = ISA_STATE_IDLE;
-                        ISAData[0].transaction_type = ISA_TRANS_NONE;
-                    }
-                    break;
-                    
-                case ISA_STATE_DMA_ACTIVE:
-                    // DMA cycle processing
-                    if (active_dma_channel != ISAData[0].active_dma_channel)
-                    {
-                        // DMA channel changed or deactivated
-                        if (ISAData[0].active_dma_channel != -1)
-                        {
-                            // Complete previous DMA transaction
-                            LogDebug(pctx, 1, "DMA channel %d cycle completed", ISAData[0].active_dma_channel);
-                            
-                            // Create sequence entry for DMA cycle
-                            char addr_str[20];
-                            FormatAddress(addr_str, sizeof(addr_str), ISAData[0].address);
-                            
-                            // Determine DMA transaction type
-                            if (ISAData[0].transaction_type == ISA_TRANS_NONE)
-                            {
-                                if (ISAData[0].memr_active)
-                                    ISAData[0].transaction_type = ISAData[0].is_16bit ? ISA_TRANS_DMA_READ_WORD : ISA_TRANS_DMA_READ_BYTE;
-                                else if (ISAData[0].memw_active)
-                                    ISAData[0].transaction_type = ISAData[0].is_16bit ? ISA_TRANS_DMA_WRITE_WORD : ISA_TRANS_DMA_WRITE_BYTE;
-                                else if (ISAData[0].ior_active)
-                                    ISAData[0].transaction_type = ISAData[0].is_16bit ? ISA_TRANS_DMA_READ_WORD : ISA_TRANS_DMA_READ_BYTE;
-                                else if (ISAData[0].iow_active)
-                                    ISAData[0].transaction_type = ISAData[0].is_16bit ? ISA_TRANS_DMA_WRITE_WORD : ISA_TRANS_DMA_WRITE_BYTE;
-                            }
-                            
-                            CreateSequenceEntry(
-                                ISAData[0].sequence,
-                                ISAData[0].transaction_type,
-                                ISAData[0].protocol_error,
-                                "%s | Channel: %d | Addr: %s | Data: 0x%04X | TC: %s",
-                                transaction_names[ISAData[0].transaction_type],
-                                ISAData[0].active_dma_channel,
-                                addr_str,
-                                ISABusData[0].data_valid ? ISAData[0].data : 0xFFFF,
-                                ISAData[0].tc_active ? "Yes" : "No"
-                            );
-                            
-                            // Reset for next transaction
-                            ISAData[0].state = ISA_STATE_IDLE;
-                            ISAData[0].transaction_type = ISA_TRANS_NONE;
-                            ISAData[0].active_dma_channel = -1;
-                        }
-                        
-                        // Start new DMA transaction if applicable
-                        if (active_dma_channel != -1)
-                        {
-                            ISAData[0].sequence = seq;
-                            ISAData[0].active_dma_channel = active_dma_channel;
-                            ISAData[0].tc_active = tc;
-                            LogDebug(pctx, 1, "New DMA channel %d cycle started", active_dma_channel);
-                        }
-                    }
-                    
-                    // Process DMA read/write operations
-                    if (ISAData[0].active_dma_channel != -1)
-                    {
-                        // Monitor command signals for DMA access type
-                        if (ior && !ISAData[0].ior_active)
-                        {
-                            ISAData[0].ior_active = true;
-                            LogDebug(pctx, 2, "DMA I/O Read active");
-                        }
-                        if (iow && !ISAData[0].iow_active)
-                        {
-                            ISAData[0].iow_active = true;
-                            LogDebug(pctx, 2, "DMA I/O Write active");
-                        }
-                        if (memr && !ISAData[0].memr_active)
-                        {
-                            ISAData[0].memr_active = true;
-                            LogDebug(pctx, 2, "DMA Memory Read active");
-                        }
-                        if (memw && !ISAData[0].memw_active)
-                        {
-                            ISAData[0].memw_active = true;
-                            LogDebug(pctx, 2, "DMA Memory Write active");
-                        }
-                        
-                        // Capture DMA address and data
-                        if (!ISABusData[0].addr_valid && address != prev_address)
-                        {
-                            ISAData[0].address = address & ISA_ADDR_MASK & ((1 << GetAddressWidthBits()) - 1);
-                            ISABusData[0].addr_valid = true;
-                            LogDebug(pctx, 2, "DMA Address captured: 0x%08X", ISAData[0].address);
-                        }
-                        
-                        if (!ISABusData[0].data_valid && data != prev_data)
-                        {
-                            ISAData[0].data = data;
-                            ISABusData[0].data_valid = true;
-                            LogDebug(pctx, 2, "DMA Data captured: 0x%04X", data);
-                        }
-                        
-                        // Check for Terminal Count to end DMA transfer
-                        if (tc && !ISAData[0].tc_active)
-                        {
-                            ISAData[0].tc_active = true;
-                            LogDebug(pctx, 1, "DMA Terminal Count asserted");
-                        }
-                    }
-                    break;
-                    
-                case ISA_STATE_REFRESH:
-                    // Memory refresh cycle
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].bus_timing_cycles++;
-                    }
-                    
-                    // Check for refresh signal deassertion to mark the end
-                    if (refresh_rising_edge)
-                    {
-                        ISAData[0].last_sequence = seq;
-                        
-                        // Create sequence entry for refresh cycle
-                        CreateSequenceEntry(
-                            ISAData[0].sequence,
-                            ISA_TRANS_REFRESH,
-                            false,
-                            "Memory Refresh Cycle | Cycles: %d",
-                            ISAData[0].bus_timing_cycles
-                        );
-                        
-                        // Reset for next transaction
-                        ISAData[0].state = ISA_STATE_IDLE;
-                        ISAData[0].transaction_type = ISA_TRANS_NONE;
-                        LogDebug(pctx, 1, "Refresh cycle completed");
-                    }
-                    
-                    // Check for timeout
-                    if (ISAData[0].bus_timing_cycles > 10 && set_error_detection)
-                    {
-                        ISAData[0].timed_out = true;
-                        ISAData[0].protocol_error = true;
-                        snprintf(ISAData[0].error_message, sizeof(ISAData[0].error_message), 
-                                 "Refresh cycle too long - possible timeout");
-                        LogDebug(pctx, 0, "ERROR: %s", ISAData[0].error_message);
-                        
-                        // Create an error entry and reset state machine
-                        CreateSequenceEntry(
-                            ISAData[0].sequence,
-                            ISA_TRANS_ERROR,
-                            true,
-                            "ERROR: Refresh cycle timed out | Cycles: %d",
-                            ISAData[0].bus_timing_cycles
-                        );
-                        
-                        // Reset for next transaction
-                        ISAData[0].state = ISA_STATE_IDLE;
-                        ISAData[0].transaction_type = ISA_TRANS_NONE;
-                    }
-                    break;
-            }
-            
-            // Check for interrupt activity (can happen in any state)
-            if (active_irq_line != ISAData[0].active_irq_line && set_irq_support)
-            {
-                if (active_irq_line != -1 && ISAData[0].active_irq_line == -1)
-                {
-                    // New interrupt detected
-                    LogDebug(pctx, 1, "Interrupt line %d activated", active_irq_line);
-                    
-                    // Create sequence entry for interrupt
-                    CreateSequenceEntry(
-                        seq,
-                        ISA_TRANS_NONE,
-                        false,
-                        "Interrupt Request | IRQ Line: %d",
-                        active_irq_line
-                    );
-                }
-                else if (active_irq_line == -1 && ISAData[0].active_irq_line != -1)
-                {
-                    // Interrupt cleared
-                    LogDebug(pctx, 1, "Interrupt line %d cleared", ISAData[0].active_irq_line);
-                }
-                
-                ISAData[0].active_irq_line = active_irq_line;
-            }
-            
-            // Check for IOCHK errors
-            if (iochk && !IsActiveLow(ISA_IOCHK, prev_ctrl_signals) && set_error_detection)
-            {
-                LogDebug(pctx, 0, "I/O Channel Check Error (IOCHK#) detected");
-                
-                // Create sequence entry for IOCHK error
-                CreateSequenceEntry(
-                    seq,
-                    ISA_TRANS_ERROR,
-                    true,
-                    "ERROR: I/O Channel Check (IOCHK#) detected"
-                );
-            }
-            
-            // Save previous signal states for edge detection in next iteration
-            prev_ctrl_signals = ctrl_signals;
-            prev_dma_signals = dma_signals;
-            prev_irq_signals = irq_signals;
-            prev_address = address;
-            prev_data = data;
+            Checkpoints.clear();
         }
+        Checkpoints.bind(firstseq, lastseq, signature, CheckpointKey());
         
-        // Final check for any incomplete transactions
-        if (ISAData[0].state != ISA_STATE_IDLE && ISAData[0].transaction_type != ISA_TRANS_NONE)
-        {
-            LogDebug(pctx, 0, "Warning: Incomplete transaction at end of capture");
-            
-            // Create a warning entry for the incomplete transaction
-            char addr_str[20] = "Unknown";
-            if (ISABusData[0].addr_valid)
-            {
-                FormatAddress(addr_str, sizeof(addr_str), ISAData[0].address);
-            }
-            
-            CreateSequenceEntry(
-                ISAData[0].sequence,
-                ISAData[0].transaction_type,
-                true,
-                "WARNING: Incomplete %s | Addr: %s | State: %d",
-                transaction_names[ISAData[0].transaction_type],
-                addr_str,
-                ISAData[0].state
-            );
-        }
+        // Initialize ISA data structures
+        ResetDecoder();
+        SeqDataVector.clear();
+        SeqDataIndex.clear();
+        memset(RowSlots, 0, sizeof(RowSlots));
         
-        // Sort out the text pointers
-        it = SeqDataVector.begin();
-        while (it != SeqDataVector.end())
-        {
-            it->seq_data.textp = it->seq_data.text;
-            it->seq_data.text2 = it->seq_data.text2_buf;
-            it++;
-        }
+        // Rows take two thirds of the RAM budget and their index the rest,
+        // as a row is twice the size of its key
+        SeqDataVector.set_budget(result_ram_bytes[set_result_ram] / 3 * 2);
+        SeqDataIndex.set_budget(result_ram_bytes[set_result_ram] / 3);
+        RenderAddrWidth = set_addr_width;
+        GlitchFilter.configure(glitch_filter_width[set_glitch_filter], ISA_GLITCH_LINES);
         
-        LogDebug(pctx, 0, "Processing completed - found %d sequences", SeqDataVector.size());
+        // Nothing is published until the worker has found the resync point
+        CaptureFirst = firstseq;
+        CaptureLast = lastseq;
+        ResyncSeq = firstseq;
+        ResumeSeq = initseq;
+        LateDone = firstseq - 1;
+        PublishedRows = 0;
+        EarlyPending = 0;
+        DecodeAborted = 0;
+        StartDecode(pctx);
     }
     
-    // Find the requested sequence
-    it = SeqDataVector.begin();
-    while ((it != SeqDataVector.end()) && (seqinfo == NULL))
+    DecodeLock.enter();
+    if (PendingRange(initseq) >= 0)
     {
-        if (it->seq_number == initseq)
+        // Every sample not decoded yet reads as the placeholder, so the
+        // host asks again for each of them when it next draws the rows
+        memset(&PendingRow, 0, sizeof(PendingRow));
+        snprintf(PendingRow.text, sizeof(PendingRow.text), DecodeAborted ? "Decode aborted" : "Decoding...");
+        PendingRow.textp = PendingRow.text;
+        PendingRow.text2 = PendingRow.text2_buf;
+        PendingRow.flags = 2;  // Grey background for status
+        seqinfo = &PendingRow;
+    }
+    else
+    {
+        // Find the requested sequence and render it into a host row slot
+        int row = SeqDataIndex.find(initseq);
+        if (row >= 0 && row < PublishedRows)
         {
-            seqinfo = &(it->seq_data);
+            seqinfo = &RowSlots[initseq & (ISA_ROW_SLOTS - 1)];
+            RenderRow(seqinfo, SeqDataVector[row]);
             LogDebug(pctx, 9, "%s: seq: %d text: [%s]", "*ParseSeq", initseq, seqinfo->textp);
         }
-        it++;
     }
+    DecodeLock.leave();
     
     return seqinfo;
 }
@@ -1014,32 +939,50 @@ int ParseMarkNext(struct pctx *pctx, int seq, int a3)
 {
     LogDebug(pctx, 9, "%s: sequence %d, a3 %d", "ParseMarkNext", seq, a3);
     
-    // Find the next marked sequence
-    if (SeqDataVector.size() == 0)
-        return seq;
-    
-    TVSeqData::iterator it = SeqDataVector.begin();
-    while (it != SeqDataVector.end())
+    DecodeLock.enter();
+    int next = seq;
+    int pending = PendingRange(seq + 1);
+    if (pending >= 0)
     {
-        if (it->seq_number > seq)
-            return it->seq_number;
-        it++;
+        // Stop at the placeholder until the rows behind it are decoded
+        if (pending > seq)
+            next = pending;
     }
+    else
+    {
+        // Find the next marked sequence
+        TRowKey key;
+        if (SeqDataIndex.next(seq, key) && key.row < PublishedRows && PendingRange(key.seq_number) < 0)
+        {
+            next = key.seq_number;
+        }
+        if (next == seq && LateDone < CaptureLast)
+            next = LateDone + 1;
+    }
+    DecodeLock.leave();
+    
+    // User marks are stops as well
+    int mark;
+    if (UserMarks.next(seq, mark) && (next == seq || mark < next))
+        next = mark;
     
-    // If we reach here, no next sequence found, return the current one
-    return seq;
+    // If no next sequence was found this is the current one
+    return next;
 }
 
 int ParseMarkSet(struct pctx *pctx, int seq, int a3)
 {
-    LogDebug(pctx, 9, "%s", "ParseMarkSet");
+    LogDebug(pctx, 9, "%s: sequence %d, a3 %d", "ParseMarkSet", seq, a3);
+    
+    // A nonzero a3 marks the sequence, zero clears the mark
+    UserMarks.set(seq, a3 != 0);
     return 0;
 }
 
 int ParseMarkGet(struct pctx *pctx, int seq)
 {
     LogDebug(pctx, 9, "%s: sequence %d", "ParseMarkGet", seq);
-    return seq;
+    return UserMarks.test(seq) ? 1 : 0;
 }
 
 int ParseMarkMenu(struct pctx *pctx, int seq, int a3, int a4, int a5)
@@ -1059,7 +1002,7 @@ int ParseInfo(struct pctx *pctx, unsigned int request)
         case MODEINFO_MAX_GROUP:
             return ARRAY_SIZE(groupinfo);
         case MODEINFO_GETNAME:
-            return (int)"ISA";
+            return (int)(size_t)"ISA";
         case 3:
             return 1;
         case MODEINFO_MAX_MODE:
@@ -1076,7 +1019,9 @@ struct businfo *ParseBusInfo(struct pctx *pctx, uint16_t bus)
 {
     LogDebug(pctx, 6, "%s: %08x", "ParseBusInfo", bus);
     // Reset for parsing data
+    StopDecode();
     SeqDataVector.clear();
+    SeqDataIndex.clear();
     processing_done = 0;
     
     if (bus >= ARRAY_SIZE(businfo))
@@ -1147,6 +1092,14 @@ int ParseModeGetPut(struct pctx *pctx, int mode, int value, int request)
                 // ERROR_DETECTION setting
                 set_error_detection = value;
                 break;
+            case 7:
+                // RESULT_RAM setting
+                set_result_ram = value;
+                break;
+            case 8:
+                // GLITCH_FILTER setting
+                set_glitch_filter = value;
+                break;
             default:
                 break;
         }
@@ -1187,6 +1140,14 @@ int ParseModeGetPut(struct pctx *pctx, int mode, int value, int request)
                 // ERROR_DETECTION setting
                 value = set_error_detection;
                 break;
+            case 7:
+                // RESULT_RAM setting
+                value = set_result_ram;
+                break;
+            case 8:
+                // GLITCH_FILTER setting
+                value = set_glitch_filter;
+                break;
             default:
                 value = 0;
                 break;
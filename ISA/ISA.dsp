@@ -100,16 +100,60 @@ SOURCE=.\ISA.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\bitplane.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\chanmap.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\checkpoint.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\compat.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\deglitch.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\ISA.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\isaengine.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\markset.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\mirror.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\pagestore.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\pipeline.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\platform.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\stdint.h
 # End Source File
+# Begin Source File
+
+SOURCE=.\textout.h
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 
@@ -2,7 +2,14 @@
 #define ISA_H
 
 #include "compat.h"
+#include "platform.h"
 #include "stdint.h"
+#include "pagestore.h"
+#include "markset.h"
+#include "chanmap.h"
+#include "checkpoint.h"
+#include "mirror.h"
+#include "textout.h"
 #include <vector>
 using namespace std;
 
@@ -65,6 +72,22 @@ using namespace std;
 // Data Lines
 #define ISA_DATA_MASK   0x0000FFFF  // 16-bit data bus
 
+// Trigger-first decoding
+#define ISA_RESYNC_WINDOW   65536   // Samples searched back from the trigger for a resync point
+#define ISA_STROBE_MASK     (ISA_IOR | ISA_IOW | ISA_MEMR | ISA_MEMW | ISA_REFRESH)
+
+// Control lines the glitch filter applies to: every one the decoder tests
+// except BCLK, whose pulses are only a few samples wide at a slow sample rate
+#define ISA_GLITCH_LINES    (ISA_ALE | ISA_STROBE_MASK | ISA_MASTER | ISA_SBHE | \
+                             ISA_IOCHRDY | ISA_AEN | ISA_IOCHK | ISA_RESET)
+
+// Decoder features; all optional lines are probed, the address width is a setting
+#define ISA_DECODE_FEATURES (ISA_FEATURE_16BIT | ISA_FEATURE_REFRESH | ISA_FEATURE_IOCHRDY)
+
+// Background decoding
+#define ISA_DECODE_CHUNK    65536   // Samples decoded per published chunk
+#define ISA_ROW_SLOTS       256     // Rows rendered for the host (power of 2)
+
 /*********************************************************
         TLA Types
 *********************************************************/
@@ -118,6 +141,8 @@ struct pctx_functable {
         void (*rda_free)(void *p);
         void *(*rda_calloc)(int memb, int size);
         int (*LAInfo)(struct lactx *, enum TLA_INFO, int16_t bus);
+        int (*LABusModTrigSample)(struct lactx *, int16_t bus);
+        int (*LAProgAbort)(struct lactx *);
 };
 
 struct pctx {
@@ -181,14 +206,14 @@ struct lafunc {
         void (*LAWhichBusMod_)(void);                       /* 84 */
         void (*LASeqDisplayFormat_)(void);                  /* 88 */
         void (*LAInteractiveUI2_)(void);                    /* 8c */
-        void (*LAProgAbort_)(void);                         /* 90 */
+        int  (*LAProgAbort)(struct lactx *);                /* 90 */
         void (*LATimestamp_ps_ToText)(void);                /* 94 */
         void (*LATimeStampDisplayFormat)(void);             /* 98 */
         void (*LAReferenceTime_ps_)(void);                  /* 9c */
         void (*LABusModSysTrigTime_ps_)(void);              /* a0 */
         void (*LABusModFrameOffset_ps_)(void);              /* a4 */
         void (*LABusModTimeToUserAlignedTime_ps_)(void);    /* a8 */
-        void (*LABusModTrigSample)(void);                   /* ac */
+        int  (*LABusModTrigSample)(struct lactx *, int16_t bus); /* ac */
         void (*LABusModWallClockStart_)(void);              /* b0 */
         void *field_B4;                                     /* b4 */
         void (*LAReferenceTime_ps_2)(void);                 /* b8 */
@@ -206,119 +231,61 @@ struct lafunc {
         ISA Types
 *********************************************************/
 
-// ISA state machine states
-enum ISA_STATE {
-    ISA_STATE_IDLE,
-    ISA_STATE_T1,         // First clock cycle of bus cycle
-    ISA_STATE_T2,         // Second clock cycle of bus cycle - data transfer
-    ISA_STATE_TW,         // Wait states
-    ISA_STATE_T3,         // Third and final clock cycle of bus cycle
-    ISA_STATE_DMA_ACTIVE, // DMA cycle in progress
-    ISA_STATE_REFRESH     // Memory refresh cycle
-};
-
-// ISA transaction types
-enum ISA_TRANSACTION_TYPE {
-    ISA_TRANS_NONE,
-    ISA_TRANS_IO_READ_BYTE,    // 8-bit I/O read
-    ISA_TRANS_IO_READ_WORD,    // 16-bit I/O read
-    ISA_TRANS_IO_WRITE_BYTE,   // 8-bit I/O write
-    ISA_TRANS_IO_WRITE_WORD,   // 16-bit I/O write
-    ISA_TRANS_MEM_READ_BYTE,   // 8-bit memory read
-    ISA_TRANS_MEM_READ_WORD,   // 16-bit memory read
-    ISA_TRANS_MEM_WRITE_BYTE,  // 8-bit memory write
-    ISA_TRANS_MEM_WRITE_WORD,  // 16-bit memory write
-    ISA_TRANS_DMA_READ_BYTE,   // 8-bit DMA read
-    ISA_TRANS_DMA_READ_WORD,   // 16-bit DMA read
-    ISA_TRANS_DMA_WRITE_BYTE,  // 8-bit DMA write
-    ISA_TRANS_DMA_WRITE_WORD,  // 16-bit DMA write
-    ISA_TRANS_REFRESH,         // Memory refresh cycle
-    ISA_TRANS_ERROR            // Error condition
-};
-
-typedef struct TISAData
+// Signal layout for the shared decoder in isaengine.h
+struct TISALayout
 {
-    // Transaction information
-    int sequence;             // Starting sequence number
-    int last_sequence;        // Ending sequence number
-    int state;                // Current state in ISA state machine
-    int transaction_type;     // Type of ISA transaction
-    uint32_t address;         // ISA bus address (up to 24 bits)
-    uint16_t data;            // ISA bus data (8 or 16 bits)
-    
-    // Signal state tracking
-    int ior_active;           // IOR# is active (low) - was bool
-    int iow_active;           // IOW# is active (low) - was bool
-    int memr_active;          // MEMR# is active (low) - was bool
-    int memw_active;          // MEMW# is active (low) - was bool
-    int refresh_active;       // REFRESH# is active (low) - was bool
-    int master_active;        // MASTER# is active (low) - was bool
-    int sbhe_active;          // SBHE# is active (low) - was bool
-    int iochrdy_active;       // IOCHRDY is active (high) - was bool
-    int aen_active;           // AEN is active (high) - was bool
-    
-    // DMA and IRQ tracking
-    int active_dma_channel;   // Active DMA channel (0-7, -1 if none)
-    int active_irq_line;      // Active IRQ line (0-15, -1 if none)
-    int tc_active;            // Terminal Count is active - was bool
-    
-    // Transaction attributes
-    int wait_states;          // Number of wait states in current transaction
-    int is_16bit;             // Is this a 16-bit transaction? - was bool
-    
-    // Address decoding
-    int use_io_space;         // I/O space (vs memory space) - was bool
-    int port_access;          // Specifically for I/O port access - was bool
-    
-    // Timing and error tracking
-    int bus_timing_cycles;    // Bus cycles for timing verification
-    uint64_t start_time_ps;   // Transaction start time (picoseconds)
-    uint64_t end_time_ps;     // Transaction end time (picoseconds)
-    int timed_out;            // Transaction timed out - was bool
-    int protocol_error;       // Protocol violation detected - was bool
-    char error_message[64];   // Error message if applicable
-    
-} TISAData;
-
-// ISA address and data structure for tracking component states
-typedef struct TISABusData {
-    int addr_latch_state;     // 0 = not latched, 1 = partially latched, 2 = fully latched
-    uint32_t partial_addr;    // Address accumulator during latching
-    uint32_t latched_addr;    // Fully latched address
-    uint16_t pending_data;    // Data accumulator during data phase
-    uint16_t data;            // Completed data transfer
-    int addr_valid;           // Address has been validated - was bool
-    int data_valid;           // Data has been validated - was bool
-    int bus_width;            // Current bus width (8 or 16 bits)
-} TISABusData;
+    enum
+    {
+        CONTROL_GROUP = 0, ADDR_GROUP = 1, DATA_GROUP = 2, DMA_GROUP = 3, IRQ_GROUP = 4,
+        
+        BCLK = ISA_BCLK, ALE = ISA_ALE, IOR = ISA_IOR, IOW = ISA_IOW,
+        MEMR = ISA_MEMR, MEMW = ISA_MEMW, REFRESH = ISA_REFRESH, MASTER = ISA_MASTER,
+        SBHE = ISA_SBHE, IOCHRDY = ISA_IOCHRDY, AEN = ISA_AEN, IOCHK = ISA_IOCHK,
+        RESET = ISA_RESET,
+        
+        DACK0 = ISA_DACK0, DACK1 = ISA_DACK1, DACK2 = ISA_DACK2, DACK3 = ISA_DACK3,
+        DACK5 = ISA_DACK5, DACK6 = ISA_DACK6, DACK7 = ISA_DACK7, TC = ISA_TC,
+        
+        IRQ2 = ISA_IRQ2, IRQ3 = ISA_IRQ3, IRQ4 = ISA_IRQ4, IRQ5 = ISA_IRQ5,
+        IRQ6 = ISA_IRQ6, IRQ7 = ISA_IRQ7, IRQ9 = ISA_IRQ9, IRQ10 = ISA_IRQ10,
+        IRQ11 = ISA_IRQ11, IRQ12 = ISA_IRQ12, IRQ14 = ISA_IRQ14, IRQ15 = ISA_IRQ15
+    };
+};
 
+// Packed result row; the text is rendered only when the host asks for it
 typedef struct TSeqData
 {
-    int seq_number;
-    struct sequence seq_data;
-} TSeqData;
+    int seq_number;           // Sequence the row is shown at
+    uint32_t address;         // Latched address (up to 24 bits)
+    uint16_t data;            // Transferred data, 0xFF/0xFFFF if not captured
+    uint16_t count;           // Wait states, bus cycles or state, depending on kind
+    uint8_t kind;             // ISA_ROW_KIND
+    uint8_t trans_type;       // ISA_TRANSACTION_TYPE named in the text
+    uint8_t flags;            // Display flags, as in struct sequence
+    uint8_t detail;           // DMA channel | ISA_ROW_DMA_TC, IRQ line, or address valid
+} TSeqData;                   // 16 bytes
 
-typedef vector<TSeqData> TVSeqData;
+typedef TPagedStore<TSeqData> TSeqDataStore;
 
 /*********************************************************
         DLL prototypes
 *********************************************************/
 extern "C"
 {
-__declspec(dllexport) struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *func);
-__declspec(dllexport) int ParseFinish(struct pctx *pctx);
-__declspec(dllexport) int ParseInfo(struct pctx *pctx, unsigned int request);
-__declspec(dllexport) int ParseMarkMenu(struct pctx *, int, int, int, int);
-__declspec(dllexport) int ParseMarkGet(struct pctx *pctx, int seq);
-__declspec(dllexport) int ParseMarkSet(struct pctx *pctx, int seq, int);
-__declspec(dllexport) int ParseMarkNext(struct pctx *pctx, int seq, int);
-__declspec(dllexport) int ParseModeGetPut(struct pctx *pctx, int mode, int, int request);
-__declspec(dllexport) struct sequence *ParseSeq(struct pctx *, int seq);
-__declspec(dllexport) struct businfo *ParseBusInfo(struct pctx *, uint16_t bus);
-__declspec(dllexport) struct modeinfo *ParseModeInfo(struct pctx *pctx, uint16_t mode);
-__declspec(dllexport) struct groupinfo *ParseGroupInfo(struct pctx *pctx, uint16_t group);
-__declspec(dllexport) int ParseDisasmReinit(struct pctx *, int request);
-__declspec(dllexport) int ParseExtInfo_(struct pctx *pctx);
+PARSE_EXPORT struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *func);
+PARSE_EXPORT int ParseFinish(struct pctx *pctx);
+PARSE_EXPORT int ParseInfo(struct pctx *pctx, unsigned int request);
+PARSE_EXPORT int ParseMarkMenu(struct pctx *, int, int, int, int);
+PARSE_EXPORT int ParseMarkGet(struct pctx *pctx, int seq);
+PARSE_EXPORT int ParseMarkSet(struct pctx *pctx, int seq, int);
+PARSE_EXPORT int ParseMarkNext(struct pctx *pctx, int seq, int);
+PARSE_EXPORT int ParseModeGetPut(struct pctx *pctx, int mode, int, int request);
+PARSE_EXPORT struct sequence *ParseSeq(struct pctx *, int seq);
+PARSE_EXPORT struct businfo *ParseBusInfo(struct pctx *, uint16_t bus);
+PARSE_EXPORT struct modeinfo *ParseModeInfo(struct pctx *pctx, uint16_t mode);
+PARSE_EXPORT struct groupinfo *ParseGroupInfo(struct pctx *pctx, uint16_t group);
+PARSE_EXPORT int ParseDisasmReinit(struct pctx *, int request);
+PARSE_EXPORT int ParseExtInfo_(struct pctx *pctx);
 }
 
 #endif // ISA_H
\ No newline at end of file
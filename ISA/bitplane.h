@@ -0,0 +1,320 @@
+// bitplane.h - Group samples sliced into one bit-plane per signal
+#pragma once
+
+#ifndef BITPLANE_H
+#define BITPLANE_H
+
+#include "compat.h"
+
+// The decoders mostly wait for an edge on one of a few control lines. In a
+// bit-plane each 64-bit word holds one line over 64 consecutive samples, so
+// the edges of a line over those samples are x & ~(x << 1 | carry), a
+// handful of word operations, and a population count gives the number of
+// edges directly. The planes are built once per block from the group
+// values; where the compiler targets SSE2, four samples are sliced per
+// instruction.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BITPLANE_SSE2
+#endif
+
+#define BITPLANE_BLOCK  4096    // Samples sliced in one call, a multiple of 64
+#define BITPLANE_WORDS  (BITPLANE_BLOCK / 64)
+#define BITPLANE_LINES  16      // Lines sliced per group
+
+class TBitPlanes
+{
+public:
+    TBitPlanes() : values(NULL), count(0), lines(0), planes(0) {}
+
+    // Slice the lines in mask, the lowest BITPLANE_LINES of them; other
+    // lines read as never set
+    void select(uint32_t mask)
+    {
+        lines = 0;
+        planes = 0;
+        for (int bit = 0; bit < 32; bit++)
+        {
+            plane_of[bit] = -1;
+            if ((mask & (1u << bit)) != 0 && planes < BITPLANE_LINES)
+            {
+                plane_of[bit] = planes;
+                bit_of[planes] = bit;
+                lines |= 1u << bit;
+                planes++;
+            }
+        }
+    }
+
+    // Slice count samples, count <= BITPLANE_BLOCK. The samples are kept
+    // by reference; previous is the sample before samples[0].
+    void build(const uint32_t *samples, int samples_count, uint32_t previous)
+    {
+        values = samples;
+        count = samples_count > BITPLANE_BLOCK ? BITPLANE_BLOCK : samples_count;
+        first_previous = previous;
+
+        int words = (count + 63) / 64;
+        for (int w = 0; w < words; w++)
+        {
+            int base = w * 64;
+            int width = count - base < 64 ? count - base : 64;
+            uint32_t lo[BITPLANE_LINES];
+            uint32_t hi[BITPLANE_LINES];
+            int p;
+            for (p = 0; p < planes; p++)
+            {
+                lo[p] = 0;
+                hi[p] = 0;
+            }
+
+            int t = 0;
+#ifdef BITPLANE_SSE2
+            // Shift the line into the sign bit of each sample; movemask
+            // then collects the four sign bits
+            for (; t + 4 <= width; t += 4)
+            {
+                __m128i four = _mm_loadu_si128((const __m128i *)(samples + base + t));
+                for (p = 0; p < planes; p++)
+                {
+                    __m128i sign = _mm_slli_epi32(four, 31 - bit_of[p]);
+                    uint32_t bits = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(sign));
+                    if (t < 32)
+                        lo[p] |= bits << t;
+                    else
+                        hi[p] |= bits << (t - 32);
+                }
+            }
+#endif
+            for (; t < width; t++)
+            {
+                uint32_t sample = samples[base + t];
+                for (p = 0; p < planes; p++)
+                {
+                    uint32_t bit = (sample >> bit_of[p]) & 1;
+                    if (t < 32)
+                        lo[p] |= bit << t;
+                    else
+                        hi[p] |= bit << (t - 32);
+                }
+            }
+
+            for (p = 0; p < planes; p++)
+            {
+                plane[p][w] = ((uint64_t)hi[p] << 32) | lo[p];
+            }
+        }
+    }
+
+    // Read count samples of a group from the host and slice them
+    const uint32_t *load(int (*group_value)(struct lactx *, int, int), struct lactx *lactx,
+                         int group, int first, int samples_count, uint32_t previous)
+    {
+        if (samples_count > BITPLANE_BLOCK)
+        {
+            samples_count = BITPLANE_BLOCK;
+        }
+        for (int i = 0; i < samples_count; i++)
+        {
+            own[i] = (uint32_t)group_value(lactx, first + i, group);
+        }
+        build(own, samples_count, previous);
+        return own;
+    }
+
+    int samples() const { return count; }
+    int words() const { return (count + 63) / 64; }
+    uint32_t sample(int index) const { return values[index]; }
+
+    // Word w of a line: bit t is the line at sample w * 64 + t
+    uint64_t level(uint32_t line, int w) const
+    {
+        int p = plane_index(line);
+        return p >= 0 ? plane[p][w] : 0;
+    }
+
+    // Samples where the line is set and was clear in the sample before
+    uint64_t rising(uint32_t line, int w) const
+    {
+        int p = plane_index(line);
+        if (p < 0)
+        {
+            return 0;
+        }
+        return plane[p][w] & ~before(p, w) & valid(w);
+    }
+
+    // Samples where the line is clear and was set in the sample before
+    uint64_t falling(uint32_t line, int w) const
+    {
+        int p = plane_index(line);
+        if (p < 0)
+        {
+            return 0;
+        }
+        return ~plane[p][w] & before(p, w) & valid(w);
+    }
+
+    // Samples where any of the lines differs from the sample before
+    uint64_t changed(uint32_t mask, int w) const
+    {
+        uint64_t any = 0;
+        for (int p = 0; p < planes; p++)
+        {
+            if ((mask & (1u << bit_of[p])) != 0)
+            {
+                any |= plane[p][w] ^ before(p, w);
+            }
+        }
+        return any & valid(w);
+    }
+
+    // Samples where every line in mask is set, and the same one sample later
+    uint64_t all(uint32_t mask, int w) const
+    {
+        uint64_t every = valid(w);
+        for (int p = 0; p < planes; p++)
+        {
+            if ((mask & (1u << bit_of[p])) != 0)
+            {
+                every &= plane[p][w];
+            }
+        }
+        return (mask & ~lines) == 0 ? every : 0;
+    }
+
+    uint64_t all_before(uint32_t mask, int w) const
+    {
+        uint64_t every = valid(w);
+        for (int p = 0; p < planes; p++)
+        {
+            if ((mask & (1u << bit_of[p])) != 0)
+            {
+                every &= before(p, w);
+            }
+        }
+        return (mask & ~lines) == 0 ? every : 0;
+    }
+
+    // Samples of word w that are in the block
+    uint64_t valid(int w) const
+    {
+        int width = count - w * 64;
+        if (width >= 64)
+        {
+            return ~(uint64_t)0;
+        }
+        return width > 0 ? ((uint64_t)1 << width) - 1 : 0;
+    }
+
+    // Number of set bits
+    static int population(uint64_t x)
+    {
+#if defined(__GNUC__)
+        return __builtin_popcountll(x);
+#else
+        // The TLA controller CPUs have no POPCNT
+        return population32((uint32_t)x) + population32((uint32_t)(x >> 32));
+#endif
+    }
+
+    // Index of the lowest set bit of a non-zero word
+    static int lowest(uint64_t x)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(x);
+#else
+        uint32_t lo = (uint32_t)x;
+        return lo != 0 ? lowest32(lo) : 32 + lowest32((uint32_t)(x >> 32));
+#endif
+    }
+
+    // First sample from from on whose bit is set in words, end if none
+    static int next(const uint64_t *words, int from, int end)
+    {
+        for (int w = from / 64; w * 64 < end; w++)
+        {
+            uint64_t bits = words[w];
+            if (w == from / 64)
+            {
+                bits &= ~(uint64_t)0 << (from % 64);
+            }
+            if (bits != 0)
+            {
+                int index = w * 64 + lowest(bits);
+                return index < end ? index : end;
+            }
+        }
+        return end;
+    }
+
+    // Index of the highest set bit of a non-zero word
+    static int highest(uint64_t x)
+    {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(x);
+#else
+        uint32_t hi = (uint32_t)(x >> 32);
+        return hi != 0 ? 32 + highest32(hi) : highest32((uint32_t)x);
+#endif
+    }
+
+private:
+    int plane_index(uint32_t line) const
+    {
+        if ((line & lines) == 0)
+        {
+            return -1;
+        }
+        return plane_of[lowest((uint64_t)(line & lines))];
+    }
+
+    // The plane one sample later: bit t is the line at sample w * 64 + t - 1
+    uint64_t before(int p, int w) const
+    {
+        uint64_t carry = w > 0 ? plane[p][w - 1] >> 63 : (first_previous >> bit_of[p]) & 1;
+        return (plane[p][w] << 1) | carry;
+    }
+
+#if !defined(__GNUC__)
+    static int population32(uint32_t x)
+    {
+        x = x - ((x >> 1) & 0x55555555);
+        x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+        x = (x + (x >> 4)) & 0x0F0F0F0F;
+        return (int)((x * 0x01010101) >> 24);
+    }
+
+    static int lowest32(uint32_t x)
+    {
+        static const int debruijn[32] =
+        {
+            0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+            31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+        };
+        return debruijn[((x & (0 - x)) * 0x077CB531) >> 27];
+    }
+
+    static int highest32(uint32_t x)
+    {
+        int bit = 0;
+        while (x >>= 1)
+        {
+            bit++;
+        }
+        return bit;
+    }
+#endif
+
+    const uint32_t *values;       // Samples of the block
+    int count;
+    uint32_t first_previous;      // Sample before the block
+    uint32_t lines;               // Lines sliced
+    int planes;
+    int plane_of[32];             // Plane of each group bit, -1 if not sliced
+    int bit_of[BITPLANE_LINES];   // Group bit of each plane
+    uint64_t plane[BITPLANE_LINES][BITPLANE_WORDS];
+    uint32_t own[BITPLANE_BLOCK]; // Samples read by load()
+};
+
+#endif // BITPLANE_H
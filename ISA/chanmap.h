@@ -0,0 +1,328 @@
+// chanmap.h - Probe channel positions read from the package's .tla file
+#pragma once
+
+#ifndef CHANMAP_H
+#define CHANMAP_H
+
+#include "compat.h"
+
+// The decoders test signals at the bit positions in their header. The TLA
+// application builds each group value from the channels listed in the
+// group's definition in the .tla file, the first channel in bit 0. When the
+// probe wiring in the .tla file is changed, the channels land elsewhere; the
+// channel map reads the definitions once in ParseReinit and moves every
+// channel of such a group back to its header position as the group is read,
+// so the decoders keep testing constant masks. Groups that match the header
+// are read as they are.
+//
+// A group is moved as runs of channels whose order is the same in the .tla
+// file and the header, one pext/pdep pair per run where the compiler targets
+// BMI2, otherwise one mask and shift per distance moved.
+//
+// The order in which the application packs the listed channels is not yet
+// confirmed on hardware, and the shipped files disagree: ISA.tla and PCI.tla
+// list their groups from bit 0 up, ISA_Minimal.tla lists address and data
+// from the top bit down. The map is therefore only read in builds that
+// define WITH_CHANNEL_MAP; otherwise every group is read as it is.
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define CHANMAP_PEXT
+#endif
+
+#define CHANMAP_MAX_GROUPS  8       // Package groups that can be mapped
+#define CHANMAP_LINE_LEN    8192    // Longest .tla line read in one piece
+
+typedef int (*TGroupValueFunc)(struct lactx *lactx, int seqno, int group);
+
+// A channel the decoder uses, and where its header puts it
+typedef struct TChannelDef
+{
+    int group;                // Package group number, as passed to LAGroupValue
+    const char *name;         // Channel name in the .tla file, or prefix of numbered lines
+    uint32_t mask;            // Header bit; for numbered lines, the bits of lines 0, 1, ...
+    int numbered;             // name is followed by the line number, e.g. ISA_ADDR_07
+} TChannelDef;
+
+// The .tla user group a package group is read from
+typedef struct TChannelGroupDef
+{
+    int group;                // Package group number
+    const char *name;         // User group name in the .tla file
+} TChannelGroupDef;
+
+/*********************************************************
+        Group gather
+*********************************************************/
+// Moves the channels of one group value to their header positions
+class TGroupGather
+{
+public:
+    TGroupGather() { clear(); }
+
+    void clear()
+    {
+        active = false;
+        runs = 0;
+        moves = 0;
+        last_dst = -1;
+    }
+
+    // Add a channel, in the order of the .tla definition
+    void add(int src, int dst)
+    {
+        if (src != dst)
+        {
+            active = true;
+        }
+        if (runs == 0 || dst <= last_dst)
+        {
+            run_src[runs] = 0;
+            run_dst[runs] = 0;
+            runs++;
+        }
+        run_src[runs - 1] |= 1u << src;
+        run_dst[runs - 1] |= 1u << dst;
+        last_dst = dst;
+
+        int shift = dst - src;
+        int move = 0;
+        while (move < moves && move_shift[move] != shift)
+        {
+            move++;
+        }
+        if (move == moves)
+        {
+            move_shift[moves] = shift;
+            move_mask[moves] = 0;
+            moves++;
+        }
+        move_mask[move] |= 1u << src;
+    }
+
+    uint32_t gather(uint32_t value) const
+    {
+        uint32_t out = 0;
+#ifdef CHANMAP_PEXT
+        for (int run = 0; run < runs; run++)
+        {
+            out |= _pdep_u32(_pext_u32(value, run_src[run]), run_dst[run]);
+        }
+#else
+        for (int move = 0; move < moves; move++)
+        {
+            uint32_t bits = value & move_mask[move];
+            out |= move_shift[move] >= 0 ? bits << move_shift[move] : bits >> -move_shift[move];
+        }
+#endif
+        return out;
+    }
+
+    bool active;              // Some channel is not where the header puts it
+
+private:
+    int runs;                 // Channels in the same order in both layouts
+    uint32_t run_src[32];
+    uint32_t run_dst[32];
+    int last_dst;
+    int moves;                // Channels moved by the same distance
+    uint32_t move_mask[32];
+    int move_shift[32];
+};
+
+/*********************************************************
+        Channel map
+*********************************************************/
+class TChannelMap
+{
+public:
+    TChannelMap() : host(NULL) {}
+
+    // Read the group definitions from a .tla file. host is the application's
+    // LAGroupValue; value() calls it. Returns the number of groups that are
+    // wired differently from the header, -1 if the file cannot be read or
+    // the build does not define WITH_CHANNEL_MAP.
+    int load(const char *path, TGroupValueFunc host_func,
+             const TChannelGroupDef *groups, int group_count,
+             const TChannelDef *channels, int channel_count)
+    {
+        for (int i = 0; i < CHANMAP_MAX_GROUPS; i++)
+        {
+            gathers[i].clear();
+        }
+        host = host_func;
+
+        FILE *file = NULL;
+#ifdef WITH_CHANNEL_MAP
+        file = path != NULL ? fopen(path, "r") : NULL;
+#endif
+        if (file == NULL)
+        {
+            return -1;
+        }
+
+        char *line = (char *)malloc(CHANMAP_LINE_LEN);
+        char group_name[64] = "";
+        int mapped = 0;
+        while (line != NULL && fgets(line, CHANMAP_LINE_LEN, file) != NULL)
+        {
+            const char *start = strstr(line, "CjmChannelGroup \"UserGrp\" \"$");
+            if (start != NULL)
+            {
+                start += strlen("CjmChannelGroup \"UserGrp\" \"$");
+                size_t len = strcspn(start, "$");
+                if (len >= sizeof(group_name))
+                    len = sizeof(group_name) - 1;
+                memcpy(group_name, start, len);
+                group_name[len] = '\0';
+                continue;
+            }
+
+            start = strstr(line, "\"ClaGroupDefinition\"");
+            if (start == NULL || (start = strstr(start, "{ \"")) == NULL)
+            {
+                continue;
+            }
+            start += 3;
+            char *end = (char *)strchr(start, '"');
+            if (end != NULL)
+            {
+                *end = '\0';
+            }
+
+            for (int g = 0; g < group_count; g++)
+            {
+                if (strcmp(groups[g].name, group_name) == 0 &&
+                    groups[g].group >= 0 && groups[g].group < CHANMAP_MAX_GROUPS &&
+                    bind(gathers[groups[g].group], groups[g].group, start, channels, channel_count))
+                {
+                    mapped++;
+                }
+            }
+            group_name[0] = '\0';
+        }
+        free(line);
+        fclose(file);
+        return mapped;
+    }
+
+    // Group value with the channels where the header expects them
+    int value(struct lactx *lactx, int seqno, int group) const
+    {
+        int raw = host(lactx, seqno, group);
+        if (group >= 0 && group < CHANMAP_MAX_GROUPS && gathers[group].active)
+        {
+            return (int)gathers[group].gather((uint32_t)raw);
+        }
+        return raw;
+    }
+
+private:
+    // Set up the gather for one group definition; false if the group matches
+    // the header, lacks a signal the decoder tests or lists one past bit 31,
+    // where the group value cannot hold it; such a group is read as it is.
+    // Numbered lines beyond the definition read as 0.
+    static bool bind(TGroupGather& gather, int group, const char *definition,
+                     const TChannelDef *channels, int channel_count)
+    {
+        gather.clear();
+        uint32_t found = 0;
+        uint32_t placed = 0;
+
+        int src = 0;
+        const char *name = definition;
+        while (*name != '\0')
+        {
+            size_t len = strcspn(name, ", \t");
+            if (len == 0)
+            {
+                name++;
+                continue;
+            }
+
+            int dst = header_bit(group, name, len, channels, channel_count, &found);
+            if (dst >= 0 && src >= 32)
+            {
+                gather.clear();
+                return false;
+            }
+            if (dst >= 0 && (placed & (1u << dst)) == 0)
+            {
+                gather.add(src, dst);
+                placed |= 1u << dst;
+            }
+            src++;
+            name += len;
+        }
+
+        // Every signal the decoder tests must be wired
+        for (int i = 0; i < channel_count; i++)
+        {
+            if (channels[i].group == group && !channels[i].numbered && (found & channels[i].mask) == 0)
+            {
+                gather.clear();
+                return false;
+            }
+        }
+        return gather.active;
+    }
+
+    // Header bit of a channel of the group, -1 if the decoder does not use it
+    static int header_bit(int group, const char *name, size_t len,
+                          const TChannelDef *channels, int channel_count, uint32_t *found)
+    {
+        for (int i = 0; i < channel_count; i++)
+        {
+            if (channels[i].group != group)
+            {
+                continue;
+            }
+            size_t def_len = strlen(channels[i].name);
+            if (!channels[i].numbered)
+            {
+                if (def_len == len && strncmp(channels[i].name, name, len) == 0)
+                {
+                    *found |= channels[i].mask;
+                    return lowest_bit(channels[i].mask, 0);
+                }
+                continue;
+            }
+            if (def_len < len && strncmp(channels[i].name, name, def_len) == 0 &&
+                strspn(name + def_len, "0123456789") == len - def_len)
+            {
+                return lowest_bit(channels[i].mask, atoi(name + def_len));
+            }
+        }
+        return -1;
+    }
+
+    // Position of the n-th set bit of mask, -1 if it has fewer
+    static int lowest_bit(uint32_t mask, int n)
+    {
+        for (int bit = 0; bit < 32; bit++)
+        {
+            if ((mask & (1u << bit)) != 0 && n-- == 0)
+            {
+                return bit;
+            }
+        }
+        return -1;
+    }
+
+    TGroupValueFunc host;
+    TGroupGather gathers[CHANMAP_MAX_GROUPS];
+};
+
+// Path of the package's .tla file from the support file fields the
+// application passes to ParseReinit; false if it gave none
+inline bool SupportFilePath(char *buf, size_t size, const char *path, const char *sep,
+                            const char *name, const char *ext)
+{
+    if (path == NULL || name == NULL || buf == NULL || size == 0)
+    {
+        return false;
+    }
+    snprintf(buf, size, "%s%s%s%s", path, sep != NULL ? sep : "", name, ext != NULL ? ext : ".tla");
+    return true;
+}
+
+#endif // CHANMAP_H
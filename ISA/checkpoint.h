@@ -0,0 +1,115 @@
+// checkpoint.h - Decoder state snapshots for resuming a decode part way
+#pragma once
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "stdint.h"
+#include <vector>
+
+// A decode pass snapshots its whole state (the transaction in flight, the
+// signal levels it compares against and the glitch filter carry) after
+// every chunk. Resumed from a snapshot, a pass decodes on exactly as the
+// pass that took it did, so any range of the capture can be decoded again
+// from the nearest snapshot before it instead of from the start.
+//
+// Snapshots belong to one capture decoded with one set of the settings the
+// state depends on: bind() keeps them across a re-decode with only other
+// settings changed, and drops them otherwise.
+
+/*********************************************************
+        Checkpoint list
+*********************************************************/
+// STATE is plain data; each snapshot is taken before sample seq.
+template <class STATE>
+class TCheckpoints
+{
+public:
+    TCheckpoints() : capture_first(0), capture_last(-1), capture_signature(0), decode_key(0) {}
+
+    void clear()
+    {
+        entries.clear();
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // Attach the snapshots to a capture and the settings key they are
+    // taken with, dropping them if either differs. Returns true if kept.
+    bool bind(int first, int last, uint32_t signature, uint32_t key)
+    {
+        if (first == capture_first && last == capture_last && signature == capture_signature &&
+            key == decode_key)
+        {
+            return true;
+        }
+        clear();
+        capture_first = first;
+        capture_last = last;
+        capture_signature = signature;
+        decode_key = key;
+        return false;
+    }
+
+    // Keep a snapshot of the state before seq, replacing one already there
+    void record(int seq, const STATE& state)
+    {
+        size_t i = find(seq);
+        if (i < entries.size() && entries[i].seq == seq)
+        {
+            entries[i].state = state;
+            return;
+        }
+        TEntry entry;
+        entry.seq = seq;
+        entry.state = state;
+        entries.insert(entries.begin() + i, entry);
+    }
+
+    // Last snapshot at or before seq; NULL if there is none
+    const STATE *nearest(int seq, int& found) const
+    {
+        size_t i = find(seq);
+        if (i < entries.size() && entries[i].seq == seq)
+        {
+            i++;
+        }
+        if (i == 0)
+        {
+            return NULL;
+        }
+        found = entries[i - 1].seq;
+        return &entries[i - 1].state;
+    }
+
+private:
+    struct TEntry
+    {
+        int seq;                    // Sample the state was taken before
+        STATE state;
+    };
+
+    // Index of the first snapshot at or after seq
+    size_t find(int seq) const
+    {
+        size_t lo = 0;
+        size_t hi = entries.size();
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (entries[mid].seq < seq)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    std::vector<TEntry> entries;    // Sorted by seq
+    int capture_first;              // Capture the snapshots were taken on
+    int capture_last;
+    uint32_t capture_signature;
+    uint32_t decode_key;            // Settings they were taken with
+};
+
+#endif // CHECKPOINT_H
@@ -4,7 +4,6 @@
 #ifndef COMPAT_H
 #define COMPAT_H
 
-#include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,24 +13,24 @@ typedef int my_bool;
 #define MY_TRUE 1
 #define MY_FALSE 0
 
-// C99 types not available in VC6
-typedef unsigned char uint8_t;
-typedef signed char int8_t;
-typedef unsigned short uint16_t;
-typedef short int16_t;
-typedef unsigned int uint32_t;
-typedef int int32_t;
-typedef unsigned __int64 uint64_t;
-typedef __int64 int64_t;
+// C99 types, from the VC6 shim in stdint.h or the compiler's own
+#include "stdint.h"
 
 // Define ARRAY_SIZE macro
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
-// Completely disable LogDebug
+// Completely disable LogDebug. VC6 has no variadic macros, so there the
+// call is left as a comma expression that compiles to nothing.
+#if defined(_MSC_VER) && _MSC_VER < 1400
 #define LogDebug
+#else
+#define LogDebug(...) ((void)0)
+#endif
 
-// Function replacements
+// Function replacements, up to Visual C++ 2013
+#if defined(_MSC_VER) && _MSC_VER < 1900
 #define snprintf _snprintf
 #define vsnprintf _vsnprintf
+#endif
 
-#endif // COMPAT_H
\ No newline at end of file
+#endif // COMPAT_H
@@ -0,0 +1,188 @@
+// deglitch.h - Minimum pulse width filter for the control lines
+#pragma once
+
+#ifndef DEGLITCH_H
+#define DEGLITCH_H
+
+#include "compat.h"
+
+// With asynchronous sampling a line can flip for a sample or two between
+// real edges. The filter holds each selected line at its level until the
+// new level stays for at least the minimum width, so shorter pulses are
+// removed. It looks ahead instead of waiting, so the edges that are kept
+// stay on the sample they were captured at.
+//
+// A block is filtered in two steps. The first marks, for every sample, the
+// lines that keep their value for the minimum width from that sample on;
+// it has no dependency between samples and runs four samples per SSE2
+// instruction where the compiler targets it. The second walks the block
+// once and lets a line change only where it is marked.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEGLITCH_SSE2
+#endif
+
+#define DEGLITCH_BLOCK      4096    // Samples filtered in one call
+#define DEGLITCH_MAX_WIDTH  16      // Widest pulse the filter can remove + 1
+
+class TGlitchFilter
+{
+public:
+    TGlitchFilter() { configure(0, 0); }
+
+    // Remove pulses shorter than width samples on the lines in mask;
+    // a width below 2 turns the filter off. Clears the count.
+    void configure(int width, uint32_t mask)
+    {
+        min_width = width < 2 ? 0 : (width > DEGLITCH_MAX_WIDTH ? DEGLITCH_MAX_WIDTH : width);
+        lines = mask;
+        removed = 0;
+        next_seq = 0;
+        last_out = 0;
+        last_dev = 0;
+        continued = false;
+    }
+
+    bool enabled() const { return min_width != 0; }
+    int width() const { return min_width; }
+
+    // Raw samples past the end of a block the filter needs to see
+    int lookahead() const { return min_width != 0 ? min_width - 1 : 0; }
+
+    // Filtered value of the sample before first. The filter keeps its own
+    // when the block follows the last one; otherwise it starts from raw.
+    uint32_t previous(int first, uint32_t raw) const
+    {
+        return (continued && first == next_seq) ? last_out : raw;
+    }
+
+    // What the filter carries into the sample after the last block it
+    // filtered, for a decoder checkpoint there
+    void save(uint32_t& out, uint32_t& dev) const
+    {
+        out = last_out;
+        dev = last_dev;
+    }
+
+    // Carry on from a checkpoint saved before sample first
+    void resume(int first, uint32_t out, uint32_t dev)
+    {
+        continued = true;
+        next_seq = first;
+        last_out = out;
+        last_dev = dev;
+    }
+
+    // Filter count samples in place, count <= DEGLITCH_BLOCK. The ahead raw
+    // samples after them (lookahead(), fewer at the end of the capture) are
+    // read but left as they are. first is the sequence of samples[0] and
+    // raw_previous the sample before it.
+    void filter(uint32_t *samples, int count, int ahead, int first, uint32_t raw_previous)
+    {
+        if (min_width == 0 || count <= 0)
+        {
+            return;
+        }
+        if (count > DEGLITCH_BLOCK)
+        {
+            count = DEGLITCH_BLOCK;
+        }
+
+        mark_stable(samples, count, count + ahead);
+
+        uint32_t out = previous(first, raw_previous);
+        uint32_t dev = (continued && first == next_seq) ? last_dev : 0;
+        for (int t = 0; t < count; t++)
+        {
+            uint32_t in = samples[t];
+            out = (out & ~stable[t]) | (in & stable[t]);
+
+            // Count each pulse once, on the sample where it starts
+            uint32_t now = (in ^ out) & lines;
+            for (uint32_t start = now & ~dev; start != 0; start &= start - 1)
+            {
+                removed++;
+            }
+            dev = now;
+            samples[t] = out;
+        }
+
+        continued = true;
+        next_seq = first + count;
+        last_out = out;
+        last_dev = dev;
+    }
+
+    // Read count samples of a group from the host and filter them; the
+    // result stays valid until the next call
+    const uint32_t *load(int (*group_value)(struct lactx *, int, int), struct lactx *lactx,
+                         int group, int first, int count, int last_seq, uint32_t raw_previous)
+    {
+        if (count > DEGLITCH_BLOCK)
+        {
+            count = DEGLITCH_BLOCK;
+        }
+        int ahead = last_seq - (first + count - 1);
+        if (ahead > lookahead())
+            ahead = lookahead();
+        if (ahead < 0)
+            ahead = 0;
+
+        for (int i = 0; i < count + ahead; i++)
+        {
+            block[i] = group_value(lactx, first + i, group);
+        }
+        filter(block, count, ahead, first, raw_previous);
+        return block;
+    }
+
+    unsigned long removed;    // Pulses removed since configure()
+
+private:
+    // Lines of each sample that hold their value for min_width samples;
+    // lines that are not filtered always count as held. Near the end of
+    // the capture only the samples that are there are compared.
+    void mark_stable(const uint32_t *samples, int count, int available)
+    {
+        int t;
+        for (t = 0; t < count; t++)
+        {
+            stable[t] = 0xFFFFFFFF;
+        }
+
+        for (int k = 1; k < min_width; k++)
+        {
+            int limit = available - k;
+            if (limit > count)
+                limit = count;
+
+            t = 0;
+#ifdef DEGLITCH_SSE2
+            __m128i mask = _mm_set1_epi32((int)lines);
+            for (; t + 4 <= limit; t += 4)
+            {
+                __m128i base = _mm_loadu_si128((const __m128i *)(samples + t));
+                __m128i later = _mm_loadu_si128((const __m128i *)(samples + t + k));
+                __m128i held = _mm_loadu_si128((const __m128i *)(stable + t));
+                held = _mm_andnot_si128(_mm_and_si128(_mm_xor_si128(base, later), mask), held);
+                _mm_storeu_si128((__m128i *)(stable + t), held);
+            }
+#endif
+            for (; t < limit; t++)
+            {
+                stable[t] &= ~((samples[t] ^ samples[t + k]) & lines);
+            }
+        }
+    }
+
+    int min_width;            // 0 = off
+    uint32_t lines;           // Lines filtered
+    bool continued;           // last_* belong to the block before next_seq
+    int next_seq;
+    uint32_t last_out;        // Filtered value of the last sample
+    uint32_t last_dev;        // Lines held against a pulse at the last sample
+    uint32_t stable[DEGLITCH_BLOCK];
+    uint32_t block[DEGLITCH_BLOCK + DEGLITCH_MAX_WIDTH];
+};
+
+#endif // DEGLITCH_H
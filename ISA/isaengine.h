@@ -0,0 +1,1045 @@
+// isaengine.h - ISA bus cycle decoder shared by the ISA packages
+#pragma once
+
+#ifndef ISAENGINE_H
+#define ISAENGINE_H
+
+#include <string.h>
+#include "stdint.h"
+#include "compat.h"
+#include "deglitch.h"
+#include "bitplane.h"
+#include "pipeline.h"
+
+// The full and the minimal ISA package probe the same bus with different
+// channel assignments. Both run this state machine, instantiated with a
+// layout descriptor from their own header: a struct whose enum gives the
+// group numbers and the bit of each signal, with -1 for a group the package
+// does not have and 0 for a signal it does not decode. The masks are
+// compile-time constants, so every signal test is a test against an
+// immediate and the code for absent signals is left out.
+//
+// Include this header after the package header, which defines struct pctx
+// and the layout descriptor.
+
+/*********************************************************
+        Defines
+*********************************************************/
+
+// Decode features, picked per pass (see TISAEngine)
+#define ISA_FEATURE_16BIT        0x01    // Support for 16-bit data bus
+#define ISA_FEATURE_20BIT_ADDR   0x02    // Support for 20-bit address bus
+#define ISA_FEATURE_24BIT_ADDR   0x04    // Support for 24-bit address bus
+#define ISA_FEATURE_REFRESH      0x20    // REFRESH# is wired
+#define ISA_FEATURE_IOCHRDY      0x40    // IOCHRDY is wired
+
+#define ISA_ROW_DMA_TC      0x80    // Row detail: terminal count seen in the DMA cycle
+
+/*********************************************************
+        Types
+*********************************************************/
+
+// ISA state machine states
+enum ISA_STATE {
+    ISA_STATE_IDLE,
+    ISA_STATE_T1,         // First clock cycle of bus cycle
+    ISA_STATE_T2,         // Second clock cycle of bus cycle - data transfer
+    ISA_STATE_TW,         // Wait states
+    ISA_STATE_T3,         // Third and final clock cycle of bus cycle
+    ISA_STATE_DMA_ACTIVE, // DMA cycle in progress
+    ISA_STATE_REFRESH     // Memory refresh cycle
+};
+
+// ISA transaction types
+enum ISA_TRANSACTION_TYPE {
+    ISA_TRANS_NONE,
+    ISA_TRANS_IO_READ_BYTE,    // 8-bit I/O read
+    ISA_TRANS_IO_READ_WORD,    // 16-bit I/O read
+    ISA_TRANS_IO_WRITE_BYTE,   // 8-bit I/O write
+    ISA_TRANS_IO_WRITE_WORD,   // 16-bit I/O write
+    ISA_TRANS_MEM_READ_BYTE,   // 8-bit memory read
+    ISA_TRANS_MEM_READ_WORD,   // 16-bit memory read
+    ISA_TRANS_MEM_WRITE_BYTE,  // 8-bit memory write
+    ISA_TRANS_MEM_WRITE_WORD,  // 16-bit memory write
+    ISA_TRANS_DMA_READ_BYTE,   // 8-bit DMA read
+    ISA_TRANS_DMA_READ_WORD,   // 16-bit DMA read
+    ISA_TRANS_DMA_WRITE_BYTE,  // 8-bit DMA write
+    ISA_TRANS_DMA_WRITE_WORD,  // 16-bit DMA write
+    ISA_TRANS_REFRESH,         // Memory refresh cycle
+    ISA_TRANS_ERROR            // Error condition
+};
+
+// Kinds of result row, each with its own text layout
+enum ISA_ROW_KIND {
+    ISA_ROW_RESET,             // SYSTEM RESET
+    ISA_ROW_TRANSACTION,       // Completed bus cycle
+    ISA_ROW_TIMEOUT,           // Command held too long
+    ISA_ROW_DMA,               // Completed DMA cycle
+    ISA_ROW_REFRESH,           // Completed refresh cycle
+    ISA_ROW_REFRESH_TIMEOUT,   // Refresh held too long
+    ISA_ROW_IRQ,               // Interrupt line raised
+    ISA_ROW_IOCHK,             // IOCHK# asserted
+    ISA_ROW_INCOMPLETE,        // Cycle still open at the end of the capture
+    ISA_ROW_FEATURES,          // Auto-detected feature set
+    ISA_ROW_GLITCHES           // Pulses removed by the glitch filter
+};
+
+typedef struct TISAData
+{
+    // Transaction information
+    int sequence;             // Starting sequence number
+    int last_sequence;        // Ending sequence number
+    int state;                // Current state in ISA state machine
+    int transaction_type;     // Type of ISA transaction
+    uint32_t address;         // ISA bus address (up to 24 bits)
+    uint16_t data;            // ISA bus data (8 or 16 bits)
+
+    // Signal state tracking
+    int ior_active;           // IOR# is active (low) - was bool
+    int iow_active;           // IOW# is active (low) - was bool
+    int memr_active;          // MEMR# is active (low) - was bool
+    int memw_active;          // MEMW# is active (low) - was bool
+    int refresh_active;       // REFRESH# is active (low) - was bool
+    int master_active;        // MASTER# is active (low) - was bool
+    int sbhe_active;          // SBHE# is active (low) - was bool
+    int iochrdy_active;       // IOCHRDY is active (high) - was bool
+    int aen_active;           // AEN is active (high) - was bool
+
+    // DMA and IRQ tracking
+    int active_dma_channel;   // Active DMA channel (0-7, -1 if none)
+    int active_irq_line;      // Active IRQ line (0-15, -1 if none)
+    int tc_active;            // Terminal Count is active - was bool
+
+    // Transaction attributes
+    int wait_states;          // Number of wait states in current transaction
+    int is_16bit;             // Is this a 16-bit transaction? - was bool
+
+    // Address decoding
+    int use_io_space;         // I/O space (vs memory space) - was bool
+    int port_access;          // Specifically for I/O port access - was bool
+
+    // Timing and error tracking
+    int bus_timing_cycles;    // Bus cycles for timing verification
+    uint64_t start_time_ps;   // Transaction start time (picoseconds)
+    uint64_t end_time_ps;     // Transaction end time (picoseconds)
+    int timed_out;            // Transaction timed out - was bool
+    int protocol_error;       // Protocol violation detected - was bool
+    char error_message[64];   // Error message if applicable
+
+} TISAData;
+
+// ISA address and data structure for tracking component states
+typedef struct TISABusData {
+    int addr_latch_state;     // 0 = not latched, 1 = partially latched, 2 = fully latched
+    uint32_t partial_addr;    // Address accumulator during latching
+    uint32_t latched_addr;    // Fully latched address
+    uint16_t pending_data;    // Data accumulator during data phase
+    uint16_t data;            // Completed data transfer
+    int addr_valid;           // Address has been validated - was bool
+    int data_valid;           // Data has been validated - was bool
+    int bus_width;            // Current bus width (8 or 16 bits)
+} TISABusData;
+
+// Signal levels a pass carries from the last sample it decoded, so a pass
+// over the samples after it continues exactly where that one stopped
+typedef struct TISACarry
+{
+    int continued;            // The levels belong to the sample before next_seq
+    int next_seq;
+    uint32_t prev_ctrl_signals; // Control group, as the glitch filter passed it
+    uint32_t prev_address;
+    uint32_t prev_data;
+    uint32_t prev_irq_signals;
+    int bclk_cycles;          // BCLK cycles seen by the pass
+} TISACarry;
+
+// Whole decoder state before sample carry.next_seq (see checkpoint.h)
+typedef struct TISACheckpoint
+{
+    TISAData cycle;
+    TISABusData bus;
+    TISACarry carry;
+    uint32_t glitch_out;      // Glitch filter carry, when the filter is on
+    uint32_t glitch_dev;
+} TISACheckpoint;
+
+// One block of samples as the fetch stage hands it to the state machine
+struct TISASampleBlock
+{
+    int first;                // Sequence of the first sample
+    int count;
+    int bclk_edges;           // BCLK rising edges in the block
+    uint32_t ctrl[BITPLANE_BLOCK];      // Control group, through the glitch filter
+    uint32_t address[BITPLANE_BLOCK];   // Only in the words marked in bus_read
+    uint32_t data[BITPLANE_BLOCK];
+    uint32_t dma[BITPLANE_BLOCK];       // Layouts with DACK lines
+    unsigned char bus_read[BITPLANE_WORDS]; // Address, data and DMA read for the 64 samples
+    uint64_t idle_events[BITPLANE_WORDS]; // Samples that can leave the idle state
+    TBitPlanes ctrl_planes;
+    TBitPlanes irq_planes;    // Layouts with IRQ lines
+};
+
+typedef TPipeline<TISASampleBlock> TISAPipeline;
+
+// Receives each row the state machine completes. detail is the DMA channel
+// | ISA_ROW_DMA_TC, the IRQ line, or whether the address of an incomplete
+// cycle was latched.
+typedef void (*TISARowSink)(int seq_number, int kind, int trans_type, int error_flag,
+                            uint32_t address, uint16_t data, int count, int detail);
+
+// What a decode pass works on: the package's state and settings
+typedef struct TISAEngineContext
+{
+    struct pctx *pctx;
+    int capture_first;        // First sample of the capture
+    int capture_last;         // Last sample of the capture
+    TISAData *cycle;          // Bus cycle in flight, carried from pass to pass
+    TISABusData *bus;         // Address and data latched for it
+    TISACarry *carry;         // Signal levels, carried from pass to pass
+    int dma_support;          // Decode DMA cycles (layouts with DACK lines)
+    int refresh_support;      // Decode refresh cycles
+    int irq_support;          // Report interrupt requests (layouts with IRQ lines)
+    int error_detection;      // Report timeouts and IOCHK#
+    TGlitchFilter *glitch_filter; // Applied to the control group, NULL when off
+    TISAPipeline *pipeline;   // Blocks between the fetch stage and the state machine
+    TISARowSink add_row;
+} TISAEngineContext;
+
+// Where the fetch stage of a pass is
+typedef struct TISAFetchState
+{
+    const TISAEngineContext *ctx;
+    int next_seq;             // First sample of the next block
+    int lastseq;              // Last sample of the pass
+    uint32_t prev_ctrl_signals; // Last sample of the block before
+    uint32_t prev_irq_signals;
+    int bus_active;           // The last word of the block before had bus activity
+} TISAFetchState;
+
+/*********************************************************
+        Helpers
+*********************************************************/
+// Helper to check if the given value is active low (normally high)
+static inline int IsActiveLow(uint32_t signal, uint32_t value)
+{
+    return (value & signal) == 0 ? MY_TRUE : MY_FALSE;
+}
+
+// Helper to check if the given value is active high (normally low)
+static inline int IsActiveHigh(uint32_t signal, uint32_t value)
+{
+    return (value & signal) != 0 ? MY_TRUE : MY_FALSE;
+}
+
+// Helper function to determine if a transaction is 16-bit
+static inline int Is16BitTransaction(int trans_type)
+{
+    switch (trans_type)
+    {
+        case ISA_TRANS_IO_READ_WORD:
+        case ISA_TRANS_IO_WRITE_WORD:
+        case ISA_TRANS_MEM_READ_WORD:
+        case ISA_TRANS_MEM_WRITE_WORD:
+        case ISA_TRANS_DMA_READ_WORD:
+        case ISA_TRANS_DMA_WRITE_WORD:
+            return MY_TRUE;
+        default:
+            return MY_FALSE;
+    }
+}
+
+/*********************************************************
+        ISA decoder
+*********************************************************/
+// Decode pass over the capture. LAYOUT is the package's layout descriptor;
+// FEATURES is a combination of ISA_FEATURE_16BIT, _20BIT_ADDR, _24BIT_ADDR,
+// _REFRESH and _IOCHRDY, so optional signals that are not wired and bus
+// widths that are not enabled cost nothing inside the sample loop.
+template <class LAYOUT, int FEATURES>
+struct TISAEngine
+{
+    static void decode(const TISAEngineContext& ctx, int firstseq, int lastseq);
+
+    // Fetch stage: read, filter and slice the next block of a pass
+    static bool fetch(void *arg, TISASampleBlock& block);
+
+    // Read the address, data and DMA groups for the samples of word w
+    static void read_bus(const TISAEngineContext& ctx, TISASampleBlock& block, int w);
+
+    // Active DMA channel from the DACKn# lines, -1 if none
+    static int dma_channel(uint32_t value)
+    {
+        if (LAYOUT::DACK0 != 0 && IsActiveLow(LAYOUT::DACK0, value)) return 0;
+        if (LAYOUT::DACK1 != 0 && IsActiveLow(LAYOUT::DACK1, value)) return 1;
+        if (LAYOUT::DACK2 != 0 && IsActiveLow(LAYOUT::DACK2, value)) return 2;
+        if (LAYOUT::DACK3 != 0 && IsActiveLow(LAYOUT::DACK3, value)) return 3;
+        if (LAYOUT::DACK5 != 0 && IsActiveLow(LAYOUT::DACK5, value)) return 5;
+        if (LAYOUT::DACK6 != 0 && IsActiveLow(LAYOUT::DACK6, value)) return 6;
+        if (LAYOUT::DACK7 != 0 && IsActiveLow(LAYOUT::DACK7, value)) return 7;
+        return -1;
+    }
+
+    // Lowest active IRQ line, -1 if none
+    static int irq_line(uint32_t value)
+    {
+        if (IsActiveHigh(LAYOUT::IRQ2, value)) return 2;
+        if (IsActiveHigh(LAYOUT::IRQ3, value)) return 3;
+        if (IsActiveHigh(LAYOUT::IRQ4, value)) return 4;
+        if (IsActiveHigh(LAYOUT::IRQ5, value)) return 5;
+        if (IsActiveHigh(LAYOUT::IRQ6, value)) return 6;
+        if (IsActiveHigh(LAYOUT::IRQ7, value)) return 7;
+        if (IsActiveHigh(LAYOUT::IRQ9, value)) return 9;
+        if (IsActiveHigh(LAYOUT::IRQ10, value)) return 10;
+        if (IsActiveHigh(LAYOUT::IRQ11, value)) return 11;
+        if (IsActiveHigh(LAYOUT::IRQ12, value)) return 12;
+        if (IsActiveHigh(LAYOUT::IRQ14, value)) return 14;
+        if (IsActiveHigh(LAYOUT::IRQ15, value)) return 15;
+        return -1;
+    }
+};
+
+template <class LAYOUT, int FEATURES>
+void TISAEngine<LAYOUT, FEATURES>::decode(const TISAEngineContext& ctx, int firstseq, int lastseq)
+{
+    const int has_16bit = (FEATURES & ISA_FEATURE_16BIT) != 0;
+    const int has_refresh = (FEATURES & ISA_FEATURE_REFRESH) != 0;
+    const int has_iochrdy = (FEATURES & ISA_FEATURE_IOCHRDY) != 0;
+    const int has_dma = LAYOUT::DMA_GROUP >= 0;
+    const int has_irq = LAYOUT::IRQ_GROUP >= 0;
+    const uint16_t data_mask = has_16bit ? 0xFFFF : 0xFF;
+    const uint32_t addr_mask = (FEATURES & ISA_FEATURE_24BIT_ADDR) ? 0xFFFFFF :
+                               (FEATURES & ISA_FEATURE_20BIT_ADDR) ? 0xFFFFF : 0xFFFF;
+
+    struct pctx *pctx = ctx.pctx;
+    TISAData& cycle = *ctx.cycle;
+    TISABusData& bus = *ctx.bus;
+
+    // Previous signal states for edge detection. A pass following on from
+    // the last one continues with its levels; one starting anywhere else
+    // inside the capture picks them up from the sample before it.
+    TISACarry& carry = *ctx.carry;
+    uint32_t prev_ctrl_signals = 0;
+    uint32_t prev_address = 0;
+    uint32_t prev_data = 0;
+    uint32_t prev_irq_signals = 0;
+    int bclk_cycles = 0; // Counter for BCLK cycles
+    if (carry.continued && carry.next_seq == firstseq)
+    {
+        prev_ctrl_signals = carry.prev_ctrl_signals;
+        prev_address = carry.prev_address;
+        prev_data = carry.prev_data;
+        prev_irq_signals = carry.prev_irq_signals;
+        bclk_cycles = carry.bclk_cycles;
+    }
+    else if (firstseq > ctx.capture_first)
+    {
+        prev_ctrl_signals = pctx->func.LAGroupValue(pctx->lactx, firstseq - 1, LAYOUT::CONTROL_GROUP);
+        if (ctx.glitch_filter != NULL)
+        {
+            prev_ctrl_signals = ctx.glitch_filter->previous(firstseq, prev_ctrl_signals);
+        }
+        prev_address = pctx->func.LAGroupValue(pctx->lactx, firstseq - 1, LAYOUT::ADDR_GROUP);
+        prev_data = pctx->func.LAGroupValue(pctx->lactx, firstseq - 1, LAYOUT::DATA_GROUP) & data_mask;
+        if (has_irq)
+        {
+            prev_irq_signals = pctx->func.LAGroupValue(pctx->lactx, firstseq - 1, LAYOUT::IRQ_GROUP);
+        }
+    }
+
+    // An interrupt already pending was reported by the pass before. With
+    // IRQ_SUPPORT on the line always follows the levels, so this also holds
+    // for a pass resumed from a checkpoint taken with it off.
+    if (has_irq && firstseq > ctx.capture_first)
+    {
+        cycle.active_irq_line = irq_line(prev_irq_signals);
+    }
+
+    // The fetch stage reads the groups a block at a time, the control group
+    // through the glitch filter when it is on, and slices the control and
+    // IRQ groups into bit-planes. In the idle state only reset, ALE rising,
+    // a strobe falling, IOCHK# and an IRQ change do anything; the planes
+    // give the next such sample, and the samples before it are skipped.
+    // The address, data and DMA groups are only read around those samples
+    // and wherever a strobe or ALE is active. Should a bus cycle still be
+    // open past them, the state machine reads the rest itself.
+    TISAFetchState fetch_state;
+    fetch_state.ctx = &ctx;
+    fetch_state.next_seq = firstseq;
+    fetch_state.lastseq = lastseq;
+    fetch_state.prev_ctrl_signals = prev_ctrl_signals;
+    fetch_state.prev_irq_signals = prev_irq_signals;
+    fetch_state.bus_active = cycle.state != ISA_STATE_IDLE;
+    ctx.pipeline->start(fetch, &fetch_state);
+
+    TISASampleBlock *block = NULL;
+    int block_first = firstseq;
+    int block_end = firstseq;
+
+    // Now loop through all the samples
+    for (int seq = firstseq; seq <= lastseq; seq++)
+    {
+        if (seq == block_end)
+        {
+            if (block != NULL)
+            {
+                ctx.pipeline->release();
+            }
+            block = ctx.pipeline->next();
+            block_first = block->first;
+            block_end = block->first + block->count;
+            bclk_cycles += block->bclk_edges;
+            LogDebug(pctx, 7, "Samples %d-%d: %d BCLK cycles so far", seq, block_end - 1, bclk_cycles);
+        }
+
+        // Get signal values for each group
+        int index = seq - block_first;
+        if (!block->bus_read[index / 64])
+        {
+            ctx.pipeline->lock_host();
+            read_bus(ctx, *block, index / 64);
+            ctx.pipeline->unlock_host();
+        }
+        uint32_t ctrl_signals = block->ctrl[index];
+        uint32_t address = block->address[index];
+        uint16_t data = block->data[index] & data_mask;
+        uint32_t dma_signals = has_dma ? block->dma[index] : 0;
+        uint32_t irq_signals = has_irq ? block->irq_planes.sample(index) : 0;
+
+        LogDebug(pctx, 5, "Seq: %d, Ctrl: 0x%08X, Addr: 0x%08X, Data: 0x%04X, DMA: 0x%08X, IRQ: 0x%08X",
+                 seq, ctrl_signals, address, data, dma_signals, irq_signals);
+
+        // Decode control signals
+        int bclk = IsActiveHigh(LAYOUT::BCLK, ctrl_signals);
+        int ale = IsActiveHigh(LAYOUT::ALE, ctrl_signals);
+        int ior = IsActiveLow(LAYOUT::IOR, ctrl_signals);
+        int iow = IsActiveLow(LAYOUT::IOW, ctrl_signals);
+        int memr = IsActiveLow(LAYOUT::MEMR, ctrl_signals);
+        int memw = IsActiveLow(LAYOUT::MEMW, ctrl_signals);
+        int aen = IsActiveHigh(LAYOUT::AEN, ctrl_signals);
+        int reset = IsActiveHigh(LAYOUT::RESET, ctrl_signals);
+
+        // Optional signals; lines that are not wired read as inactive (IOCHRDY as ready)
+        int refresh = has_refresh ? IsActiveLow(LAYOUT::REFRESH, ctrl_signals) : 0;
+        int sbhe = has_16bit ? IsActiveLow(LAYOUT::SBHE, ctrl_signals) : 0;
+        int iochrdy = has_iochrdy ? IsActiveHigh(LAYOUT::IOCHRDY, ctrl_signals) : 1;
+        int master = LAYOUT::MASTER != 0 ? IsActiveLow(LAYOUT::MASTER, ctrl_signals) : 0;
+        int iochk = LAYOUT::IOCHK != 0 ? IsActiveLow(LAYOUT::IOCHK, ctrl_signals) : 0;
+
+        // Decode DMA signals
+        int tc = has_dma ? IsActiveHigh(LAYOUT::TC, dma_signals) : 0;
+        int active_dma_channel = has_dma ? dma_channel(dma_signals) : -1;
+
+        // Decode IRQ signals
+        int active_irq_line = has_irq ? irq_line(irq_signals) : -1;
+
+        // Edge detection
+        int bclk_rising_edge = bclk && !IsActiveHigh(LAYOUT::BCLK, prev_ctrl_signals);
+        int ale_rising_edge = ale && !IsActiveHigh(LAYOUT::ALE, prev_ctrl_signals);
+        int ale_falling_edge = !ale && IsActiveHigh(LAYOUT::ALE, prev_ctrl_signals);
+
+        int ior_falling_edge = ior && !IsActiveLow(LAYOUT::IOR, prev_ctrl_signals);
+        int iow_falling_edge = iow && !IsActiveLow(LAYOUT::IOW, prev_ctrl_signals);
+        int memr_falling_edge = memr && !IsActiveLow(LAYOUT::MEMR, prev_ctrl_signals);
+        int memw_falling_edge = memw && !IsActiveLow(LAYOUT::MEMW, prev_ctrl_signals);
+        int prev_refresh = has_refresh ? IsActiveLow(LAYOUT::REFRESH, prev_ctrl_signals) : 0;
+        int refresh_falling_edge = refresh && !prev_refresh;
+
+        int ior_rising_edge = !ior && IsActiveLow(LAYOUT::IOR, prev_ctrl_signals);
+        int iow_rising_edge = !iow && IsActiveLow(LAYOUT::IOW, prev_ctrl_signals);
+        int memr_rising_edge = !memr && IsActiveLow(LAYOUT::MEMR, prev_ctrl_signals);
+        int memw_rising_edge = !memw && IsActiveLow(LAYOUT::MEMW, prev_ctrl_signals);
+        int refresh_rising_edge = !refresh && prev_refresh;
+
+        // ISA bus state machine
+        switch (cycle.state)
+        {
+            case ISA_STATE_IDLE:
+                if (reset)
+                {
+                    // System reset detected
+                    LogDebug(pctx, 0, "SYSTEM RESET detected");
+                    ctx.add_row(seq, ISA_ROW_RESET, ISA_TRANS_NONE, 0, 0, 0, 0, 0);
+                    continue; // Skip further processing during reset
+                }
+
+                // Initialize transaction data
+                if (ale_rising_edge || ior_falling_edge || iow_falling_edge ||
+                    memr_falling_edge || memw_falling_edge || refresh_falling_edge)
+                {
+                    LogDebug(pctx, 1, "Starting new transaction");
+
+                    // Initialize new transaction
+                    cycle.sequence = seq;
+                    cycle.last_sequence = seq;
+                    cycle.state = ISA_STATE_T1;
+                    cycle.wait_states = 0;
+                    cycle.bus_timing_cycles = 0;
+                    cycle.is_16bit = sbhe;
+                    cycle.start_time_ps = 0; // Would use timestamp here if available
+                    cycle.timed_out = 0;
+                    cycle.protocol_error = 0;
+
+                    // Track active command signals
+                    cycle.ior_active = ior;
+                    cycle.iow_active = iow;
+                    cycle.memr_active = memr;
+                    cycle.memw_active = memw;
+                    cycle.refresh_active = refresh;
+                    cycle.master_active = master;
+                    cycle.sbhe_active = sbhe;
+                    cycle.iochrdy_active = iochrdy;
+                    cycle.aen_active = aen;
+
+                    // Capture address (first part from address lines)
+                    bus.addr_latch_state = 1;
+                    bus.partial_addr = address & addr_mask;
+                    bus.addr_valid = 0;
+                    bus.data_valid = 0;
+
+                    // Determine if this is a DMA cycle
+                    if (active_dma_channel != -1 && ctx.dma_support)
+                    {
+                        cycle.state = ISA_STATE_DMA_ACTIVE;
+                        cycle.active_dma_channel = active_dma_channel;
+                        cycle.tc_active = tc;
+                        LogDebug(pctx, 1, "DMA cycle for channel %d detected", active_dma_channel);
+                    }
+                    // Check for refresh cycle
+                    else if (refresh && ctx.refresh_support)
+                    {
+                        cycle.state = ISA_STATE_REFRESH;
+                        cycle.transaction_type = ISA_TRANS_REFRESH;
+                        LogDebug(pctx, 1, "Memory refresh cycle detected");
+                    }
+                    // Normal bus cycle
+                    else
+                    {
+                        // Determine the transaction type
+                        if (ior)
+                        {
+                            cycle.transaction_type = sbhe ? ISA_TRANS_IO_READ_WORD : ISA_TRANS_IO_READ_BYTE;
+                            cycle.use_io_space = 1;
+                            LogDebug(pctx, 1, "I/O Read (%d-bit) transaction started", sbhe ? 16 : 8);
+                        }
+                        else if (iow)
+                        {
+                            cycle.transaction_type = sbhe ? ISA_TRANS_IO_WRITE_WORD : ISA_TRANS_IO_WRITE_BYTE;
+                            cycle.use_io_space = 1;
+                            LogDebug(pctx, 1, "I/O Write (%d-bit) transaction started", sbhe ? 16 : 8);
+                        }
+                        else if (memr)
+                        {
+                            cycle.transaction_type = sbhe ? ISA_TRANS_MEM_READ_WORD : ISA_TRANS_MEM_READ_BYTE;
+                            cycle.use_io_space = 0;
+                            LogDebug(pctx, 1, "Memory Read (%d-bit) transaction started", sbhe ? 16 : 8);
+                        }
+                        else if (memw)
+                        {
+                            cycle.transaction_type = sbhe ? ISA_TRANS_MEM_WRITE_WORD : ISA_TRANS_MEM_WRITE_BYTE;
+                            cycle.use_io_space = 0;
+                            LogDebug(pctx, 1, "Memory Write (%d-bit) transaction started", sbhe ? 16 : 8);
+                        }
+                        else
+                        {
+                            // No command line active - could be address latch only
+                            cycle.transaction_type = ISA_TRANS_NONE;
+                            LogDebug(pctx, 1, "Address latch or unknown transaction");
+                        }
+                    }
+                }
+                break;
+
+            case ISA_STATE_T1:
+                // T1 state - Address phase
+                if (ale_falling_edge)
+                {
+                    // Address latch complete on falling edge of ALE
+                    bus.addr_latch_state = 2;
+                    bus.latched_addr = bus.partial_addr;
+                    bus.addr_valid = 1;
+                    cycle.address = bus.latched_addr & addr_mask;
+                    LogDebug(pctx, 2, "Address latched: 0x%08X", cycle.address);
+                }
+
+                // Check for command signals (normally asserted in T1 state)
+                if (ior_falling_edge || iow_falling_edge || memr_falling_edge || memw_falling_edge)
+                {
+                    // Update transaction type if it wasn't determined yet
+                    if (cycle.transaction_type == ISA_TRANS_NONE)
+                    {
+                        if (ior_falling_edge)
+                        {
+                            cycle.transaction_type = sbhe ? ISA_TRANS_IO_READ_WORD : ISA_TRANS_IO_READ_BYTE;
+                            cycle.use_io_space = 1;
+                        }
+                        else if (iow_falling_edge)
+                        {
+                            cycle.transaction_type = sbhe ? ISA_TRANS_IO_WRITE_WORD : ISA_TRANS_IO_WRITE_BYTE;
+                            cycle.use_io_space = 1;
+                        }
+                        else if (memr_falling_edge)
+                        {
+                            cycle.transaction_type = sbhe ? ISA_TRANS_MEM_READ_WORD : ISA_TRANS_MEM_READ_BYTE;
+                            cycle.use_io_space = 0;
+                        }
+                        else if (memw_falling_edge)
+                        {
+                            cycle.transaction_type = sbhe ? ISA_TRANS_MEM_WRITE_WORD : ISA_TRANS_MEM_WRITE_BYTE;
+                            cycle.use_io_space = 0;
+                        }
+
+                        LogDebug(pctx, 2, "Transaction type updated to %d", cycle.transaction_type);
+                    }
+                }
+
+                // Move to T2 state on the next BCLK rising edge
+                if (bclk_rising_edge)
+                {
+                    cycle.state = ISA_STATE_T2;
+                    cycle.bus_timing_cycles++;
+                    LogDebug(pctx, 2, "Advancing to T2 state");
+                }
+                break;
+
+            case ISA_STATE_T2:
+                // T2 state - Data phase
+                if (bclk_rising_edge)
+                {
+                    cycle.bus_timing_cycles++;
+
+                    // Check for IOCHRDY (wait state insertion)
+                    if (!iochrdy)
+                    {
+                        cycle.state = ISA_STATE_TW;
+                        LogDebug(pctx, 2, "Wait state inserted (IOCHRDY inactive)");
+                    }
+                    else
+                    {
+                        // Capture data on rising edge of T2 for write operations
+                        if (cycle.transaction_type == ISA_TRANS_IO_WRITE_BYTE ||
+                            cycle.transaction_type == ISA_TRANS_IO_WRITE_WORD ||
+                            cycle.transaction_type == ISA_TRANS_MEM_WRITE_BYTE ||
+                            cycle.transaction_type == ISA_TRANS_MEM_WRITE_WORD)
+                        {
+                            // For write operations, data should be valid during T2
+                            bus.data = data;
+                            bus.data_valid = 1;
+                            cycle.data = data;
+                            LogDebug(pctx, 2, "Data captured for write operation: 0x%04X", data);
+                        }
+
+                        // Move to T3 state
+                        cycle.state = ISA_STATE_T3;
+                        LogDebug(pctx, 2, "Advancing to T3 state");
+                    }
+                }
+
+                // For read operations, check data availability
+                if ((cycle.transaction_type == ISA_TRANS_IO_READ_BYTE ||
+                     cycle.transaction_type == ISA_TRANS_IO_READ_WORD ||
+                     cycle.transaction_type == ISA_TRANS_MEM_READ_BYTE ||
+                     cycle.transaction_type == ISA_TRANS_MEM_READ_WORD) &&
+                    data != prev_data)
+                {
+                    // Data changed, might be target providing data
+                    bus.pending_data = data;
+                    LogDebug(pctx, 5, "Potential data seen: 0x%04X", data);
+                }
+                break;
+
+            case ISA_STATE_TW:
+                // TW state - Wait states
+                if (bclk_rising_edge)
+                {
+                    cycle.bus_timing_cycles++;
+                    cycle.wait_states++;
+
+                    // Check if wait state is released
+                    if (iochrdy)
+                    {
+                        cycle.state = ISA_STATE_T3;
+                        LogDebug(pctx, 2, "Wait state released, advancing to T3 (total wait states: %d)",
+                                 cycle.wait_states);
+                    }
+                    else
+                    {
+                        LogDebug(pctx, 5, "Still in wait state (%d)", cycle.wait_states);
+                    }
+                }
+
+                // Check for timeout condition
+                if (cycle.wait_states > 20 && ctx.error_detection)
+                {
+                    cycle.timed_out = 1;
+                    cycle.protocol_error = 1;
+                    snprintf(cycle.error_message, sizeof(cycle.error_message),
+                             "Excessive wait states (%d) - possible timeout", cycle.wait_states);
+                    LogDebug(pctx, 0, "ERROR: %s", cycle.error_message);
+
+                    // Force to T3 to complete transaction
+                    cycle.state = ISA_STATE_T3;
+                }
+                break;
+
+            case ISA_STATE_T3:
+                // T3 state - Completion phase
+                if (bclk_rising_edge)
+                {
+                    cycle.bus_timing_cycles++;
+
+                    // For read operations, data should be valid during T3
+                    if ((cycle.transaction_type == ISA_TRANS_IO_READ_BYTE ||
+                         cycle.transaction_type == ISA_TRANS_IO_READ_WORD ||
+                         cycle.transaction_type == ISA_TRANS_MEM_READ_BYTE ||
+                         cycle.transaction_type == ISA_TRANS_MEM_READ_WORD) &&
+                        !bus.data_valid)
+                    {
+                        bus.data = data;
+                        bus.data_valid = 1;
+                        cycle.data = data;
+                        LogDebug(pctx, 2, "Data captured for read operation: 0x%04X", data);
+                    }
+                }
+
+                // Check for command signal deassertion to mark the end of transaction
+                if (ior_rising_edge || iow_rising_edge || memr_rising_edge || memw_rising_edge)
+                {
+                    // Command signals deasserted, transaction is complete
+                    cycle.last_sequence = seq;
+                    cycle.end_time_ps = 0; // Would use timestamp here if available
+
+                    // Record the transaction, with 8-bit vs 16-bit data
+                    uint16_t row_data;
+                    if (Is16BitTransaction(cycle.transaction_type))
+                        row_data = bus.data_valid ? cycle.data : 0xFFFF;
+                    else
+                        row_data = bus.data_valid ? (cycle.data & 0xFF) : 0xFF;
+
+                    ctx.add_row(cycle.sequence, ISA_ROW_TRANSACTION, cycle.transaction_type,
+                                cycle.protocol_error, cycle.address, row_data, cycle.wait_states, 0);
+
+                    // Reset for next transaction
+                    cycle.state = ISA_STATE_IDLE;
+                    cycle.transaction_type = ISA_TRANS_NONE;
+                    LogDebug(pctx, 1, "Transaction completed");
+                }
+
+                // Check for timeout (if commands stay asserted for too long)
+                if (cycle.bus_timing_cycles > 10 && ctx.error_detection)
+                {
+                    cycle.timed_out = 1;
+                    cycle.protocol_error = 1;
+                    snprintf(cycle.error_message, sizeof(cycle.error_message),
+                             "Command signals remain asserted too long - possible timeout");
+                    LogDebug(pctx, 0, "ERROR: %s", cycle.error_message);
+
+                    // Create an error entry and reset state machine
+                    ctx.add_row(cycle.sequence, ISA_ROW_TIMEOUT, cycle.transaction_type, 1,
+                                cycle.address, 0, cycle.bus_timing_cycles, 0);
+
+                    // Reset for next transaction
+                    cycle.state = ISA_STATE_IDLE;
+                    cycle.transaction_type = ISA_TRANS_NONE;
+                }
+                break;
+
+            case ISA_STATE_DMA_ACTIVE:
+                // DMA cycle processing
+                if (active_dma_channel != cycle.active_dma_channel)
+                {
+                    // DMA channel changed or deactivated
+                    if (cycle.active_dma_channel != -1)
+                    {
+                        // Complete previous DMA transaction
+                        LogDebug(pctx, 1, "DMA channel %d cycle completed", cycle.active_dma_channel);
+
+                        // Determine DMA transaction type
+                        if (cycle.transaction_type == ISA_TRANS_NONE)
+                        {
+                            if (cycle.memr_active)
+                                cycle.transaction_type = cycle.is_16bit ? ISA_TRANS_DMA_READ_WORD : ISA_TRANS_DMA_READ_BYTE;
+                            else if (cycle.memw_active)
+                                cycle.transaction_type = cycle.is_16bit ? ISA_TRANS_DMA_WRITE_WORD : ISA_TRANS_DMA_WRITE_BYTE;
+                            else if (cycle.ior_active)
+                                cycle.transaction_type = cycle.is_16bit ? ISA_TRANS_DMA_READ_WORD : ISA_TRANS_DMA_READ_BYTE;
+                            else if (cycle.iow_active)
+                                cycle.transaction_type = cycle.is_16bit ? ISA_TRANS_DMA_WRITE_WORD : ISA_TRANS_DMA_WRITE_BYTE;
+                        }
+
+                        ctx.add_row(cycle.sequence, ISA_ROW_DMA, cycle.transaction_type,
+                                    cycle.protocol_error, cycle.address,
+                                    bus.data_valid ? cycle.data : 0xFFFF, 0,
+                                    cycle.active_dma_channel | (cycle.tc_active ? ISA_ROW_DMA_TC : 0));
+
+                        // Reset for next transaction
+                        cycle.state = ISA_STATE_IDLE;
+                        cycle.transaction_type = ISA_TRANS_NONE;
+                        cycle.active_dma_channel = -1;
+                    }
+
+                    // Start new DMA transaction if applicable
+                    if (active_dma_channel != -1)
+                    {
+                        cycle.sequence = seq;
+                        cycle.active_dma_channel = active_dma_channel;
+                        cycle.tc_active = tc;
+                        LogDebug(pctx, 1, "New DMA channel %d cycle started", active_dma_channel);
+                    }
+                }
+
+                // Process DMA read/write operations
+                if (cycle.active_dma_channel != -1)
+                {
+                    // Monitor command signals for DMA access type
+                    if (ior && !cycle.ior_active)
+                    {
+                        cycle.ior_active = 1;
+                        LogDebug(pctx, 2, "DMA I/O Read active");
+                    }
+                    if (iow && !cycle.iow_active)
+                    {
+                        cycle.iow_active = 1;
+                        LogDebug(pctx, 2, "DMA I/O Write active");
+                    }
+                    if (memr && !cycle.memr_active)
+                    {
+                        cycle.memr_active = 1;
+                        LogDebug(pctx, 2, "DMA Memory Read active");
+                    }
+                    if (memw && !cycle.memw_active)
+                    {
+                        cycle.memw_active = 1;
+                        LogDebug(pctx, 2, "DMA Memory Write active");
+                    }
+
+                    // Capture DMA address and data
+                    if (!bus.addr_valid && address != prev_address)
+                    {
+                        cycle.address = address & addr_mask;
+                        bus.addr_valid = 1;
+                        LogDebug(pctx, 2, "DMA Address captured: 0x%08X", cycle.address);
+                    }
+
+                    if (!bus.data_valid && data != prev_data)
+                    {
+                        cycle.data = data;
+                        bus.data_valid = 1;
+                        LogDebug(pctx, 2, "DMA Data captured: 0x%04X", data);
+                    }
+
+                    // Check for Terminal Count to end DMA transfer
+                    if (tc && !cycle.tc_active)
+                    {
+                        cycle.tc_active = 1;
+                        LogDebug(pctx, 1, "DMA Terminal Count asserted");
+                    }
+                }
+                break;
+
+            case ISA_STATE_REFRESH:
+                // Memory refresh cycle
+                if (bclk_rising_edge)
+                {
+                    cycle.bus_timing_cycles++;
+                }
+
+                // Check for refresh signal deassertion to mark the end
+                if (refresh_rising_edge)
+                {
+                    cycle.last_sequence = seq;
+
+                    // Create sequence entry for refresh cycle
+                    ctx.add_row(cycle.sequence, ISA_ROW_REFRESH, ISA_TRANS_REFRESH, 0,
+                                0, 0, cycle.bus_timing_cycles, 0);
+
+                    // Reset for next transaction
+                    cycle.state = ISA_STATE_IDLE;
+                    cycle.transaction_type = ISA_TRANS_NONE;
+                    LogDebug(pctx, 1, "Refresh cycle completed");
+                }
+
+                // Check for timeout
+                if (cycle.bus_timing_cycles > 10 && ctx.error_detection)
+                {
+                    cycle.timed_out = 1;
+                    cycle.protocol_error = 1;
+                    snprintf(cycle.error_message, sizeof(cycle.error_message),
+                             "Refresh cycle too long - possible timeout");
+                    LogDebug(pctx, 0, "ERROR: %s", cycle.error_message);
+
+                    // Create an error entry and reset state machine
+                    ctx.add_row(cycle.sequence, ISA_ROW_REFRESH_TIMEOUT, ISA_TRANS_ERROR, 1,
+                                0, 0, cycle.bus_timing_cycles, 0);
+
+                    // Reset for next transaction
+                    cycle.state = ISA_STATE_IDLE;
+                    cycle.transaction_type = ISA_TRANS_NONE;
+                }
+                break;
+        }
+
+        // Check for interrupt activity (can happen in any state)
+        if (has_irq && active_irq_line != cycle.active_irq_line && ctx.irq_support)
+        {
+            if (active_irq_line != -1 && cycle.active_irq_line == -1)
+            {
+                // New interrupt detected
+                LogDebug(pctx, 1, "Interrupt line %d activated", active_irq_line);
+                ctx.add_row(seq, ISA_ROW_IRQ, ISA_TRANS_NONE, 0, 0, 0, 0, active_irq_line);
+            }
+            else if (active_irq_line == -1 && cycle.active_irq_line != -1)
+            {
+                // Interrupt cleared
+                LogDebug(pctx, 1, "Interrupt line %d cleared", cycle.active_irq_line);
+            }
+
+            cycle.active_irq_line = active_irq_line;
+        }
+
+        // Check for IOCHK errors
+        if (LAYOUT::IOCHK != 0 && iochk && !IsActiveLow(LAYOUT::IOCHK, prev_ctrl_signals) && ctx.error_detection)
+        {
+            LogDebug(pctx, 0, "I/O Channel Check Error (IOCHK#) detected");
+            ctx.add_row(seq, ISA_ROW_IOCHK, ISA_TRANS_ERROR, 1, 0, 0, 0, 0);
+        }
+
+        // Save previous signal states for edge detection in next iteration
+        prev_ctrl_signals = ctrl_signals;
+        prev_address = address;
+        prev_data = data;
+        prev_irq_signals = irq_signals;
+
+        // Skip to the next sample that can leave the idle state; the
+        // address and data before it are not looked at there
+        if (cycle.state == ISA_STATE_IDLE)
+        {
+            int next = TBitPlanes::next(block->idle_events, seq + 1 - block_first, block_end - block_first);
+            if (next > seq + 1 - block_first)
+            {
+                seq = block_first + next - 1;
+                prev_ctrl_signals = block->ctrl[next - 1];
+                prev_irq_signals = has_irq ? block->irq_planes.sample(next - 1) : 0;
+            }
+        }
+    }
+    if (block != NULL)
+    {
+        ctx.pipeline->release();
+    }
+    ctx.pipeline->finish();
+
+    carry.continued = MY_TRUE;
+    carry.next_seq = lastseq + 1;
+    carry.prev_ctrl_signals = prev_ctrl_signals;
+    carry.prev_address = prev_address;
+    carry.prev_data = prev_data;
+    carry.prev_irq_signals = prev_irq_signals;
+    carry.bclk_cycles = bclk_cycles;
+}
+
+template <class LAYOUT, int FEATURES>
+bool TISAEngine<LAYOUT, FEATURES>::fetch(void *arg, TISASampleBlock& block)
+{
+    const int has_refresh = (FEATURES & ISA_FEATURE_REFRESH) != 0;
+    const int has_irq = LAYOUT::IRQ_GROUP >= 0;
+    const uint32_t irq_lines = LAYOUT::IRQ2 | LAYOUT::IRQ3 | LAYOUT::IRQ4 | LAYOUT::IRQ5 |
+                               LAYOUT::IRQ6 | LAYOUT::IRQ7 | LAYOUT::IRQ9 | LAYOUT::IRQ10 |
+                               LAYOUT::IRQ11 | LAYOUT::IRQ12 | LAYOUT::IRQ14 | LAYOUT::IRQ15;
+    const int block_size = BITPLANE_BLOCK < DEGLITCH_BLOCK ? BITPLANE_BLOCK : DEGLITCH_BLOCK;
+
+    TISAFetchState& state = *(TISAFetchState *)arg;
+    const TISAEngineContext& ctx = *state.ctx;
+    struct pctx *pctx = ctx.pctx;
+    int seq = state.next_seq;
+    if (seq > state.lastseq)
+    {
+        return false;
+    }
+    int count = state.lastseq - seq < block_size ? state.lastseq - seq + 1 : block_size;
+    block.first = seq;
+    block.count = count;
+
+    int i;
+    if (ctx.glitch_filter != NULL)
+    {
+        memcpy(block.ctrl, ctx.glitch_filter->load(pctx->func.LAGroupValue, pctx->lactx, LAYOUT::CONTROL_GROUP,
+                                                   seq, count, ctx.capture_last, state.prev_ctrl_signals),
+               count * sizeof(uint32_t));
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
+        {
+            block.ctrl[i] = pctx->func.LAGroupValue(pctx->lactx, seq + i, LAYOUT::CONTROL_GROUP);
+        }
+    }
+    TBitPlanes& ctrl_planes = block.ctrl_planes;
+    ctrl_planes.select(LAYOUT::BCLK | LAYOUT::ALE | LAYOUT::IOR | LAYOUT::IOW | LAYOUT::MEMR |
+                       LAYOUT::MEMW | LAYOUT::RESET | (has_refresh ? LAYOUT::REFRESH : 0) |
+                       (ctx.error_detection ? LAYOUT::IOCHK : 0));
+    ctrl_planes.build(block.ctrl, count, state.prev_ctrl_signals);
+    if (has_irq)
+    {
+        block.irq_planes.select(irq_lines);
+        block.irq_planes.load(pctx->func.LAGroupValue, pctx->lactx, LAYOUT::IRQ_GROUP,
+                              seq, count, state.prev_irq_signals);
+    }
+
+    // Lines that are high while the bus has no cycle running
+    const uint32_t strobes = LAYOUT::IOR | LAYOUT::IOW | LAYOUT::MEMR | LAYOUT::MEMW |
+                             (has_refresh ? LAYOUT::REFRESH : 0);
+
+    block.bclk_edges = 0;
+    for (int w = 0; w < ctrl_planes.words(); w++)
+    {
+        block.bclk_edges += TBitPlanes::population(ctrl_planes.rising(LAYOUT::BCLK, w));
+
+        uint64_t events = ctrl_planes.level(LAYOUT::RESET, w) | ctrl_planes.rising(LAYOUT::ALE, w) |
+                          ctrl_planes.falling(LAYOUT::IOR, w) | ctrl_planes.falling(LAYOUT::IOW, w) |
+                          ctrl_planes.falling(LAYOUT::MEMR, w) | ctrl_planes.falling(LAYOUT::MEMW, w) |
+                          ctrl_planes.falling(LAYOUT::REFRESH, w) | ctrl_planes.falling(LAYOUT::IOCHK, w);
+        if (has_irq && ctx.irq_support)
+        {
+            events |= block.irq_planes.changed(irq_lines, w);
+        }
+        block.idle_events[w] = events;
+
+        // A cycle may run on into the word after the last activity
+        int active = events != 0 ||
+                     (ctrl_planes.valid(w) & ~(ctrl_planes.all(strobes, w) & ~ctrl_planes.level(LAYOUT::ALE, w))) != 0;
+        block.bus_read[w] = 0;
+        if (active || state.bus_active)
+        {
+            read_bus(ctx, block, w);
+        }
+        state.bus_active = active;
+    }
+
+    state.next_seq = seq + count;
+    state.prev_ctrl_signals = block.ctrl[count - 1];
+    state.prev_irq_signals = has_irq ? block.irq_planes.sample(count - 1) : 0;
+    return true;
+}
+
+template <class LAYOUT, int FEATURES>
+void TISAEngine<LAYOUT, FEATURES>::read_bus(const TISAEngineContext& ctx, TISASampleBlock& block, int w)
+{
+    struct pctx *pctx = ctx.pctx;
+    int first = w * 64;
+    int end = block.count - first < 64 ? block.count : first + 64;
+    for (int i = first; i < end; i++)
+    {
+        block.address[i] = pctx->func.LAGroupValue(pctx->lactx, block.first + i, LAYOUT::ADDR_GROUP);
+        block.data[i] = pctx->func.LAGroupValue(pctx->lactx, block.first + i, LAYOUT::DATA_GROUP);
+    }
+    if (LAYOUT::DMA_GROUP >= 0)
+    {
+        for (int i = first; i < end; i++)
+        {
+            block.dma[i] = pctx->func.LAGroupValue(pctx->lactx, block.first + i, LAYOUT::DMA_GROUP);
+        }
+    }
+    block.bus_read[w] = 1;
+}
+
+#endif // ISAENGINE_H
@@ -0,0 +1,233 @@
+// markset.h - Compressed set of user-marked sequences
+#pragma once
+
+#ifndef MARKSET_H
+#define MARKSET_H
+
+#include "stdint.h"
+#include <vector>
+#include <algorithm>
+
+// Sequences are grouped by their upper 16 bits. A group holding up to
+// MARKSET_ARRAY_MAX marks keeps them as a sorted list of the low 16 bits,
+// a fuller one switches to a 65536-bit bitmap (8 KB).
+#define MARKSET_ARRAY_MAX   4096
+#define MARKSET_BITMAP_WORDS (65536 / 32)
+#define MARKSET_SIGNATURE_SAMPLES 64    // Samples hashed to tell captures apart
+
+/*********************************************************
+        Mark set
+*********************************************************/
+// User marks over sequence numbers. Marks belong to one capture: bind()
+// keeps them across re-decodes of the same capture and drops them when a
+// different one is loaded.
+class TMarkSet
+{
+public:
+    TMarkSet() : capture_first(0), capture_last(-1), capture_signature(0) {}
+
+    void clear()
+    {
+        groups.clear();
+    }
+
+    // Attach the marks to a capture, dropping them if it is not the one
+    // they were set on. Returns true if the marks were kept.
+    bool bind(int first, int last, uint32_t signature)
+    {
+        if (first == capture_first && last == capture_last && signature == capture_signature)
+        {
+            return true;
+        }
+        clear();
+        capture_first = first;
+        capture_last = last;
+        capture_signature = signature;
+        return false;
+    }
+
+    void set(int seq, bool on)
+    {
+        uint16_t low = low_bits(seq);
+        size_t i = find_group(high_bits(seq));
+        if (i == groups.size() || groups[i].high != high_bits(seq))
+        {
+            if (!on)
+                return;
+            TGroup group;
+            group.high = high_bits(seq);
+            group.count = 0;
+            groups.insert(groups.begin() + i, group);
+        }
+
+        TGroup& group = groups[i];
+        if (group.bits.empty())
+        {
+            std::vector<uint16_t>::iterator it = std::lower_bound(group.values.begin(), group.values.end(), low);
+            bool present = it != group.values.end() && *it == low;
+            if (on && !present)
+            {
+                group.values.insert(it, low);
+                group.count++;
+                if (group.count > MARKSET_ARRAY_MAX)
+                    to_bitmap(group);
+            }
+            else if (!on && present)
+            {
+                group.values.erase(it);
+                group.count--;
+            }
+        }
+        else
+        {
+            uint32_t mask = 1UL << (low & 31);
+            bool present = (group.bits[low >> 5] & mask) != 0;
+            if (on && !present)
+            {
+                group.bits[low >> 5] |= mask;
+                group.count++;
+            }
+            else if (!on && present)
+            {
+                group.bits[low >> 5] &= ~mask;
+                group.count--;
+                if (group.count <= MARKSET_ARRAY_MAX / 2)
+                    to_array(group);
+            }
+        }
+
+        if (group.count == 0)
+        {
+            groups.erase(groups.begin() + i);
+        }
+    }
+
+    bool test(int seq) const
+    {
+        size_t i = find_group(high_bits(seq));
+        if (i == groups.size() || groups[i].high != high_bits(seq))
+        {
+            return false;
+        }
+
+        const TGroup& group = groups[i];
+        uint16_t low = low_bits(seq);
+        if (!group.bits.empty())
+        {
+            return (group.bits[low >> 5] & (1UL << (low & 31))) != 0;
+        }
+        return std::binary_search(group.values.begin(), group.values.end(), low);
+    }
+
+    // First mark after seq. Returns false if there is none.
+    bool next(int seq, int& found) const
+    {
+        if (seq == 0x7FFFFFFF)
+        {
+            return false;
+        }
+        seq++;
+
+        for (size_t i = find_group(high_bits(seq)); i < groups.size(); i++)
+        {
+            // Only the group holding seq starts part way through
+            uint32_t from = (groups[i].high == high_bits(seq)) ? low_bits(seq) : 0;
+            uint32_t low;
+            if (first_from(groups[i], from, low))
+            {
+                found = (int)(((uint32_t)groups[i].high << 16 | low) ^ 0x80000000);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct TGroup
+    {
+        uint16_t high;                  // Upper 16 bits of the (biased) sequence
+        uint32_t count;                 // Marks in the group
+        std::vector<uint16_t> values;   // Sorted low bits, while an array
+        std::vector<uint32_t> bits;     // Bitmap over the low bits, once full
+    };
+
+    // Sequence numbers are biased so that negative ones order first
+    static uint16_t high_bits(int seq) { return (uint16_t)(((uint32_t)seq ^ 0x80000000) >> 16); }
+    static uint16_t low_bits(int seq) { return (uint16_t)((uint32_t)seq & 0xFFFF); }
+
+    // Index of the first group at or after high
+    size_t find_group(uint16_t high) const
+    {
+        size_t lo = 0;
+        size_t hi = groups.size();
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (groups[mid].high < high)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    static bool first_from(const TGroup& group, uint32_t from, uint32_t& low)
+    {
+        if (group.bits.empty())
+        {
+            std::vector<uint16_t>::const_iterator it =
+                std::lower_bound(group.values.begin(), group.values.end(), (uint16_t)from);
+            if (it == group.values.end())
+                return false;
+            low = *it;
+            return true;
+        }
+
+        for (uint32_t word = from >> 5; word < MARKSET_BITMAP_WORDS; word++)
+        {
+            uint32_t bits = group.bits[word];
+            if (word == (from >> 5))
+                bits &= ~0UL << (from & 31);
+            if (bits != 0)
+            {
+                uint32_t bit = 0;
+                while ((bits & 1) == 0)
+                {
+                    bits >>= 1;
+                    bit++;
+                }
+                low = word * 32 + bit;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void to_bitmap(TGroup& group)
+    {
+        group.bits.assign(MARKSET_BITMAP_WORDS, 0);
+        for (size_t i = 0; i < group.values.size(); i++)
+        {
+            group.bits[group.values[i] >> 5] |= 1UL << (group.values[i] & 31);
+        }
+        std::vector<uint16_t>().swap(group.values);
+    }
+
+    static void to_array(TGroup& group)
+    {
+        group.values.clear();
+        for (uint32_t low = 0; low < 65536; low++)
+        {
+            if (group.bits[low >> 5] & (1UL << (low & 31)))
+                group.values.push_back((uint16_t)low);
+        }
+        std::vector<uint32_t>().swap(group.bits);
+    }
+
+    std::vector<TGroup> groups;     // Sorted by high
+    int capture_first;              // Capture the marks were set on
+    int capture_last;
+    uint32_t capture_signature;
+};
+
+#endif // MARKSET_H
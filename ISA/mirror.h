@@ -0,0 +1,291 @@
+// mirror.h - Compressed copy of the group values read from the host
+#pragma once
+
+#ifndef MIRROR_H
+#define MIRROR_H
+
+#include "stdint.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Every re-decode of a capture (a setting change, a refresh of the listing)
+// reads the same samples from the host again, one LAGroupValue call per
+// sample and group. The mirror sits in front of the host: a group is read
+// in segments of MIRROR_SEGMENT samples, and each segment read is kept
+// run-length and delta encoded, which suits logic analyzer data where most
+// samples repeat the one before. Later passes decode the segments from RAM.
+//
+// The mirror belongs to one capture: bind() keeps it across re-decodes of
+// the same capture, after checking a spread of mirrored samples against
+// the host, and drops it when a different one is loaded.
+#define MIRROR_SEGMENT      64          // Samples read and encoded together
+#define MIRROR_GROUPS       8           // Groups mirrored, by group number
+#define MIRROR_CHUNK_BYTES  0x100000    // Encoded segments are kept in chunks this size
+#define MIRROR_MAX_BYTES    (128 * 1024 * 1024) // Past this, samples are read from the host
+#define MIRROR_CHECK_SEGMENTS 16        // Segments per group compared by bind()
+
+/*********************************************************
+        Sample mirror
+*********************************************************/
+class TSampleMirror
+{
+public:
+    typedef int (*TGroupValue)(struct lactx *, int, int);
+
+    TSampleMirror() : source(NULL), first(0), last(-1), capture_signature(0), bytes(0), chunk_used(MIRROR_CHUNK_BYTES)
+    {
+        reset_cache();
+    }
+    ~TSampleMirror() { clear(); }
+
+    // Where the samples come from
+    void attach(TGroupValue group_value)
+    {
+        source = group_value;
+    }
+
+    // Read a sample from the host, past the mirror
+    uint32_t fetch(struct lactx *lactx, int seq, int group) const
+    {
+        return (uint32_t)source(lactx, seq, group);
+    }
+
+    // Drop the mirrored samples
+    void clear()
+    {
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            free(chunks[i]);
+        }
+        chunks.clear();
+        for (int group = 0; group < MIRROR_GROUPS; group++)
+        {
+            std::vector<uint32_t>().swap(index[group]);
+        }
+        bytes = 0;
+        chunk_used = MIRROR_CHUNK_BYTES;
+        reset_cache();
+    }
+
+    // Attach the mirror to a capture, dropping it if it does not hold this
+    // one. Returns true if the mirror was kept.
+    bool bind(struct lactx *lactx, int first_seq, int last_seq, uint32_t signature)
+    {
+        if (first_seq == first && last_seq == last && signature == capture_signature && matches(lactx))
+        {
+            return true;
+        }
+        clear();
+        first = first_seq;
+        last = last_seq;
+        capture_signature = signature;
+        return false;
+    }
+
+    // Sample of a group, from the mirror when it holds it
+    uint32_t value(struct lactx *lactx, int seq, int group)
+    {
+        if (group < 0 || group >= MIRROR_GROUPS || seq < first || seq > last)
+        {
+            return fetch(lactx, seq, group);
+        }
+
+        int segment = (seq - first) / MIRROR_SEGMENT;
+        TCache& cached = cache[group];
+        if (segment != cached.segment)
+        {
+            load(lactx, group, segment);
+        }
+        return cached.values[(seq - first) % MIRROR_SEGMENT];
+    }
+
+    size_t size() const { return bytes; }
+
+private:
+    enum { SEGMENT_RLE, SEGMENT_RAW };
+
+    struct TCache
+    {
+        int segment;                        // Segment held in values, -1 if none
+        uint32_t values[MIRROR_SEGMENT];
+    };
+
+    int segment_samples(int segment) const
+    {
+        int remaining = last - first + 1 - segment * MIRROR_SEGMENT;
+        return remaining < MIRROR_SEGMENT ? remaining : MIRROR_SEGMENT;
+    }
+
+    void reset_cache()
+    {
+        for (int group = 0; group < MIRROR_GROUPS; group++)
+        {
+            cache[group].segment = -1;
+        }
+    }
+
+    // Fill the cache of a group with a segment, reading it from the host
+    // and keeping it encoded if the mirror does not have it yet
+    void load(struct lactx *lactx, int group, int segment)
+    {
+        TCache& cached = cache[group];
+        int count = segment_samples(segment);
+        std::vector<uint32_t>& offsets = index[group];
+        if (offsets.empty())
+        {
+            offsets.assign((last - first) / MIRROR_SEGMENT + 1, 0);
+        }
+
+        if (offsets[segment] != 0)
+        {
+            decode(offsets[segment] - 1, cached.values, count);
+        }
+        else
+        {
+            int base = first + segment * MIRROR_SEGMENT;
+            for (int i = 0; i < count; i++)
+            {
+                cached.values[i] = fetch(lactx, base + i, group);
+            }
+            offsets[segment] = store(cached.values, count);
+        }
+        cached.segment = segment;
+    }
+
+    // Encode a segment: a kind byte, then (delta from the run before, run
+    // length - 1) pairs as variable-length integers, or the raw values when
+    // that is not shorter. Returns its offset + 1, 0 if over the budget.
+    uint32_t store(const uint32_t *values, int count)
+    {
+        uint8_t encoded[1 + MIRROR_SEGMENT * 10];
+        size_t size = 1;
+        encoded[0] = SEGMENT_RLE;
+        uint32_t previous = 0;
+        for (int i = 0; i < count; )
+        {
+            int run = 1;
+            while (i + run < count && values[i + run] == values[i])
+            {
+                run++;
+            }
+            int32_t delta = (int32_t)(values[i] - previous);
+            size = put_varint(encoded, size, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+            size = put_varint(encoded, size, (uint32_t)(run - 1));
+            previous = values[i];
+            i += run;
+        }
+        if (size > 1 + (size_t)count * 4)
+        {
+            encoded[0] = SEGMENT_RAW;
+            memcpy(encoded + 1, values, count * 4);
+            size = 1 + count * 4;
+        }
+
+        if (bytes + size > MIRROR_MAX_BYTES)
+        {
+            return 0;
+        }
+        if (chunk_used + size > MIRROR_CHUNK_BYTES)
+        {
+            uint8_t *chunk = (uint8_t *)malloc(MIRROR_CHUNK_BYTES);
+            if (chunk == NULL)
+            {
+                return 0;
+            }
+            chunks.push_back(chunk);
+            chunk_used = 0;
+        }
+        uint32_t offset = (uint32_t)((chunks.size() - 1) * MIRROR_CHUNK_BYTES + chunk_used);
+        memcpy(chunks.back() + chunk_used, encoded, size);
+        chunk_used += size;
+        bytes += size;
+        return offset + 1;
+    }
+
+    void decode(uint32_t offset, uint32_t *values, int count) const
+    {
+        const uint8_t *p = chunks[offset / MIRROR_CHUNK_BYTES] + offset % MIRROR_CHUNK_BYTES;
+        if (*p++ == SEGMENT_RAW)
+        {
+            memcpy(values, p, count * 4);
+            return;
+        }
+
+        uint32_t value = 0;
+        for (int i = 0; i < count; )
+        {
+            uint32_t zigzag = get_varint(p);
+            value += (zigzag >> 1) ^ (0 - (zigzag & 1));
+            int run = (int)get_varint(p) + 1;
+            for (; run > 0 && i < count; run--)
+            {
+                values[i++] = value;
+            }
+        }
+    }
+
+    static size_t put_varint(uint8_t *out, size_t size, uint32_t x)
+    {
+        while (x >= 0x80)
+        {
+            out[size++] = (uint8_t)(x | 0x80);
+            x >>= 7;
+        }
+        out[size++] = (uint8_t)x;
+        return size;
+    }
+
+    static uint32_t get_varint(const uint8_t *&p)
+    {
+        uint32_t x = 0;
+        int shift = 0;
+        while (*p & 0x80)
+        {
+            x |= (uint32_t)(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        return x | ((uint32_t)*p++ << shift);
+    }
+
+    // Compare a spread of the mirrored segments with the host
+    bool matches(struct lactx *lactx)
+    {
+        uint32_t values[MIRROR_SEGMENT];
+        for (int group = 0; group < MIRROR_GROUPS; group++)
+        {
+            const std::vector<uint32_t>& offsets = index[group];
+            size_t step = offsets.size() / MIRROR_CHECK_SEGMENTS + 1;
+            for (size_t segment = 0; segment < offsets.size(); segment += step)
+            {
+                if (offsets[segment] == 0)
+                {
+                    continue;
+                }
+                int count = segment_samples((int)segment);
+                decode(offsets[segment] - 1, values, count);
+                int base = first + (int)segment * MIRROR_SEGMENT;
+                for (int i = 0; i < count; i++)
+                {
+                    if (values[i] != fetch(lactx, base + i, group))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    TGroupValue source;             // Host (or channel map) read
+    int first;                      // Capture the mirror holds
+    int last;
+    uint32_t capture_signature;
+    std::vector<uint32_t> index[MIRROR_GROUPS]; // Offset + 1 of each segment, 0 if not mirrored
+    std::vector<uint8_t *> chunks;  // Encoded segments
+    size_t bytes;                   // Encoded bytes stored
+    size_t chunk_used;              // Bytes used in the last chunk
+    TCache cache[MIRROR_GROUPS];    // Last segment decoded per group
+};
+
+#endif // MIRROR_H
@@ -0,0 +1,544 @@
+// pagestore.h - Paged result store shared by the protocol analyzers
+#pragma once
+
+#ifndef PAGESTORE_H
+#define PAGESTORE_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// One page of rows. A multiple of the 64 KB mapping granularity so every
+// page has its own aligned view in the spill file.
+#define PAGESTORE_PAGE_BYTES    0x10000
+#define PAGESTORE_MIN_PAGES     4       // Smallest budget that still works
+#define PAGEARENA_BLOCK_PAGES   16      // Pages drawn from the heap at once (1 MB)
+
+/*********************************************************
+        Page arena
+*********************************************************/
+// Pages for the result stores, cut from large blocks drawn from the host's
+// heap (rda_malloc) so a decode does not go to the allocator for every
+// page. A page a store drops goes on a free list and is handed out again,
+// so a re-decode of the same capture reuses the pages of the last one.
+// release() gives all blocks back at once; the stores using the arena must
+// have been cleared first.
+class TPageArena
+{
+public:
+    typedef void *(*TAlloc)(int size);
+    typedef void (*TFree)(void *p);
+
+    TPageArena() : heap_alloc(crt_alloc), heap_free(crt_free), unused(0) {}
+    ~TPageArena() { release(); }
+
+    // Draw the blocks from the host's heap; the C runtime's until then
+    void attach(TAlloc alloc, TFree release_block)
+    {
+        release();
+        if (alloc != NULL && release_block != NULL)
+        {
+            heap_alloc = alloc;
+            heap_free = release_block;
+        }
+    }
+
+    // A page of PAGESTORE_PAGE_BYTES, NULL if the heap is exhausted
+    void *take()
+    {
+        if (!free_pages.empty())
+        {
+            void *page = free_pages.back();
+            free_pages.pop_back();
+            return page;
+        }
+        if (unused == 0)
+        {
+            char *block = (char *)heap_alloc(PAGEARENA_BLOCK_PAGES * PAGESTORE_PAGE_BYTES);
+            if (block == NULL)
+            {
+                return NULL;
+            }
+            blocks.push_back(block);
+            unused = PAGEARENA_BLOCK_PAGES;
+        }
+        unused--;
+        return blocks.back() + (PAGEARENA_BLOCK_PAGES - 1 - unused) * PAGESTORE_PAGE_BYTES;
+    }
+
+    // Hand a page from take() back for reuse
+    void give(void *page)
+    {
+        free_pages.push_back(page);
+    }
+
+    // Return every block to the heap
+    void release()
+    {
+        for (size_t i = 0; i < blocks.size(); i++)
+        {
+            heap_free(blocks[i]);
+        }
+        blocks.clear();
+        std::vector<void *>().swap(free_pages);
+        unused = 0;
+    }
+
+    size_t size() const { return blocks.size() * PAGEARENA_BLOCK_PAGES * PAGESTORE_PAGE_BYTES; }
+
+private:
+    TPageArena(const TPageArena&);
+    TPageArena& operator=(const TPageArena&);
+
+    static void *crt_alloc(int size) { return malloc(size); }
+    static void crt_free(void *p) { free(p); }
+
+    TAlloc heap_alloc;
+    TFree heap_free;
+    std::vector<char *> blocks;     // Blocks drawn from the heap
+    std::vector<void *> free_pages; // Pages given back
+    int unused;                     // Pages of the last block not handed out yet
+};
+
+/*********************************************************
+        Paged store
+*********************************************************/
+// Rows live in fixed-size pages that are never reallocated, so appending
+// never copies the rows already stored. With a RAM budget set, the least
+// recently used pages are written to a memory-mapped temp file once the
+// budget is exceeded and read back when a row on them is accessed. When the
+// heap runs out, pages are spilled the same way until the new one fits; with
+// no spill file either, the page is only read into a scratch page and rows
+// stored on it are lost instead of the decode crashing.
+// T must be plain data. A reference returned by operator[] stays valid
+// until the next access to the store. The pages come from the C runtime's
+// heap, or from an arena when one is set.
+template <class T>
+class TPagedStore
+{
+public:
+    TPagedStore() : arena(NULL), count(0), budget(0), resident(0), tick(0), scratch_page(NO_PAGE),
+                    mapped_pages(0)
+    {
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#else
+        fd = -1;
+#endif
+    }
+    ~TPagedStore() { clear(); }
+
+    // RAM budget in bytes, 0 for no limit
+    void set_budget(size_t bytes)
+    {
+        budget = bytes / PAGESTORE_PAGE_BYTES;
+        if (budget != 0 && budget < PAGESTORE_MIN_PAGES)
+            budget = PAGESTORE_MIN_PAGES;
+    }
+
+    // Take the pages from an arena, NULL for the heap; only while empty
+    void set_arena(TPageArena *page_arena)
+    {
+        arena = page_arena;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Drop all rows, the spilled ones included
+    void clear()
+    {
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            release_page(pages[i].rows);
+        }
+        pages.clear();
+        count = 0;
+        resident = 0;
+        scratch_page = NO_PAGE;
+        close_spill();
+    }
+
+    void push_back(const T& row)
+    {
+        if (count == pages.size() * rows_per_page())
+        {
+            TPage page;
+            page.rows = NULL;
+            page.spilled = false;
+            page.last_use = 0;
+            pages.push_back(page);
+        }
+        count++;
+        row_at(count - 1) = row;
+    }
+
+    T& operator[](size_t index) { return row_at(index); }
+    T& back() { return row_at(count - 1); }
+
+    // Move the rows from middle on in front of the ones before it
+    void rotate(size_t middle)
+    {
+        reverse(0, middle);
+        reverse(middle, count);
+        reverse(0, count);
+    }
+
+private:
+    enum { NO_PAGE = -1 };
+
+    struct TPage
+    {
+        T *rows;                // NULL while the page is only in the spill file
+        bool spilled;           // The spill file holds a copy of the page
+        unsigned long last_use; // Access tick, the lowest resident one is evicted first
+    };
+
+    static size_t rows_per_page() { return PAGESTORE_PAGE_BYTES / sizeof(T); }
+
+    T& row_at(size_t index)
+    {
+        size_t page = index / rows_per_page();
+        if (pages[page].rows == NULL && !page_in(page))
+        {
+            return scratch_row(page, index);
+        }
+        pages[page].last_use = ++tick;
+        return pages[page].rows[index % rows_per_page()];
+    }
+
+    void reverse(size_t first, size_t last)
+    {
+        while (first + 1 < last)
+        {
+            T a = row_at(first);
+            T b = row_at(last - 1);
+            row_at(first) = b;
+            row_at(last - 1) = a;
+            first++;
+            last--;
+        }
+    }
+
+    // Bring a page into RAM, making room under the budget first. False if
+    // there is no memory for it and no resident page could be spilled.
+    bool page_in(size_t page)
+    {
+        while (budget != 0 && resident >= budget)
+        {
+            if (!evict_oldest())
+                break;      // No spill file, run over the budget
+        }
+
+        T *rows = take_page();
+        while (rows == NULL && evict_oldest())
+        {
+            rows = take_page();
+        }
+        if (rows == NULL)
+        {
+            return false;
+        }
+
+        pages[page].rows = rows;
+        if (pages[page].spilled)
+        {
+            copy_spill(page, rows, false);
+        }
+        resident++;
+        return true;
+    }
+
+    // Row of a page that could not be brought into RAM, from its spilled
+    // copy if it has one
+    T& scratch_row(size_t page, size_t index)
+    {
+        if (scratch_page != (long)page)
+        {
+            if (!pages[page].spilled || !copy_spill(page, scratch, false))
+            {
+                memset(scratch, 0, sizeof(scratch));
+            }
+            scratch_page = (long)page;
+        }
+        return scratch[index % rows_per_page()];
+    }
+
+    bool evict_oldest()
+    {
+        size_t oldest = pages.size();
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            if (pages[i].rows != NULL &&
+                (oldest == pages.size() || pages[i].last_use < pages[oldest].last_use))
+            {
+                oldest = i;
+            }
+        }
+        if (oldest == pages.size() || !copy_spill(oldest, pages[oldest].rows, true))
+        {
+            return false;
+        }
+        if (scratch_page == (long)oldest)
+        {
+            scratch_page = NO_PAGE;
+        }
+
+        release_page(pages[oldest].rows);
+        pages[oldest].rows = NULL;
+        pages[oldest].spilled = true;
+        resident--;
+        return true;
+    }
+
+    T *take_page()
+    {
+        return (T *)(arena != NULL ? arena->take() : malloc(PAGESTORE_PAGE_BYTES));
+    }
+
+    void release_page(T *rows)
+    {
+        if (rows == NULL)
+            return;
+        if (arena != NULL)
+            arena->give(rows);
+        else
+            free(rows);
+    }
+
+    // Copy a page to (or from) its slot in the spill file, page n at n * 64 KB,
+    // through a view of just that slot
+    bool copy_spill(size_t page, T *rows, bool write)
+    {
+        if (!map_spill(page + 1))
+        {
+            return false;
+        }
+
+#ifdef _WIN32
+        void *view = MapViewOfFile(mapping, write ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                   (DWORD)(page >> 16), (DWORD)(page << 16), PAGESTORE_PAGE_BYTES);
+        if (view == NULL)
+        {
+            return false;
+        }
+#else
+        void *view = mmap(NULL, PAGESTORE_PAGE_BYTES, write ? PROT_WRITE : PROT_READ, MAP_SHARED,
+                          fd, (off_t)page * PAGESTORE_PAGE_BYTES);
+        if (view == MAP_FAILED)
+        {
+            return false;
+        }
+#endif
+        if (write)
+            memcpy(view, rows, PAGESTORE_PAGE_BYTES);
+        else
+            memcpy(rows, view, PAGESTORE_PAGE_BYTES);
+#ifdef _WIN32
+        UnmapViewOfFile(view);
+#else
+        munmap(view, PAGESTORE_PAGE_BYTES);
+#endif
+        return true;
+    }
+
+    // Open the spill file on first use and grow its mapping to hold n pages
+    bool map_spill(size_t n)
+    {
+#ifdef _WIN32
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            char dir[MAX_PATH];
+            char name[MAX_PATH];
+            if (!GetTempPath(sizeof(dir), dir) || !GetTempFileName(dir, "tla", 0, name))
+            {
+                return false;
+            }
+            file = CreateFile(name, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+        }
+
+        if (n > mapped_pages)
+        {
+            size_t grow = mapped_pages * 2 > n ? mapped_pages * 2 : n;
+            if (mapping != NULL)
+            {
+                CloseHandle(mapping);
+            }
+            mapping = CreateFileMapping(file, NULL, PAGE_READWRITE,
+                                        (DWORD)(grow >> 16), (DWORD)(grow << 16), NULL);
+            mapped_pages = (mapping != NULL) ? grow : 0;
+        }
+        return mapping != NULL;
+#else
+        // The file is unlinked at once and goes away with the descriptor
+        if (fd < 0)
+        {
+            const char *dir = getenv("TMPDIR");
+            char name[1024];
+            snprintf(name, sizeof(name), "%s/tlaXXXXXX", dir != NULL ? dir : "/tmp");
+            fd = mkstemp(name);
+            if (fd < 0)
+            {
+                return false;
+            }
+            unlink(name);
+        }
+        if (n > mapped_pages)
+        {
+            size_t grow = mapped_pages * 2 > n ? mapped_pages * 2 : n;
+            if (ftruncate(fd, (off_t)grow * PAGESTORE_PAGE_BYTES) != 0)
+            {
+                return false;
+            }
+            mapped_pages = grow;
+        }
+        return true;
+#endif
+    }
+
+    void close_spill()
+    {
+#ifdef _WIN32
+        if (mapping != NULL)
+        {
+            CloseHandle(mapping);
+            mapping = NULL;
+        }
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+        mapped_pages = 0;
+    }
+
+    TPageArena *arena;          // Where the pages come from, NULL for the heap
+    std::vector<TPage> pages;   // Page table, only the entries move when it grows
+    size_t count;               // Rows stored
+    size_t budget;              // Resident page limit, 0 for none
+    size_t resident;            // Pages currently in RAM
+    unsigned long tick;         // Access counter for the eviction order
+    long scratch_page;          // Page held in scratch, NO_PAGE if none
+    T scratch[PAGESTORE_PAGE_BYTES / sizeof(T)]; // Stand-in for a page there is no memory for
+#ifdef _WIN32
+    HANDLE file;                // Spill file, deleted when closed
+    HANDLE mapping;             // Mapping of the spill file
+#else
+    int fd;                     // Spill file, already unlinked
+#endif
+    size_t mapped_pages;        // Pages the mapping (or the file) covers
+};
+
+/*********************************************************
+        Row index
+*********************************************************/
+// Sequence number -> row lookup kept beside a paged store, so finding a row
+// touches only the page that holds it. The keys are paged the same way as
+// the rows, under their own budget. Rows may be added out of sequence
+// order, a few rows behind at most; their keys are moved back into place
+// as they are added.
+typedef struct TRowKey
+{
+    int seq_number;
+    int row;
+} TRowKey;
+
+class TRowIndex
+{
+public:
+    // RAM budget in bytes, 0 for no limit
+    void set_budget(size_t bytes) { keys.set_budget(bytes); }
+
+    // Take the pages from an arena, NULL for the heap; only while empty
+    void set_arena(TPageArena *page_arena) { keys.set_arena(page_arena); }
+
+    void clear() { keys.clear(); }
+
+    void add(int seq_number, int row)
+    {
+        TRowKey key;
+        key.seq_number = seq_number;
+        key.row = row;
+
+        // Stable: a key only moves past the ones with a later sequence number
+        size_t i = keys.size();
+        keys.push_back(key);
+        while (i > 0)
+        {
+            TRowKey before = keys[i - 1];
+            if (before.seq_number <= seq_number)
+                break;
+            keys[i] = before;
+            i--;
+        }
+        if (i != keys.size() - 1)
+        {
+            keys[i] = key;
+        }
+    }
+
+    // First row at seq_number, -1 if there is none
+    int find(int seq_number)
+    {
+        size_t i = lower_bound(seq_number);
+        if (i < keys.size())
+        {
+            TRowKey key = keys[i];
+            if (key.seq_number == seq_number)
+                return key.row;
+        }
+        return -1;
+    }
+
+    // First key after seq_number; false if there is none
+    bool next(int seq_number, TRowKey& key)
+    {
+        size_t i = lower_bound(seq_number + 1);
+        if (i < keys.size())
+        {
+            key = keys[i];
+            return true;
+        }
+        return false;
+    }
+
+private:
+    size_t lower_bound(int seq_number)
+    {
+        size_t lo = 0;
+        size_t hi = keys.size();
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (keys[mid].seq_number < seq_number)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    TPagedStore<TRowKey> keys;
+};
+
+#endif // PAGESTORE_H
@@ -0,0 +1,187 @@
+// pipeline.h - Fetch stage of a decode pass on its own thread
+#pragma once
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "platform.h"
+
+// A decode pass has two stages. The fetch stage reads the groups from the
+// host a block at a time, runs the glitch filter and finds the samples the
+// state machine has to look at; the decode stage runs the state machine
+// over the blocks and adds the rows. The fetch stage runs on a worker
+// thread, up to PIPELINE_DEPTH blocks ahead, so the host calls overlap
+// with the state machine.
+//
+// The blocks are handed over in a ring with one writer per index: the
+// fetch stage only moves head, the decode stage only moves tail, so no
+// lock is taken per block. A stage that has to wait for the other one
+// sleeps on an event until it moves. The worker is started with the first
+// pass and waits for the next one in between, until close(). On a host
+// with a single processor, or without a thread to spare, there is no
+// worker: the decode stage fetches each block itself when it gets to it.
+//
+// While a pass runs only the fetch stage calls the host, unless the decode
+// stage holds the host lock.
+#define PIPELINE_DEPTH  4           // Blocks the fetch stage may run ahead
+
+/*********************************************************
+        Decode pipeline
+*********************************************************/
+// BLOCK is filled in place by the fetch function
+template <class BLOCK>
+class TPipeline
+{
+public:
+    // Fill the next block of the pass; false once there is none
+    typedef bool (*TFetch)(void *arg, BLOCK& block);
+
+    TPipeline() : fetch(NULL), fetch_arg(NULL), head(0), tail(0), fetched(0), stopping(0), closing(0) {}
+    ~TPipeline() { close(); }
+
+    // Start the fetch stage of a pass
+    void start(TFetch fetch_block, void *arg)
+    {
+        fetch = fetch_block;
+        fetch_arg = arg;
+        head = 0;
+        tail = 0;
+        fetched = 0;
+        stopping = 0;
+        if (!worker.active() && ProcessorCount() > 1)
+        {
+            worker.start(run, this);
+        }
+        if (worker.active())
+        {
+            work.set();
+        }
+    }
+
+    // Decode stage: the next block in order, NULL after the last one. The
+    // block stays valid until release().
+    BLOCK *next()
+    {
+        for (;;)
+        {
+            long done = AtomicRead(&fetched);
+            if (AtomicRead(&head) != tail)
+            {
+                return &blocks[tail % PIPELINE_DEPTH];
+            }
+            if (done)
+            {
+                return NULL;
+            }
+            if (!worker.active())
+            {
+                if (!fetch(fetch_arg, blocks[tail % PIPELINE_DEPTH]))
+                {
+                    fetched = 1;
+                    return NULL;
+                }
+                head = tail + 1;
+                return &blocks[tail % PIPELINE_DEPTH];
+            }
+            filled.wait();
+        }
+    }
+
+    // Decode stage: done with the block from next()
+    void release()
+    {
+        AtomicExchange(&tail, tail + 1);
+        if (worker.active())
+        {
+            space.set();
+        }
+    }
+
+    // End of the pass: wait for the fetch stage, which stops early if the
+    // decode stage did not take every block
+    void finish()
+    {
+        if (worker.active())
+        {
+            AtomicExchange(&stopping, 1);
+            space.set();
+            idle.wait();
+        }
+    }
+
+    // Decode stage: call the host itself while the fetch stage may be
+    // running, between lock_host() and unlock_host()
+    void lock_host() { host.enter(); }
+    void unlock_host() { host.leave(); }
+
+    // Stop the worker; the next pass starts it again. Not during a pass.
+    void close()
+    {
+        if (worker.active())
+        {
+            AtomicExchange(&closing, 1);
+            work.set();
+            worker.join();
+            closing = 0;
+        }
+    }
+
+private:
+    static unsigned THREAD_CALL run(void *self)
+    {
+        TPipeline *pipeline = (TPipeline *)self;
+        for (;;)
+        {
+            pipeline->work.wait();
+            if (AtomicRead(&pipeline->closing))
+            {
+                return 0;
+            }
+            pipeline->fetch_all();
+            pipeline->idle.set();
+        }
+    }
+
+    void fetch_all()
+    {
+        for (;;)
+        {
+            while (!AtomicRead(&stopping) && head - AtomicRead(&tail) >= PIPELINE_DEPTH)
+            {
+                space.wait();
+            }
+            if (AtomicRead(&stopping))
+            {
+                return;
+            }
+            host.enter();
+            bool more = fetch(fetch_arg, blocks[head % PIPELINE_DEPTH]);
+            host.leave();
+            if (!more)
+            {
+                break;
+            }
+            AtomicExchange(&head, head + 1);
+            filled.set();
+        }
+        AtomicExchange(&fetched, 1);
+        filled.set();
+    }
+
+    TFetch fetch;
+    void *fetch_arg;
+    volatile long head;             // Blocks fetched
+    volatile long tail;             // Blocks released by the decode stage
+    volatile long fetched;          // Fetch stage has no more blocks
+    volatile long stopping;         // Pass is over
+    volatile long closing;          // Worker is to return
+    TThread worker;
+    TEvent work;                    // A pass was started, or close()
+    TEvent filled;                  // Fetch stage moved head or is done
+    TEvent space;                   // Decode stage moved tail, or the pass is over
+    TEvent idle;                    // Fetch stage is done with the pass
+    TLock host;                     // Held by the fetch stage while it reads a block
+    BLOCK blocks[PIPELINE_DEPTH];
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,214 @@
+// platform.h - Operating system services used by the protocol analyzers
+#pragma once
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// The decoders reach the OS only through this header (and the spill file in
+// pagestore.h), so the same source builds as a TLA DLL with Visual C++ 6.0
+// and as a shared object with current GCC, Clang or MSVC for the replay host.
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// TLA entry points
+#ifdef _WIN32
+#define PARSE_EXPORT __declspec(dllexport)
+#else
+#define PARSE_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef _WIN32
+#define THREAD_CALL __stdcall
+#else
+#define THREAD_CALL
+#endif
+
+typedef unsigned (THREAD_CALL *TThreadMain)(void *arg);
+
+/*********************************************************
+        Thread
+*********************************************************/
+// The background decoder. start() fails if the OS has no thread to spare;
+// the caller then runs main itself.
+class TThread
+{
+public:
+    TThread() : running(false) {}
+
+    bool start(TThreadMain main, void *arg)
+    {
+#ifdef _WIN32
+        unsigned thread_id;
+        handle = (HANDLE)_beginthreadex(NULL, 0, main, arg, 0, &thread_id);
+        running = handle != NULL;
+#else
+        start_main = main;
+        start_arg = arg;
+        running = pthread_create(&handle, NULL, thunk, this) == 0;
+#endif
+        return running;
+    }
+
+    // Wait for the thread to return, nothing if it is not running
+    void join()
+    {
+        if (!running)
+        {
+            return;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(handle, INFINITE);
+        CloseHandle(handle);
+#else
+        pthread_join(handle, NULL);
+#endif
+        running = false;
+    }
+
+    bool active() const { return running; }
+
+private:
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    static void *thunk(void *self)
+    {
+        TThread *thread = (TThread *)self;
+        thread->start_main(thread->start_arg);
+        return NULL;
+    }
+
+    pthread_t handle;
+    TThreadMain start_main;
+    void *start_arg;
+#endif
+    bool running;
+};
+
+/*********************************************************
+        Lock
+*********************************************************/
+// Guards the rows shared between the decoder thread and the host's calls
+class TLock
+{
+public:
+#ifdef _WIN32
+    TLock() { InitializeCriticalSection(&section); }
+    ~TLock() { DeleteCriticalSection(&section); }
+    void enter() { EnterCriticalSection(&section); }
+    void leave() { LeaveCriticalSection(&section); }
+#else
+    TLock() { pthread_mutex_init(&mutex, NULL); }
+    ~TLock() { pthread_mutex_destroy(&mutex); }
+    void enter() { pthread_mutex_lock(&mutex); }
+    void leave() { pthread_mutex_unlock(&mutex); }
+#endif
+
+private:
+    TLock(const TLock&);
+    TLock& operator=(const TLock&);
+
+#ifdef _WIN32
+    CRITICAL_SECTION section;
+#else
+    pthread_mutex_t mutex;
+#endif
+};
+
+/*********************************************************
+        Event
+*********************************************************/
+// One thread waits until another one sets the event. A set() with nobody
+// waiting is kept for the next wait(), which clears it again.
+class TEvent
+{
+public:
+#ifdef _WIN32
+    TEvent() { handle = CreateEvent(NULL, FALSE, FALSE, NULL); }
+    ~TEvent() { CloseHandle(handle); }
+    void set() { SetEvent(handle); }
+    void wait() { WaitForSingleObject(handle, INFINITE); }
+#else
+    TEvent() : signaled(false)
+    {
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond, NULL);
+    }
+    ~TEvent()
+    {
+        pthread_cond_destroy(&cond);
+        pthread_mutex_destroy(&mutex);
+    }
+    void set()
+    {
+        pthread_mutex_lock(&mutex);
+        signaled = true;
+        pthread_cond_signal(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+    void wait()
+    {
+        pthread_mutex_lock(&mutex);
+        while (!signaled)
+        {
+            pthread_cond_wait(&cond, &mutex);
+        }
+        signaled = false;
+        pthread_mutex_unlock(&mutex);
+    }
+#endif
+
+private:
+    TEvent(const TEvent&);
+    TEvent& operator=(const TEvent&);
+
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool signaled;
+#endif
+};
+
+// Processors the OS runs threads on
+inline int ProcessorCount()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// Set a flag the other thread polls, with a full barrier
+inline long AtomicExchange(volatile long *target, long value)
+{
+#ifdef _WIN32
+    return InterlockedExchange((LONG *)target, value);
+#else
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Read a flag or index the other thread sets; what it wrote before setting
+// it is visible after the read
+inline long AtomicRead(volatile long *source)
+{
+#ifdef _WIN32
+    // x86 does not move loads ahead of loads; volatile keeps the compiler from it
+    return *source;
+#else
+    return __atomic_load_n(source, __ATOMIC_ACQUIRE);
+#endif
+}
+
+#endif // PLATFORM_H
@@ -1,6 +1,7 @@
 #ifndef _STDINT_H_
 #define _STDINT_H_
 
+#if defined(_MSC_VER) && _MSC_VER < 1600
 /* Fixed width integer types for Visual Studio 6 */
 typedef signed char         int8_t;
 typedef unsigned char       uint8_t;
@@ -10,5 +11,9 @@ typedef signed int          int32_t;
 typedef unsigned int        uint32_t;
 typedef signed __int64      int64_t;
 typedef unsigned __int64    uint64_t;
+#else
+/* Compilers since Visual Studio 2010 have their own */
+#include <stdint.h>
+#endif
 
-#endif /* _STDINT_H_ */
\ No newline at end of file
+#endif /* _STDINT_H_ */
@@ -0,0 +1,109 @@
+// textout.h - Row text writer for the listing
+#pragma once
+
+#ifndef TEXTOUT_H
+#define TEXTOUT_H
+
+#include "stdint.h"
+#include <stddef.h>
+#include <string.h>
+
+// The host asks for every row it shows, again on each scroll, so the row
+// text is produced often. The writer appends the fields of a row straight
+// into the row buffer: strings are copied, hex digits come from a table
+// and numbers are converted without a format string to parse or a
+// temporary to copy from. Like snprintf it stops at the end of the buffer
+// and leaves it terminated after every call.
+
+/*********************************************************
+        Text writer
+*********************************************************/
+class TTextOut
+{
+public:
+    // size includes the terminator and must be at least 1
+    TTextOut(char *buffer, size_t size) : out(buffer), end(buffer + size - 1)
+    {
+        *out = '\0';
+    }
+
+    TTextOut& put(char c)
+    {
+        if (out < end)
+        {
+            *out++ = c;
+            *out = '\0';
+        }
+        return *this;
+    }
+
+    TTextOut& put(const char *s)
+    {
+        return put(s, strlen(s));
+    }
+
+    // Upper case hex, zero padded to at least digits (as %0<digits>X)
+    TTextOut& hex(uint32_t value, int digits)
+    {
+        static const char hex_digits[] = "0123456789ABCDEF";
+        while (digits < 8 && (value >> (digits * 4)) != 0)
+        {
+            digits++;
+        }
+        char field[8];
+        char *p = (end - out >= digits) ? out : field;
+        for (int i = digits - 1; i >= 0; i--)
+        {
+            p[i] = hex_digits[value & 0xF];
+            value >>= 4;
+        }
+        return p == out ? advance(digits) : put(field, digits);
+    }
+
+    // Signed decimal (as %d)
+    TTextOut& dec(long value)
+    {
+        if (value < 0)
+        {
+            put('-');
+            return udec(0 - (unsigned long)value);
+        }
+        return udec((unsigned long)value);
+    }
+
+    // Unsigned decimal (as %u)
+    TTextOut& udec(unsigned long value)
+    {
+        char field[24];
+        int digits = 0;
+        do
+        {
+            field[sizeof(field) - 1 - digits++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        return put(field + sizeof(field) - digits, digits);
+    }
+
+private:
+    TTextOut& put(const char *s, size_t count)
+    {
+        if (count > (size_t)(end - out))
+        {
+            count = end - out;
+        }
+        memcpy(out, s, count);
+        return advance(count);
+    }
+
+    TTextOut& advance(size_t count)
+    {
+        out += count;
+        *out = '\0';
+        return *this;
+    }
+
+    char *out;                      // Next character
+    char *end;                      // Where the terminator goes at the latest
+};
+
+#endif // TEXTOUT_H
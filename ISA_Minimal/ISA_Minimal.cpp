@@ -1,10 +1,11 @@
 #include <vector>
+#include <algorithm>
 using namespace std;
-#include "ISA_minimal.h"
+#include "ISA_Minimal.h"
+#include "../ISA/isaengine.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <windows.h>
 
 // Enable debugging if needed
 //#define WITH_DEBUG
@@ -46,13 +47,20 @@ const struct businfo businfo[] = { { 0, 0, 0, 0, 0, 0x20000, NULL, 0 } };
 const char *addr_width[] = { "16-bit", "20-bit", "24-bit", NULL };
 const char *timing_mode[] = { "Fast Mode", "Normal Mode", "Slow Mode", NULL };
 const char *data_width[] = { "8-bit", "16-bit", NULL };
+const char *auto_detect[] = { "Off", "On", NULL };
+const char *glitch_filter[] = { "Off", "2 Samples", "3 Samples", "4 Samples", "8 Samples", NULL };
 
 const struct modeinfo modeinfo[] = { 
     { "ADDR_WIDTH", addr_width, 0, 2 },
     { "TIMING_MODE", timing_mode, 1, 2 },
-    { "DATA_WIDTH", data_width, 0, 1 }
+    { "DATA_WIDTH", data_width, 0, 1 },
+    { "AUTO_DETECT", auto_detect, 1, 1 },
+    { "GLITCH_FILTER", glitch_filter, 0, 4 }
 };
 
+// Shortest pulse kept for each GLITCH_FILTER choice, 0 = filter off
+const int glitch_filter_width[] = { 0, 2, 3, 4, 8 };
+
 // Names for the transaction types
 const char* transaction_names[] = {
     "None",
@@ -68,109 +76,769 @@ const char* transaction_names[] = {
     "Error"
 };
 
+// Channels the decoder tests, by the .tla user group they are wired in
+const TChannelGroupDef channel_groups[] = {
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_Control" },
+    { TISAMinimalLayout::ADDR_GROUP, "ISA_Address" },
+    { TISAMinimalLayout::DATA_GROUP, "ISA_Data" }
+};
+
+const TChannelDef channels[] = {
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_BCLK", ISA_BCLK, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_ALE", ISA_ALE, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_IOR", ISA_IOR, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_IOW", ISA_IOW, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_MEMR", ISA_MEMR, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_MEMW", ISA_MEMW, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_REFRESH", ISA_REFRESH, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_SBHE", ISA_SBHE, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_IOCHRDY", ISA_IOCHRDY, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_AEN", ISA_AEN, 0 },
+    { TISAMinimalLayout::CONTROL_GROUP, "ISA_RESET", ISA_RESET, 0 },
+    { TISAMinimalLayout::ADDR_GROUP, "ISA_ADDR_", ISA_ADDR_MASK, 1 },
+    { TISAMinimalLayout::DATA_GROUP, "ISA_DATA_", ISA_DATA_MASK, 1 }
+};
+
 /*********************************************************
         ISA analysis data
 *********************************************************/
 static TISAData ISAData[1];       // Active transaction data
 static TISABusData ISABusData[1]; // Bus state tracking
+static TISACarry ISACarry;        // Signal levels after the last sample decoded
 static TISAFeatureConfig FeatureConfig; // Feature configuration
+static int set_glitch_filter;     // Minimum pulse width on the control lines
 static int processing_done;
-TVSeqData SeqDataVector;          // Vector with analysis results
+static TVISARecord Records;       // Packed analysis results
+static int RecordsUnsorted;       // A row was added out of sequence order
+static int RenderAddrWidth;       // Address width the rows were decoded with
+static TISARenderSlot RenderCache[ISA_RENDER_CACHE]; // Rows rendered for the display
+static int CaptureFirst;          // First sample of the capture
+static int ResyncSeq;             // First sample of the trigger-first pass
+static int ResumeSeq;             // First sample the host asked for
+static uint32_t CaptureHash;      // Signature of the capture
+static int EarlyPending;          // Samples before ResyncSeq still to be decoded
+static int EarlyOverrun;          // Early pass is past ResyncSeq, where the late pass has the rows
+static int CaptureLast;           // Last sample of the capture
+static int LateDone;              // Last published sample from ResyncSeq on
+static int PublishedRecords;      // Rows ParseSeq may look at, sorted by sequence
+static TThread DecodeThread;      // Background decoder
+static volatile long DecodeCancel; // Ask the decoder to stop at the next chunk
+static int DecodeAborted;         // Decoding stopped by the host's abort request
+static TLock DecodeLock;          // Guards the rows and the published range
+static struct sequence PendingRow; // Placeholder for samples not decoded yet
+static TMarkSet UserMarks;        // Sequences marked by the user
+static TChannelMap ChannelMap;    // Probe wiring read from ISA_Minimal.tla
+static TSampleMirror SampleMirror; // Compressed copy of the samples read from the host
+static TGlitchFilter GlitchFilter; // Removes short pulses ahead of the state machine
+static TBitPlanes ControlPlanes;  // Control group sliced for the resync search
+static TISAPipeline SamplePipeline; // Blocks fetched ahead of the state machine
+static TCheckpoints<TISACheckpoint> Checkpoints; // Decoder state after each chunk
 
 /*********************************************************
         Helpers
 *********************************************************/
+// Group values with the channels moved to the ISA_Minimal.h layout, used in
+// place of the host's LAGroupValue when ISA_Minimal.tla wires a group
+// differently
+static int MappedGroupValue(struct lactx *lactx, int seqno, int group)
+{
+    return ChannelMap.value(lactx, seqno, group);
+}
 
-// Helper function to get address width in bits based on setting
-static int GetAddressWidthBits()
+// Group values through the sample mirror, so a re-decode of the same
+// capture does not read them from the host again
+static int MirroredGroupValue(struct lactx *lactx, int seqno, int group)
 {
-    switch (FeatureConfig.addr_width)
-    {
-        case 0: return 16;
-        case 1: return 20;
-        case 2: return 24;
-        default: return 16;
-    }
+    return (int)SampleMirror.value(lactx, seqno, group);
 }
 
+
 // Helper function to format address based on address width
-static void FormatAddress(char* buf, size_t buf_size, uint32_t addr)
+static void FormatAddress(TTextOut& text, uint32_t addr, int addr_width)
 {
-    switch (FeatureConfig.addr_width)
+    text.put("0x");
+    switch (addr_width)
     {
         case 0: // 16-bit
-            snprintf(buf, buf_size, "0x%04X", addr & 0xFFFF);
+            text.hex(addr & 0xFFFF, 4);
             break;
         case 1: // 20-bit
-            snprintf(buf, buf_size, "0x%05X", addr & 0xFFFFF);
+            text.hex(addr & 0xFFFFF, 5);
             break;
         case 2: // 24-bit
-            snprintf(buf, buf_size, "0x%06X", addr & 0xFFFFFF);
+            text.hex(addr & 0xFFFFFF, 6);
             break;
         default:
-            snprintf(buf, buf_size, "0x%04X", addr & 0xFFFF);
+            text.hex(addr & 0xFFFF, 4);
             break;
     }
 }
 
-// Helper to check if the given value is active low (normally high)
-static int IsActiveLow(uint32_t signal, uint32_t value)
+/*********************************************************
+        Result rows
+*********************************************************/
+// Drop all rows and everything rendered from them
+static void ClearRecords()
+{
+    Records.clear();
+    RecordsUnsorted = 0;
+    PublishedRecords = 0;
+    for (int i = 0; i < ISA_RENDER_CACHE; i++)
+    {
+        RenderCache[i].record = -1;
+    }
+}
+
+// Append a packed row; the text is produced later by RenderRecord. detail
+// only matters for ISA_ROW_INCOMPLETE, where it tells if the address was latched.
+static void AddRecord(int seq_number, int kind, int trans_type, int error_flag,
+                      uint32_t address, uint16_t data, int count, int detail)
+{
+    if (EarlyOverrun && seq_number >= ResyncSeq)
+    {
+        return;
+    }
+    
+    TISARecord Record;
+    memset(&Record, 0, sizeof(Record));
+    
+    Record.seq_number = seq_number;
+    Record.address = address;
+    Record.data = data;
+    Record.kind = (uint8_t)kind;
+    Record.trans_type = (uint8_t)trans_type;
+    Record.count = (uint8_t)(count > 0xFF ? 0xFF : count);
+    Record.addr_valid = (uint8_t)(kind == ISA_ROW_INCOMPLETE ? detail : 1);
+    
+    // Set flags based on transaction type and error status
+    if (error_flag)
+    {
+        Record.flags = 4;  // Red background for errors
+    }
+    else if (trans_type == ISA_TRANS_REFRESH || kind == ISA_ROW_FEATURES || kind == ISA_ROW_GLITCHES)
+    {
+        Record.flags = 2;  // Grey background for refresh cycles and status
+    }
+    else
+    {
+        Record.flags = 1;  // Normal white background
+    }
+    
+    if (!Records.empty() && seq_number < Records.back().seq_number)
+    {
+        RecordsUnsorted = 1;
+    }
+    Records.push_back(Record);
+}
+
+static bool RecordBefore(const TISARecord& a, const TISARecord& b)
 {
-    return (value & signal) == 0 ? 1 : 0;
+    return a.seq_number < b.seq_number;
 }
 
-// Helper to check if the given value is active high (normally low)
-static int IsActiveHigh(uint32_t signal, uint32_t value)
+// Index of the first published row at or after seq, PublishedRecords if there is none
+static int FindRecord(int seq)
 {
-    return (value & signal) != 0 ? 1 : 0;
+    int lo = 0;
+    int hi = PublishedRecords;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (Records[mid].seq_number < seq)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
 }
 
-// Helper function to create a new sequence data entry
-static void CreateSequenceEntry(int seq_number, int trans_type, int error_flag, const char* format, ...)
+// Produce the display text of a row
+static void RenderRecord(const TISARecord& Record, char *buf, size_t buf_size)
 {
-    TSeqData SeqData;
-    memset(&SeqData, 0, sizeof(SeqData));
+    TTextOut text(buf, buf_size);
     
-    va_list args;
-    va_start(args, format);
-    vsnprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), format, args);
-    va_end(args);
+    switch (Record.kind)
+    {
+        case ISA_ROW_RESET:
+            text.put("SYSTEM RESET");
+            break;
+            
+        case ISA_ROW_TRANSACTION:
+            // Format for 8-bit vs 16-bit data
+            text.put(transaction_names[Record.trans_type]).put(" | Addr: ");
+            FormatAddress(text, Record.address, RenderAddrWidth);
+            text.put(" | Data: 0x").hex(Record.data, Is16BitTransaction(Record.trans_type) ? 4 : 2);
+            text.put(" | Wait: ").dec(Record.count);
+            break;
+            
+        case ISA_ROW_TIMEOUT:
+            text.put("ERROR: ").put(transaction_names[Record.trans_type]);
+            text.put(" transaction timed out | Addr: ");
+            FormatAddress(text, Record.address, RenderAddrWidth);
+            text.put(" | Cycles: ").dec(Record.count);
+            break;
+            
+        case ISA_ROW_REFRESH:
+            text.put("Memory Refresh Cycle | Cycles: ").dec(Record.count);
+            break;
+            
+        case ISA_ROW_REFRESH_TIMEOUT:
+            text.put("ERROR: Refresh cycle timed out | Cycles: ").dec(Record.count);
+            break;
+            
+        case ISA_ROW_INCOMPLETE:
+            text.put("WARNING: Incomplete ").put(transaction_names[Record.trans_type]).put(" | Addr: ");
+            if (Record.addr_valid)
+            {
+                FormatAddress(text, Record.address, RenderAddrWidth);
+            }
+            else
+            {
+                text.put("Unknown");
+            }
+            text.put(" | State: ").dec(Record.count);
+            break;
+            
+        case ISA_ROW_FEATURES:
+            text.put("Auto-detected: ").dec((Record.trans_type & ISA_FEATURE_16BIT) ? 16 : 8);
+            text.put("-bit data, ").dec((Record.trans_type & ISA_FEATURE_24BIT_ADDR) ? 24 :
+                                        (Record.trans_type & ISA_FEATURE_20BIT_ADDR) ? 20 : 16);
+            text.put("-bit address");
+            text.put((Record.trans_type & ISA_FEATURE_REFRESH) ? ", REFRESH#" : "");
+            text.put((Record.trans_type & ISA_FEATURE_IOCHRDY) ? ", IOCHRDY" : "");
+            break;
+            
+        case ISA_ROW_GLITCHES:
+            text.put("Glitch filter: ").udec(Record.address).put(" pulses shorter than ");
+            text.dec(Record.count).put(" samples removed");
+            break;
+            
+        default:
+            break;
+    }
+}
+
+// Rendered row for the host. Only the rows the display asks for are turned
+// into text; they are kept in a small direct-mapped cache so scrolling over
+// the same rows does not format them again.
+static struct sequence *RenderRow(int index)
+{
+    TISARenderSlot *slot = &RenderCache[index & (ISA_RENDER_CACHE - 1)];
     
-    // Set flags based on transaction type and error status
-    if (error_flag)
+    if (slot->record != index)
+    {
+        memset(&slot->seq_data, 0, sizeof(slot->seq_data));
+        RenderRecord(Records[index], slot->seq_data.text, sizeof(slot->seq_data.text));
+        slot->seq_data.flags = Records[index].flags;
+        slot->seq_data.textp = slot->seq_data.text;
+        slot->seq_data.text2 = slot->seq_data.text2_buf;
+        slot->record = index;
+    }
+    
+    return &slot->seq_data;
+}
+
+/*********************************************************
+        Feature detection
+*********************************************************/
+// Prescan a prefix of the capture and enable the optional features whose
+// lines toggle: SBHE# selects 16-bit data, REFRESH# and IOCHRDY enable
+// their decoding, and the highest toggling address line sets the address
+// width. Every sample is XORed against the first one and OR-accumulated,
+// so the loop has no branches on signal values; it stops early once all
+// lines of interest have been seen.
+static int DetectFeatures(struct pctx *pctx, int firstseq, int lastseq)
+{
+    int count = lastseq - firstseq + 1;
+    if (count > ISA_PRESCAN_SAMPLES)
+        count = ISA_PRESCAN_SAMPLES;
+    if (count <= 0)
+        return FeatureConfig.enabled_features;
+    
+    uint32_t ctrl_first = pctx->func.LAGroupValue(pctx->lactx, firstseq, TISAMinimalLayout::CONTROL_GROUP);
+    uint32_t addr_first = pctx->func.LAGroupValue(pctx->lactx, firstseq, TISAMinimalLayout::ADDR_GROUP);
+    uint32_t ctrl_toggled = 0;
+    uint32_t addr_toggled = 0;
+    
+    for (int seq = firstseq + 1; seq < firstseq + count; seq++)
+    {
+        ctrl_toggled |= pctx->func.LAGroupValue(pctx->lactx, seq, TISAMinimalLayout::CONTROL_GROUP) ^ ctrl_first;
+        addr_toggled |= pctx->func.LAGroupValue(pctx->lactx, seq, TISAMinimalLayout::ADDR_GROUP) ^ addr_first;
+        
+        if ((ctrl_toggled & ISA_PRESCAN_CTRL) == ISA_PRESCAN_CTRL &&
+            (addr_toggled & ISA_ADDR_24BIT_LINES) != 0)
+            break;
+    }
+    
+    int features = FeatureConfig.enabled_features & ~ISA_DECODE_FEATURES;
+    if (ctrl_toggled & ISA_SBHE)
+        features |= ISA_FEATURE_16BIT;
+    if (ctrl_toggled & ISA_REFRESH)
+        features |= ISA_FEATURE_REFRESH;
+    if (ctrl_toggled & ISA_IOCHRDY)
+        features |= ISA_FEATURE_IOCHRDY;
+    
+    if (addr_toggled & ISA_ADDR_24BIT_LINES)
     {
-        SeqData.seq_data.flags = 4;  // Red background for errors
+        features |= ISA_FEATURE_24BIT_ADDR;
+        FeatureConfig.addr_width = 2;
     }
-    else if (trans_type == ISA_TRANS_REFRESH)
+    else if (addr_toggled & ISA_ADDR_20BIT_LINES)
     {
-        SeqData.seq_data.flags = 2;  // Grey background for refresh cycles
+        features |= ISA_FEATURE_20BIT_ADDR;
+        FeatureConfig.addr_width = 1;
     }
     else
     {
-        SeqData.seq_data.flags = 1;  // Normal white background
+        FeatureConfig.addr_width = 0;
     }
+    FeatureConfig.data_width = (features & ISA_FEATURE_16BIT) ? 1 : 0;
+    FeatureConfig.enabled_features = features;
     
-    SeqData.seq_number = seq_number;
-    SeqDataVector.push_back(SeqData);
+    LogDebug(pctx, 0, "Prescan: ctrl toggled 0x%X, addr toggled 0x%X, features 0x%X",
+             ctrl_toggled, addr_toggled, features);
     
-    LogDebug(NULL, 0, "Created sequence: %s", SeqData.seq_data.text);
+    // Report the choice as a grey row at the start of the capture
+    AddRecord(firstseq, ISA_ROW_FEATURES, features, 0, 0, 0, 0, 0);
+    
+    return features;
 }
 
-// Helper function to determine if a transaction is 16-bit
-static int Is16BitTransaction(int trans_type)
+/*********************************************************
+        ISA decoder
+*********************************************************/
+// One case per address width for a given combination of the other flags
+#define ISA_DECODE_CASES(f) \
+    case (f): \
+        TISAEngine<TISAMinimalLayout, (f)>::decode(ctx, firstseq, lastseq); \
+        break; \
+    case (f) | ISA_FEATURE_20BIT_ADDR: \
+        TISAEngine<TISAMinimalLayout, ((f) | ISA_FEATURE_20BIT_ADDR)>::decode(ctx, firstseq, lastseq); \
+        break; \
+    case (f) | ISA_FEATURE_24BIT_ADDR: \
+        TISAEngine<TISAMinimalLayout, ((f) | ISA_FEATURE_24BIT_ADDR)>::decode(ctx, firstseq, lastseq); \
+        break;
+
+// Features the decoder instance is picked for
+static int DecodeFeatures()
 {
-    switch (trans_type)
+    int features = FeatureConfig.enabled_features & ISA_DECODE_FEATURES;
+    
+    // 24-bit addressing takes precedence over 20-bit
+    if (features & ISA_FEATURE_24BIT_ADDR)
+        features &= ~ISA_FEATURE_20BIT_ADDR;
+    return features;
+}
+
+// Pick the decoder instance for the enabled features, once per pass
+static void DecodeCapture(struct pctx *pctx, int firstseq, int lastseq)
+{
+    int features = DecodeFeatures();
+    
+    LogDebug(pctx, 0, "Decoding with features 0x%X", features);
+    
+    // Refresh and timeouts are always reported; there are no DMA or IRQ lines
+    TISAEngineContext ctx;
+    ctx.pctx = pctx;
+    ctx.capture_first = CaptureFirst;
+    ctx.capture_last = CaptureLast;
+    ctx.cycle = &ISAData[0];
+    ctx.bus = &ISABusData[0];
+    ctx.carry = &ISACarry;
+    ctx.dma_support = 0;
+    ctx.refresh_support = 1;
+    ctx.irq_support = 0;
+    ctx.error_detection = 1;
+    ctx.glitch_filter = GlitchFilter.enabled() ? &GlitchFilter : NULL;
+    ctx.pipeline = &SamplePipeline;
+    ctx.add_row = AddRecord;
+    
+    switch (features)
     {
-        case ISA_TRANS_IO_READ_WORD:
-        case ISA_TRANS_IO_WRITE_WORD:
-        case ISA_TRANS_MEM_READ_WORD:
-        case ISA_TRANS_MEM_WRITE_WORD:
-            return 1;
-        default:
+        ISA_DECODE_CASES(0)
+        ISA_DECODE_CASES(ISA_FEATURE_16BIT)
+        ISA_DECODE_CASES(ISA_FEATURE_REFRESH)
+        ISA_DECODE_CASES(ISA_FEATURE_16BIT | ISA_FEATURE_REFRESH)
+        ISA_DECODE_CASES(ISA_FEATURE_IOCHRDY)
+        ISA_DECODE_CASES(ISA_FEATURE_16BIT | ISA_FEATURE_IOCHRDY)
+        ISA_DECODE_CASES(ISA_FEATURE_REFRESH | ISA_FEATURE_IOCHRDY)
+        ISA_DECODE_CASES(ISA_FEATURE_16BIT | ISA_FEATURE_REFRESH | ISA_FEATURE_IOCHRDY)
+    }
+}
+
+/*********************************************************
+        Trigger-first decoding
+*********************************************************/
+// Return the state machine to idle ahead of a decode pass
+static void ResetDecoder()
+{
+    memset(ISAData, 0, sizeof(ISAData));
+    memset(ISABusData, 0, sizeof(ISABusData));
+    memset(&ISACarry, 0, sizeof(ISACarry));
+    
+    ISAData[0].state = ISA_STATE_IDLE;
+    ISAData[0].transaction_type = ISA_TRANS_NONE;
+}
+
+// Settings the decoder state depends on, once the features are detected;
+// checkpoints taken with any of them set differently are dropped
+static uint32_t CheckpointKey()
+{
+    return (uint32_t)DecodeFeatures() | ((uint32_t)set_glitch_filter << 16);
+}
+
+// Snapshot of the decoder state before the next sample
+static void SaveCheckpoint(TISACheckpoint& checkpoint)
+{
+    checkpoint.cycle = ISAData[0];
+    checkpoint.bus = ISABusData[0];
+    checkpoint.carry = ISACarry;
+    GlitchFilter.save(checkpoint.glitch_out, checkpoint.glitch_dev);
+}
+
+// Put the decoder back into a saved state
+static void ResumeCheckpoint(const TISACheckpoint& checkpoint)
+{
+    ISAData[0] = checkpoint.cycle;
+    ISABusData[0] = checkpoint.bus;
+    ISACarry = checkpoint.carry;
+    if (GlitchFilter.enabled())
+    {
+        GlitchFilter.resume(checkpoint.carry.next_seq, checkpoint.glitch_out, checkpoint.glitch_dev);
+    }
+}
+
+// Find where the trigger-first pass starts: the sample after a command
+// strobe (or REFRESH#) is released with ALE low, where the state machine
+// has completed a cycle and is back to idle. Returns firstseq when the host
+// reports no trigger or there is no such point near it.
+static int FindResyncPoint(struct pctx *pctx, int firstseq, int lastseq)
+{
+    if (pctx->func.LABusModTrigSample == NULL)
+    {
+        return firstseq;
+    }
+    
+    int trigger = pctx->func.LABusModTrigSample(pctx->lactx, -1);
+    if (trigger <= firstseq || trigger > lastseq)
+    {
+        return firstseq;
+    }
+    
+    uint32_t strobes = ISA_COMMAND_MASK;
+    if (FeatureConfig.enabled_features & ISA_FEATURE_REFRESH)
+        strobes |= ISA_REFRESH;
+    
+    int limit = trigger - ISA_RESYNC_WINDOW;
+    if (limit < firstseq)
+        limit = firstseq;
+    
+    // Strobes are active low: all high at seq, at least one low before it.
+    // The window is sliced into bit-planes a block at a time back from the
+    // trigger, so 64 samples are tested at once.
+    ControlPlanes.select(strobes | ISA_ALE);
+    for (int block_last = trigger - 1; block_last > limit; block_last -= BITPLANE_BLOCK)
+    {
+        int block_first = block_last - BITPLANE_BLOCK + 1;
+        if (block_first <= limit)
+            block_first = limit + 1;
+        
+        ControlPlanes.load(pctx->func.LAGroupValue, pctx->lactx, TISAMinimalLayout::CONTROL_GROUP,
+                           block_first, block_last - block_first + 1,
+                           pctx->func.LAGroupValue(pctx->lactx, block_first - 1, TISAMinimalLayout::CONTROL_GROUP));
+        for (int w = ControlPlanes.words() - 1; w >= 0; w--)
+        {
+            uint64_t released = ControlPlanes.all(strobes, w) & ~ControlPlanes.all_before(strobes, w) &
+                                ~ControlPlanes.level(ISA_ALE, w);
+            if (released != 0)
+            {
+                return block_first + w * 64 + TBitPlanes::highest(released) + 1;
+            }
+        }
+    }
+    return firstseq;
+}
+
+/*********************************************************
+        Background decoding
+*********************************************************/
+// Make the rows decoded so far visible to ParseSeq; called with DecodeLock held
+static void PublishRecords()
+{
+    if (RecordsUnsorted)
+    {
+        stable_sort(Records.begin(), Records.end(), RecordBefore);
+        RecordsUnsorted = 0;
+        
+        // Row indices have moved
+        for (int i = 0; i < ISA_RENDER_CACHE; i++)
+        {
+            RenderCache[i].record = -1;
+        }
+    }
+    PublishedRecords = Records.size();
+}
+
+// Stop at the next chunk if decoding was cancelled or the host asked to abort
+static int DecodeStopped(struct pctx *pctx)
+{
+    if (DecodeCancel)
+    {
+        return 1;
+    }
+    if (pctx->func.LAProgAbort != NULL && pctx->func.LAProgAbort(pctx->lactx))
+    {
+        DecodeAborted = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// Last sample of a decoded chunk whose rows are all in. A transaction still
+// in flight adds its row, at its first sample, only once it completes. One
+// resumed from a checkpoint may have started ahead of the resync point,
+// where the early pass covers it.
+static int PublishLimit(int chunk_last)
+{
+    if (ISAData[0].state != ISA_STATE_IDLE && ISAData[0].sequence <= chunk_last)
+    {
+        return ISAData[0].sequence > ResyncSeq ? ISAData[0].sequence - 1 : ResyncSeq - 1;
+    }
+    return chunk_last;
+}
+
+// Decode a range a chunk at a time, holding the lock only while a chunk is
+// decoded. With publish set, each chunk becomes visible once it is done.
+static int DecodeChunks(struct pctx *pctx, int firstseq, int lastseq, int publish)
+{
+    for (int seq = firstseq; seq <= lastseq; seq += ISA_DECODE_CHUNK)
+    {
+        if (DecodeStopped(pctx))
+        {
+            return 0;
+        }
+        
+        int chunk_last = lastseq - seq < ISA_DECODE_CHUNK ? lastseq : seq + ISA_DECODE_CHUNK - 1;
+        DecodeLock.enter();
+        DecodeCapture(pctx, seq, chunk_last);
+        if (chunk_last < CaptureLast)
+        {
+            TISACheckpoint checkpoint;
+            SaveCheckpoint(checkpoint);
+            Checkpoints.record(chunk_last + 1, checkpoint);
+        }
+        if (publish)
+        {
+            PublishRecords();
+            LateDone = PublishLimit(chunk_last);
+        }
+        DecodeLock.leave();
+    }
+    return 1;
+}
+
+// Report what the glitch filter removed as a grey row on the last sample,
+// once the whole capture has been through it
+static void AddGlitchSummary()
+{
+    if (GlitchFilter.enabled())
+    {
+        AddRecord(CaptureLast, ISA_ROW_GLITCHES, ISA_TRANS_NONE, 0,
+                  (uint32_t)GlitchFilter.removed, 0, GlitchFilter.width(), 0);
+    }
+}
+
+// Warning row for a cycle still open at the end of the capture
+static void AddIncompleteRecord(struct pctx *pctx)
+{
+    if (ISAData[0].state != ISA_STATE_IDLE && ISAData[0].transaction_type != ISA_TRANS_NONE)
+    {
+        LogDebug(pctx, 0, "Warning: Incomplete transaction at end of capture");
+        
+        // Create a warning entry for the incomplete transaction
+        AddRecord(ISAData[0].sequence, ISA_ROW_INCOMPLETE, ISAData[0].transaction_type, 1,
+                  ISAData[0].address, 0, ISAData[0].state, ISABusData[0].addr_valid);
+    }
+}
+
+// Carry the early pass on past the resync point until the cycle open there
+// completes, e.g. one that times out after its strobe was released. Its row
+// is kept; rows from the resync point on come from the late pass already,
+// and the glitches there are counted once.
+static int FinishEarlyCycle(struct pctx *pctx)
+{
+    unsigned long removed = GlitchFilter.removed;
+    EarlyOverrun = 1;
+    for (int seq = ResyncSeq; seq <= CaptureLast && ISAData[0].state != ISA_STATE_IDLE; seq += BITPLANE_BLOCK)
+    {
+        if (DecodeStopped(pctx))
+        {
+            EarlyOverrun = 0;
             return 0;
+        }
+        
+        int last = CaptureLast - seq < BITPLANE_BLOCK ? CaptureLast : seq + BITPLANE_BLOCK - 1;
+        DecodeLock.enter();
+        DecodeCapture(pctx, seq, last);
+        if (last == CaptureLast)
+        {
+            AddIncompleteRecord(pctx);
+        }
+        DecodeLock.leave();
+    }
+    GlitchFilter.removed = removed;
+    EarlyOverrun = 0;
+    return 1;
+}
+
+// Decode the samples ahead of the resync point and merge their rows in
+// front of the ones already published
+static int DecodeEarly(struct pctx *pctx)
+{
+    int late_rows = Records.size();
+    ResetDecoder();
+    if (!DecodeChunks(pctx, CaptureFirst, ResyncSeq - 1, 0) || !FinishEarlyCycle(pctx))
+    {
+        return 0;
+    }
+    
+    DecodeLock.enter();
+    stable_sort(Records.begin() + late_rows, Records.end(), RecordBefore);
+    inplace_merge(Records.begin(), Records.begin() + late_rows, Records.end(), RecordBefore);
+    RecordsUnsorted = 0;
+    for (int i = 0; i < ISA_RENDER_CACHE; i++)
+    {
+        RenderCache[i].record = -1;
+    }
+    PublishedRecords = Records.size();
+    EarlyPending = 0;
+    DecodeLock.leave();
+    
+    LogDebug(pctx, 0, "Early pass: %d rows before seq %d", Records.size() - late_rows, ResyncSeq);
+    return 1;
+}
+
+// Worker thread: rows from the resync point on are published a chunk at a
+// time, the early ones in one go once they have been merged in front. A
+// re-decode of the same capture resumes from the checkpoint before the
+// first sample asked for, so the rows there are back first and exact.
+static unsigned THREAD_CALL DecodeWorker(void *arg)
+{
+    struct pctx *pctx = (struct pctx *)arg;
+    
+    // Configure the optional features from the capture itself
+    if (FeatureConfig.auto_detect)
+    {
+        DecodeLock.enter();
+        DetectFeatures(pctx, CaptureFirst, CaptureLast);
+        DecodeLock.leave();
+    }
+    
+    int resync;
+    Checkpoints.bind(CaptureFirst, CaptureLast, CaptureHash, CheckpointKey());
+    const TISACheckpoint *checkpoint = Checkpoints.nearest(ResumeSeq, resync);
+    if (checkpoint != NULL)
+    {
+        ResumeCheckpoint(*checkpoint);
+        LogDebug(pctx, 0, "Resuming at checkpoint seq %d", resync);
+    }
+    else
+    {
+        resync = FindResyncPoint(pctx, CaptureFirst, CaptureLast);
+    }
+    DecodeLock.enter();
+    RenderAddrWidth = FeatureConfig.addr_width;
+    ResyncSeq = resync;
+    LateDone = resync - 1;
+    EarlyPending = resync > CaptureFirst;
+    PublishRecords();
+    DecodeLock.leave();
+    
+    // Run the decoder instance built for the enabled feature set
+    if (!DecodeChunks(pctx, resync, CaptureLast, 1))
+    {
+        return 0;
+    }
+    
+    // Final check for any incomplete transactions
+    DecodeLock.enter();
+    AddIncompleteRecord(pctx);
+    if (!EarlyPending)
+    {
+        AddGlitchSummary();
+    }
+    PublishRecords();
+    
+    // The filter's count is complete only after the early pass
+    LateDone = (EarlyPending && GlitchFilter.enabled()) ? CaptureLast - 1 : CaptureLast;
+    DecodeLock.leave();
+    
+    LogDebug(pctx, 0, "Processing completed - found %d sequences", Records.size());
+    
+    if (EarlyPending && DecodeEarly(pctx))
+    {
+        DecodeLock.enter();
+        AddGlitchSummary();
+        PublishRecords();
+        LateDone = CaptureLast;
+        DecodeLock.leave();
+    }
+    return 0;
+}
+
+// Start decoding the whole capture in the background
+static void StartDecode(struct pctx *pctx)
+{
+    if (!DecodeThread.start(DecodeWorker, pctx))
+    {
+        // No thread available, decode in the caller instead
+        DecodeWorker(pctx);
     }
 }
 
+// Cancel a running decode and wait for the worker to exit
+static void StopDecode()
+{
+    if (DecodeThread.active())
+    {
+        AtomicExchange(&DecodeCancel, 1);
+        DecodeThread.join();
+        AtomicExchange(&DecodeCancel, 0);
+    }
+}
+
+// First sample of the undecoded range holding seq, or -1 once seq is decoded
+static int PendingRange(int seq)
+{
+    if (seq >= ResyncSeq)
+    {
+        return seq > LateDone ? LateDone + 1 : -1;
+    }
+    return EarlyPending ? CaptureFirst : -1;
+}
+
+/*********************************************************
+        User marks
+*********************************************************/
+// Fingerprint of the capture, so marks survive a re-decode of the same
+// capture but not a new acquisition
+static uint32_t CaptureSignature(struct pctx *pctx, int firstseq, int lastseq)
+{
+    uint32_t hash = 2166136261UL;   // FNV-1a
+    int step = (lastseq - firstseq) / MARKSET_SIGNATURE_SAMPLES + 1;
+    for (int seq = firstseq; seq <= lastseq; seq += step)
+    {
+        uint32_t values[2];
+        values[0] = SampleMirror.fetch(pctx->lactx, seq, TISAMinimalLayout::CONTROL_GROUP);
+        values[1] = SampleMirror.fetch(pctx->lactx, seq, TISAMinimalLayout::DATA_GROUP);
+        for (int byte = 0; byte < 8; byte++)
+        {
+            hash = (hash ^ ((values[byte / 4] >> ((byte % 4) * 8)) & 0xFF)) * 16777619UL;
+        }
+    }
+    return hash;
+}
+
 /*********************************************************
         DLL functions
 *********************************************************/
@@ -178,7 +846,8 @@ struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *
 {
     // Called upon DLL startup and refreshing the data
     struct pctx *ret;
-    SeqDataVector.clear();
+    StopDecode();
+    ClearRecords();
     processing_done = 0;
     
     // Check if already initialized
@@ -198,16 +867,29 @@ struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *
     ret->func.rda_calloc = func->rda_calloc;
     ret->func.rda_free = func->rda_free;
     ret->func.LAInfo = func->LAInfo;
+    ret->func.LABusModTrigSample = func->LABusModTrigSample;
+    ret->func.LAProgAbort = func->LAProgAbort;
+    
+    // Read the probe wiring once; groups that match ISA_Minimal.h are read directly
+    char tla_path[512];
+    if (SupportFilePath(tla_path, sizeof(tla_path), func->support_path, func->support_sep,
+                        func->support_name, func->support_ext) &&
+        ChannelMap.load(tla_path, func->LAGroupValue, channel_groups, ARRAY_SIZE(channel_groups),
+                        channels, ARRAY_SIZE(channels)) > 0)
+    {
+        ret->func.LAGroupValue = MappedGroupValue;
+    }
+    SampleMirror.attach(ret->func.LAGroupValue);
+    ret->func.LAGroupValue = MirroredGroupValue;
     
     // default settings
     FeatureConfig.enabled_features = 0;
     FeatureConfig.addr_width = 0;        // 16-bit
     FeatureConfig.data_width = 0;        // 8-bit
-    FeatureConfig.addr_group = 1;        // Group 1 for address
-    FeatureConfig.data_group = 2;        // Group 2 for data
-    FeatureConfig.control_group = 0;     // Group 0 for control
+    FeatureConfig.auto_detect = 1;       // Detect features from the capture
+    set_glitch_filter = 0;               // Off
     
-    SeqDataVector.clear();
+    ClearRecords();
     processing_done = 0;
     
     LogDebug(ret, 0, "ISA Protocol Analyzer Minimal Version Initialization Completed");
@@ -223,14 +905,18 @@ int ParseExtInfo_(struct pctx *pctx)
 int ParseFinish(struct pctx *pctx)
 {
     LogDebug(pctx, 0, "%s", "ParseFinish");
-    SeqDataVector.clear();
+    StopDecode();
+    SamplePipeline.close();
+    ClearRecords();
+    UserMarks.clear();
+    Checkpoints.clear();
+    SampleMirror.clear();
     pctx->func.rda_free(pctx);
     return 0;
 }
 
 struct sequence *ParseSeq(struct pctx *pctx, int initseq)
 {
-    TVSeqData::iterator it;
     struct sequence *seqinfo = NULL;
     
     if (pctx == NULL)
@@ -241,6 +927,7 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
     
     if (processing_done == 0)
     {
+        StopDecode();
         processing_done = 1;
         
         // Get the sequence range
@@ -249,506 +936,55 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
         LogDebug(pctx, 0, "Processing sequences: initseq=%d, firstseq=%d, lastseq=%d", 
                  initseq, firstseq, lastseq);
         
-        // Initialize ISA data structures
-        memset(ISAData, 0, sizeof(ISAData));
-        memset(ISABusData, 0, sizeof(ISABusData));
-        
-        ISAData[0].state = ISA_STATE_IDLE;
-        ISAData[0].transaction_type = ISA_TRANS_NONE;
-        
-        // Previous signal states for edge detection
-        uint32_t prev_ctrl_signals = 0;
-        uint32_t prev_address = 0;
-        uint32_t prev_data = 0;
-        
-        int bclk_cycles = 0; // Counter for BCLK cycles
-        
-        // Now loop through all the samples
-        for (int seq = firstseq; seq <= lastseq; seq++)
-        {
-            // Get signal values for each group
-            uint32_t ctrl_signals = pctx->func.LAGroupValue(pctx->lactx, seq, FeatureConfig.control_group);
-            uint32_t address = pctx->func.LAGroupValue(pctx->lactx, seq, FeatureConfig.addr_group);
-            uint16_t data = pctx->func.LAGroupValue(pctx->lactx, seq, FeatureConfig.data_group) & 
-                           (FeatureConfig.data_width == 0 ? 0xFF : 0xFFFF);
-            
-            LogDebug(pctx, 5, "Seq: %d, Ctrl: 0x%08X, Addr: 0x%08X, Data: 0x%04X", 
-                     seq, ctrl_signals, address, data);
-            
-            // Decode control signals
-            int bclk = IsActiveHigh(ISA_BCLK, ctrl_signals);
-            int ale = IsActiveHigh(ISA_ALE, ctrl_signals);
-            int ior = IsActiveLow(ISA_IOR, ctrl_signals);
-            int iow = IsActiveLow(ISA_IOW, ctrl_signals);
-            int memr = IsActiveLow(ISA_MEMR, ctrl_signals);
-            int memw = IsActiveLow(ISA_MEMW, ctrl_signals);
-            int refresh = (ctrl_signals & ISA_REFRESH) ? IsActiveLow(ISA_REFRESH, ctrl_signals) : 0;
-            int sbhe = (ctrl_signals & ISA_SBHE) ? IsActiveLow(ISA_SBHE, ctrl_signals) : 0;
-            int iochrdy = (ctrl_signals & ISA_IOCHRDY) ? IsActiveHigh(ISA_IOCHRDY, ctrl_signals) : 1;
-            int aen = (ctrl_signals & ISA_AEN) ? IsActiveHigh(ISA_AEN, ctrl_signals) : 0;
-            int reset = (ctrl_signals & ISA_RESET) ? IsActiveHigh(ISA_RESET, ctrl_signals) : 0;
-            
-            // Edge detection
-            int bclk_rising_edge = bclk && !IsActiveHigh(ISA_BCLK, prev_ctrl_signals);
-            int bclk_falling_edge = !bclk && IsActiveHigh(ISA_BCLK, prev_ctrl_signals);
-            int ale_rising_edge = ale && !IsActiveHigh(ISA_ALE, prev_ctrl_signals);
-            int ale_falling_edge = !ale && IsActiveHigh(ISA_ALE, prev_ctrl_signals);
-            
-            int ior_falling_edge = ior && !IsActiveLow(ISA_IOR, prev_ctrl_signals);
-            int iow_falling_edge = iow && !IsActiveLow(ISA_IOW, prev_ctrl_signals);
-            int memr_falling_edge = memr && !IsActiveLow(ISA_MEMR, prev_ctrl_signals);
-            int memw_falling_edge = memw && !IsActiveLow(ISA_MEMW, prev_ctrl_signals);
-            int refresh_falling_edge = refresh && !(prev_ctrl_signals & ISA_REFRESH ? 
-                                      IsActiveLow(ISA_REFRESH, prev_ctrl_signals) : 0);
-            
-            int ior_rising_edge = !ior && IsActiveLow(ISA_IOR, prev_ctrl_signals);
-            int iow_rising_edge = !iow && IsActiveLow(ISA_IOW, prev_ctrl_signals);
-            int memr_rising_edge = !memr && IsActiveLow(ISA_MEMR, prev_ctrl_signals);
-            int memw_rising_edge = !memw && IsActiveLow(ISA_MEMW, prev_ctrl_signals);
-            int refresh_rising_edge = !refresh && (prev_ctrl_signals & ISA_REFRESH ? 
-                                     IsActiveLow(ISA_REFRESH, prev_ctrl_signals) : 0);
-            
-            // Track BCLK cycles
-            if (bclk_rising_edge)
-            {
-                bclk_cycles++;
-                LogDebug(pctx, 7, "BCLK Rising Edge: cycle %d", bclk_cycles);
-            }
-            
-            // ISA bus state machine
-            switch (ISAData[0].state)
-            {
-                case ISA_STATE_IDLE:
-                    if (reset)
-                    {
-                        // System reset detected
-                        LogDebug(pctx, 0, "SYSTEM RESET detected");
-                        CreateSequenceEntry(seq, ISA_TRANS_NONE, 0, "SYSTEM RESET");
-                        continue; // Skip further processing during reset
-                    }
-                    
-                    // Initialize transaction data
-                    if (ale_rising_edge || ior_falling_edge || iow_falling_edge || 
-                        memr_falling_edge || memw_falling_edge || refresh_falling_edge)
-                    {
-                        LogDebug(pctx, 1, "Starting new transaction");
-                        
-                        // Initialize new transaction
-                        ISAData[0].sequence = seq;
-                        ISAData[0].last_sequence = seq;
-                        ISAData[0].state = ISA_STATE_T1;
-                        ISAData[0].wait_states = 0;
-                        ISAData[0].bus_timing_cycles = 0;
-                        ISAData[0].is_16bit = (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) ? sbhe : 0;
-                        ISAData[0].timed_out = 0;
-                        ISAData[0].protocol_error = 0;
-                        
-                        // Track active command signals
-                        ISAData[0].ior_active = ior;
-                        ISAData[0].iow_active = iow;
-                        ISAData[0].memr_active = memr;
-                        ISAData[0].memw_active = memw;
-                        ISAData[0].refresh_active = refresh;
-                        ISAData[0].sbhe_active = sbhe;
-                        ISAData[0].iochrdy_active = iochrdy;
-                        ISAData[0].aen_active = aen;
-                        
-                        // Capture address (first part from address lines)
-                        ISABusData[0].addr_latch_state = 1;
-                        ISABusData[0].partial_addr = address & 
-                            ((1 << GetAddressWidthBits()) - 1);
-                        ISABusData[0].addr_valid = 0;
-                        ISABusData[0].data_valid = 0;
-                        
-                        // Check for refresh cycle
-                        if (refresh && (ctrl_signals & ISA_REFRESH))
-                        {
-                            ISAData[0].state = ISA_STATE_REFRESH;
-                            ISAData[0].transaction_type = ISA_TRANS_REFRESH;
-                            LogDebug(pctx, 1, "Memory refresh cycle detected");
-                        }
-                        // Normal bus cycle
-                        else
-                        {
-                            // Determine the transaction type
-                            if (ior)
-                            {
-                                ISAData[0].transaction_type = (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 
-                                                          ISA_TRANS_IO_READ_WORD : ISA_TRANS_IO_READ_BYTE;
-                                ISAData[0].use_io_space = 1;
-                                LogDebug(pctx, 1, "I/O Read (%d-bit) transaction started", 
-                                         (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 16 : 8);
-                            }
-                            else if (iow)
-                            {
-                                ISAData[0].transaction_type = (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 
-                                                          ISA_TRANS_IO_WRITE_WORD : ISA_TRANS_IO_WRITE_BYTE;
-                                ISAData[0].use_io_space = 1;
-                                LogDebug(pctx, 1, "I/O Write (%d-bit) transaction started", 
-                                         (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 16 : 8);
-                            }
-                            else if (memr)
-                            {
-                                ISAData[0].transaction_type = (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 
-                                                          ISA_TRANS_MEM_READ_WORD : ISA_TRANS_MEM_READ_BYTE;
-                                ISAData[0].use_io_space = 0;
-                                LogDebug(pctx, 1, "Memory Read (%d-bit) transaction started", 
-                                         (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 16 : 8);
-                            }
-                            else if (memw)
-                            {
-                                ISAData[0].transaction_type = (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 
-                                                          ISA_TRANS_MEM_WRITE_WORD : ISA_TRANS_MEM_WRITE_BYTE;
-                                ISAData[0].use_io_space = 0;
-                                LogDebug(pctx, 1, "Memory Write (%d-bit) transaction started", 
-                                         (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 16 : 8);
-                            }
-                            else
-                            {
-                                // No command line active - could be address latch only
-                                ISAData[0].transaction_type = ISA_TRANS_NONE;
-                                LogDebug(pctx, 1, "Address latch or unknown transaction");
-                            }
-                        }
-                    }
-                    break;
-                    
-                case ISA_STATE_T1:
-                    // T1 state - Address phase
-                    if (ale_falling_edge)
-                    {
-                        // Address latch complete on falling edge of ALE
-                        ISABusData[0].addr_latch_state = 2;
-                        ISABusData[0].latched_addr = ISABusData[0].partial_addr;
-                        ISABusData[0].addr_valid = 1;
-                        ISAData[0].address = ISABusData[0].latched_addr & ((1 << GetAddressWidthBits()) - 1);
-                        LogDebug(pctx, 2, "Address latched: 0x%08X", ISAData[0].address);
-                    }
-                    
-                    // Check for command signals (normally asserted in T1 state)
-                    if (ior_falling_edge || iow_falling_edge || memr_falling_edge || memw_falling_edge)
-                    {
-                        // Update transaction type if it wasn't determined yet
-                        if (ISAData[0].transaction_type == ISA_TRANS_NONE)
-                        {
-                            if (ior_falling_edge)
-                            {
-                                ISAData[0].transaction_type = (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 
-                                                          ISA_TRANS_IO_READ_WORD : ISA_TRANS_IO_READ_BYTE;
-                                ISAData[0].use_io_space = 1;
-                            }
-                            else if (iow_falling_edge)
-                            {
-                                ISAData[0].transaction_type = (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 
-                                                          ISA_TRANS_IO_WRITE_WORD : ISA_TRANS_IO_WRITE_BYTE;
-                                ISAData[0].use_io_space = 1;
-                            }
-                            else if (memr_falling_edge)
-                            {
-                                ISAData[0].transaction_type = (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 
-                                                          ISA_TRANS_MEM_READ_WORD : ISA_TRANS_MEM_READ_BYTE;
-                                ISAData[0].use_io_space = 0;
-                            }
-                            else if (memw_falling_edge)
-                            {
-                                ISAData[0].transaction_type = (FeatureConfig.enabled_features & ISA_FEATURE_16BIT) && sbhe ? 
-                                                          ISA_TRANS_MEM_WRITE_WORD : ISA_TRANS_MEM_WRITE_BYTE;
-                                ISAData[0].use_io_space = 0;
-                            }
-                            
-                            LogDebug(pctx, 2, "Transaction type updated to %s", 
-                                     transaction_names[ISAData[0].transaction_type]);
-                        }
-                    }
-                    
-                    // Move to T2 state on the next BCLK rising edge
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].state = ISA_STATE_T2;
-                        ISAData[0].bus_timing_cycles++;
-                        LogDebug(pctx, 2, "Advancing to T2 state");
-                    }
-                    break;
-                    
-                case ISA_STATE_T2:
-                    // T2 state - Data phase
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].bus_timing_cycles++;
-                        
-                        // Check for IOCHRDY (wait state insertion)
-                        if ((ctrl_signals & ISA_IOCHRDY) && !iochrdy)
-                        {
-                            ISAData[0].state = ISA_STATE_TW;
-                            LogDebug(pctx, 2, "Wait state inserted (IOCHRDY inactive)");
-                        }
-                        else
-                        {
-                            // Capture data on rising edge of T2 for write operations
-                            if (ISAData[0].transaction_type == ISA_TRANS_IO_WRITE_BYTE ||
-                                ISAData[0].transaction_type == ISA_TRANS_IO_WRITE_WORD ||
-                                ISAData[0].transaction_type == ISA_TRANS_MEM_WRITE_BYTE ||
-                                ISAData[0].transaction_type == ISA_TRANS_MEM_WRITE_WORD)
-                            {
-                                // For write operations, data should be valid during T2
-                                ISABusData[0].data = data;
-                                ISABusData[0].data_valid = 1;
-                                ISAData[0].data = data;
-                                LogDebug(pctx, 2, "Data captured for write operation: 0x%04X", data);
-                            }
-                            
-                            // Move to T3 state
-                            ISAData[0].state = ISA_STATE_T3;
-                            LogDebug(pctx, 2, "Advancing to T3 state");
-                        }
-                    }
-                    
-                    // For read operations, check data availability
-                    if ((ISAData[0].transaction_type == ISA_TRANS_IO_READ_BYTE ||
-                         ISAData[0].transaction_type == ISA_TRANS_IO_READ_WORD ||
-                         ISAData[0].transaction_type == ISA_TRANS_MEM_READ_BYTE ||
-                         ISAData[0].transaction_type == ISA_TRANS_MEM_READ_WORD) && 
-                        data != prev_data)
-                    {
-                        // Data changed, might be target providing data
-                        ISABusData[0].pending_data = data;
-                        LogDebug(pctx, 5, "Potential data seen: 0x%04X", data);
-                    }
-                    break;
-                    
-                case ISA_STATE_TW:
-                    // TW state - Wait states
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].bus_timing_cycles++;
-                        ISAData[0].wait_states++;
-                        
-                        // Check if wait state is released
-                        if (!(ctrl_signals & ISA_IOCHRDY) || iochrdy)
-                        {
-                            ISAData[0].state = ISA_STATE_T3;
-                            LogDebug(pctx, 2, "Wait state released, advancing to T3 (total wait states: %d)", 
-                                     ISAData[0].wait_states);
-                        }
-                        else
-                        {
-                            LogDebug(pctx, 5, "Still in wait state (%d)", ISAData[0].wait_states);
-                        }
-                    }
-                    
-                    // Check for timeout condition
-                    if (ISAData[0].wait_states > 20)
-                    {
-                        ISAData[0].timed_out = 1;
-                        ISAData[0].protocol_error = 1;
-                        snprintf(ISAData[0].error_message, sizeof(ISAData[0].error_message), 
-                                 "Excessive wait states (%d) - possible timeout", ISAData[0].wait_states);
-                        LogDebug(pctx, 0, "ERROR: %s", ISAData[0].error_message);
-                        
-                        // Force to T3 to complete transaction
-                        ISAData[0].state = ISA_STATE_T3;
-                    }
-                    break;
-                    
-                case ISA_STATE_T3:
-                    // T3 state - Completion phase
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].bus_timing_cycles++;
-                        
-                        // For read operations, data should be valid during T3
-                        if ((ISAData[0].transaction_type == ISA_TRANS_IO_READ_BYTE ||
-                             ISAData[0].transaction_type == ISA_TRANS_IO_READ_WORD ||
-                             ISAData[0].transaction_type == ISA_TRANS_MEM_READ_BYTE ||
-                             ISAData[0].transaction_type == ISA_TRANS_MEM_READ_WORD) && 
-                            !ISABusData[0].data_valid)
-                        {
-                            ISABusData[0].data = data;
-                            ISABusData[0].data_valid = 1;
-                            ISAData[0].data = data;
-                            LogDebug(pctx, 2, "Data captured for read operation: 0x%04X", data);
-                        }
-                    }
-                    
-                    // Check for command signal deassertion to mark the end of transaction
-                    if (ior_rising_edge || iow_rising_edge || memr_rising_edge || memw_rising_edge)
-                    {
-                        // Command signals deasserted, transaction is complete
-                        ISAData[0].last_sequence = seq;
-                        
-                        // Create sequence entry for the transaction
-                        char addr_str[20];
-                        FormatAddress(addr_str, sizeof(addr_str), ISAData[0].address);
-                        
-                        // Format for 8-bit vs 16-bit data
-                        if (Is16BitTransaction(ISAData[0].transaction_type))
-                        {
-                            // 16-bit transaction
-                            CreateSequenceEntry(
-                                ISAData[0].sequence,
-                                ISAData[0].transaction_type,
-                                ISAData[0].protocol_error,
-                                "%s | Addr: %s | Data: 0x%04X | Wait: %d",
-                                transaction_names[ISAData[0].transaction_type],
-                                addr_str,
-                                ISABusData[0].data_valid ? ISAData[0].data : 0xFFFF,
-                                ISAData[0].wait_states
-                            );
-                        }
-                        else
-                        {
-                            // 8-bit transaction
-                            CreateSequenceEntry(
-                                ISAData[0].sequence,
-                                ISAData[0].transaction_type,
-                                ISAData[0].protocol_error,
-                                "%s | Addr: %s | Data: 0x%02X | Wait: %d",
-                                transaction_names[ISAData[0].transaction_type],
-                                addr_str,
-                                ISABusData[0].data_valid ? (ISAData[0].data & 0xFF) : 0xFF,
-                                ISAData[0].wait_states
-                            );
-                        }
-                        
-                        // Reset for next transaction
-                        ISAData[0].state = ISA_STATE_IDLE;
-                        ISAData[0].transaction_type = ISA_TRANS_NONE;
-                        LogDebug(pctx, 1, "Transaction completed");
-                    }
-                    
-                    // Check for timeout (if commands stay asserted for too long)
-                    if (ISAData[0].bus_timing_cycles > 10)
-                    {
-                        ISAData[0].timed_out = 1;
-                        ISAData[0].protocol_error = 1;
-                        snprintf(ISAData[0].error_message, sizeof(ISAData[0].error_message), 
-                                 "Command signals remain asserted too long - possible timeout");
-                        LogDebug(pctx, 0, "ERROR: %s", ISAData[0].error_message);
-                        
-                        // Create an error entry and reset state machine
-                        char addr_str[20];
-                        FormatAddress(addr_str, sizeof(addr_str), ISAData[0].address);
-                        
-                        CreateSequenceEntry(
-                            ISAData[0].sequence,
-                            ISA_TRANS_ERROR,
-                            1,
-                            "ERROR: %s transaction timed out | Addr: %s | Cycles: %d",
-                            transaction_names[ISAData[0].transaction_type],
-                            addr_str,
-                            ISAData[0].bus_timing_cycles
-                        );
-                        
-                        // Reset for next transaction
-                        ISAData[0].state = ISA_STATE_IDLE;
-                        ISAData[0].transaction_type = ISA_TRANS_NONE;
-                    }
-                    break;
-                    
-                case ISA_STATE_REFRESH:
-                    // Memory refresh cycle
-                    if (bclk_rising_edge)
-                    {
-                        ISAData[0].bus_timing_cycles++;
-                    }
-                    
-                    // Check for refresh signal deassertion to mark the end
-                    if (refresh_rising_edge)
-                    {
-                        ISAData[0].last_sequence = seq;
-                        
-                        // Create sequence entry for refresh cycle
-                        CreateSequenceEntry(
-                            ISAData[0].sequence,
-                            ISA_TRANS_REFRESH,
-                            0,
-                            "Memory Refresh Cycle | Cycles: %d",
-                            ISAData[0].bus_timing_cycles
-                        );
-                        
-                        // Reset for next transaction
-                        ISAData[0].state = ISA_STATE_IDLE;
-                        ISAData[0].transaction_type = ISA_TRANS_NONE;
-                        LogDebug(pctx, 1, "Refresh cycle completed");
-                    }
-                    
-                    // Check for timeout
-                    if (ISAData[0].bus_timing_cycles > 10)
-                    {
-                        ISAData[0].timed_out = 1;
-                        ISAData[0].protocol_error = 1;
-                        snprintf(ISAData[0].error_message, sizeof(ISAData[0].error_message), 
-                                 "Refresh cycle too long - possible timeout");
-                        LogDebug(pctx, 0, "ERROR: %s", ISAData[0].error_message);
-                        
-                        // Create an error entry and reset state machine
-                        CreateSequenceEntry(
-                            ISAData[0].sequence,
-                            ISA_TRANS_ERROR,
-                            1,
-                            "ERROR: Refresh cycle timed out | Cycles: %d",
-                            ISAData[0].bus_timing_cycles
-                        );
-                        
-                        // Reset for next transaction
-                        ISAData[0].state = ISA_STATE_IDLE;
-                        ISAData[0].transaction_type = ISA_TRANS_NONE;
-                    }
-                    break;
-            }
-            
-            // Save previous signal states for edge detection in next iteration
-            prev_ctrl_signals = ctrl_signals;
-            prev_address = address;
-            prev_data = data;
-        }
-        
-        // Final check for any incomplete transactions
-        if (ISAData[0].state != ISA_STATE_IDLE && ISAData[0].transaction_type != ISA_TRANS_NONE)
+        // Keep the user marks if this is the capture they were set on and
+        // the mirrored samples if they still match the host; the worker
+        // keeps the checkpoints on the same terms once it knows the features
+        CaptureHash = CaptureSignature(pctx, firstseq, lastseq);
+        UserMarks.bind(firstseq, lastseq, CaptureHash);
+        if (!SampleMirror.bind(pctx->lactx, firstseq, lastseq, CaptureHash))
         {
-            LogDebug(pctx, 0, "Warning: Incomplete transaction at end of capture");
-            
-            // Create a warning entry for the incomplete transaction
-            char addr_str[20] = "Unknown";
-            if (ISABusData[0].addr_valid)
-            {
-                FormatAddress(addr_str, sizeof(addr_str), ISAData[0].address);
-            }
-            
-            CreateSequenceEntry(
-                ISAData[0].sequence,
-                ISAData[0].transaction_type,
-                1,
-                "WARNING: Incomplete %s | Addr: %s | State: %d",
-                transaction_names[ISAData[0].transaction_type],
-                addr_str,
-                ISAData[0].state
-            );
+            Checkpoints.clear();
         }
         
-        // Set up the text pointers
-        it = SeqDataVector.begin();
-        while (it != SeqDataVector.end())
-        {
-            it->seq_data.textp = it->seq_data.text;
-            it->seq_data.text2 = it->seq_data.text2_buf;
-            it++;
-        }
+        // Initialize ISA data structures
+        ResetDecoder();
+        ClearRecords();
+        GlitchFilter.configure(glitch_filter_width[set_glitch_filter], ISA_GLITCH_LINES);
         
-        LogDebug(pctx, 0, "Processing completed - found %d sequences", SeqDataVector.size());
+        // Nothing is published until the worker has found the resync point
+        CaptureFirst = firstseq;
+        CaptureLast = lastseq;
+        ResyncSeq = firstseq;
+        ResumeSeq = initseq;
+        LateDone = firstseq - 1;
+        EarlyPending = 0;
+        DecodeAborted = 0;
+        StartDecode(pctx);
     }
     
-    // Find the requested sequence
-    it = SeqDataVector.begin();
-    while ((it != SeqDataVector.end()) && (seqinfo == NULL))
+    DecodeLock.enter();
+    if (PendingRange(initseq) >= 0)
     {
-        if (it->seq_number == initseq)
+        // Every sample not decoded yet reads as the placeholder, so the
+        // host asks again for each of them when it next draws the rows
+        memset(&PendingRow, 0, sizeof(PendingRow));
+        snprintf(PendingRow.text, sizeof(PendingRow.text), DecodeAborted ? "Decode aborted" : "Decoding...");
+        PendingRow.textp = PendingRow.text;
+        PendingRow.text2 = PendingRow.text2_buf;
+        PendingRow.flags = 2;  // Grey background for status
+        seqinfo = &PendingRow;
+    }
+    else
+    {
+        // Find the requested sequence
+        int index = FindRecord(initseq);
+        if (index < PublishedRecords && Records[index].seq_number == initseq)
         {
-            seqinfo = &(it->seq_data);
+            seqinfo = RenderRow(index);
             LogDebug(pctx, 9, "%s: seq: %d text: [%s]", "ParseSeq", initseq, seqinfo->textp);
         }
-        it++;
     }
+    DecodeLock.leave();
     
     return seqinfo;
 }
@@ -757,32 +993,48 @@ int ParseMarkNext(struct pctx *pctx, int seq, int a3)
 {
     LogDebug(pctx, 9, "%s: sequence %d, a3 %d", "ParseMarkNext", seq, a3);
     
-    // Find the next marked sequence
-    if (SeqDataVector.size() == 0)
-        return seq;
-    
-    TVSeqData::iterator it = SeqDataVector.begin();
-    while (it != SeqDataVector.end())
+    DecodeLock.enter();
+    int next = seq;
+    int pending = PendingRange(seq + 1);
+    if (pending >= 0)
     {
-        if (it->seq_number > seq)
-            return it->seq_number;
-        it++;
+        // Stop at the placeholder until the rows behind it are decoded
+        if (pending > seq)
+            next = pending;
     }
+    else
+    {
+        // Find the next marked sequence
+        int index = FindRecord(seq + 1);
+        if (index < PublishedRecords && PendingRange(Records[index].seq_number) < 0)
+            next = Records[index].seq_number;
+        else if (LateDone < CaptureLast)
+            next = LateDone + 1;
+    }
+    DecodeLock.leave();
+    
+    // User marks are stops as well
+    int mark;
+    if (UserMarks.next(seq, mark) && (next == seq || mark < next))
+        next = mark;
     
-    // If we reach here, no next sequence found, return the current one
-    return seq;
+    // If no next sequence was found this is the current one
+    return next;
 }
 
 int ParseMarkSet(struct pctx *pctx, int seq, int a3)
 {
-    LogDebug(pctx, 9, "%s", "ParseMarkSet");
+    LogDebug(pctx, 9, "%s: sequence %d, a3 %d", "ParseMarkSet", seq, a3);
+    
+    // A nonzero a3 marks the sequence, zero clears the mark
+    UserMarks.set(seq, a3 != 0);
     return 0;
 }
 
 int ParseMarkGet(struct pctx *pctx, int seq)
 {
     LogDebug(pctx, 9, "%s: sequence %d", "ParseMarkGet", seq);
-    return seq;
+    return UserMarks.test(seq) ? 1 : 0;
 }
 
 int ParseMarkMenu(struct pctx *pctx, int seq, int a3, int a4, int a5)
@@ -802,7 +1054,7 @@ int ParseInfo(struct pctx *pctx, unsigned int request)
         case MODEINFO_MAX_GROUP:
             return ARRAY_SIZE(groupinfo);
         case MODEINFO_GETNAME:
-            return (int)"ISA_Min";
+            return (int)(size_t)"ISA_Min";
         case 3:
             return 1;
         case MODEINFO_MAX_MODE:
@@ -819,7 +1071,8 @@ struct businfo *ParseBusInfo(struct pctx *pctx, uint16_t bus)
 {
     LogDebug(pctx, 6, "%s: %08x", "ParseBusInfo", bus);
     // Reset for parsing data
-    SeqDataVector.clear();
+    StopDecode();
+    ClearRecords();
     processing_done = 0;
     
     if (bus >= ARRAY_SIZE(businfo))
@@ -890,6 +1143,16 @@ int ParseModeGetPut(struct pctx *pctx, int mode, int value, int request)
                     FeatureConfig.enabled_features |= ISA_FEATURE_16BIT;
                 break;
                 
+            case 3:
+                // AUTO_DETECT setting
+                FeatureConfig.auto_detect = value;
+                break;
+                
+            case 4:
+                // GLITCH_FILTER setting
+                set_glitch_filter = value;
+                break;
+                
             default:
                 break;
         }
@@ -919,6 +1182,16 @@ int ParseModeGetPut(struct pctx *pctx, int mode, int value, int request)
                 value = FeatureConfig.data_width;
                 break;
                 
+            case 3:
+                // AUTO_DETECT setting
+                value = FeatureConfig.auto_detect;
+                break;
+                
+            case 4:
+                // GLITCH_FILTER setting
+                value = set_glitch_filter;
+                break;
+                
             default:
                 value = 0;
                 break;
@@ -1,8 +1,14 @@
 #ifndef ISA_MINIMAL_H
 #define ISA_MINIMAL_H
 
-#include "..\ISA\stdint.h"
-#include "..\ISA\compat.h"
+#include "../ISA/stdint.h"
+#include "../ISA/compat.h"
+#include "../ISA/platform.h"
+#include "../ISA/markset.h"
+#include "../ISA/chanmap.h"
+#include "../ISA/checkpoint.h"
+#include "../ISA/mirror.h"
+#include "../ISA/textout.h"
 #include <vector>
 using namespace std;
 
@@ -10,12 +16,9 @@ using namespace std;
         Defines
 *********************************************************/
 
-// Feature detection flags
-#define ISA_FEATURE_16BIT        0x01    // Support for 16-bit data bus
-#define ISA_FEATURE_20BIT_ADDR   0x02    // Support for 20-bit address bus
-#define ISA_FEATURE_24BIT_ADDR   0x04    // Support for 24-bit address bus
-#define ISA_FEATURE_DMA          0x08    // Support for DMA operations
-#define ISA_FEATURE_IRQ          0x10    // Support for IRQ signals
+// Feature flags the decoder is specialized on (see TISAEngine in isaengine.h)
+#define ISA_DECODE_FEATURES      (ISA_FEATURE_16BIT | ISA_FEATURE_20BIT_ADDR | ISA_FEATURE_24BIT_ADDR | \
+                                  ISA_FEATURE_REFRESH | ISA_FEATURE_IOCHRDY)
 
 // ISA Bus Core Signals (Required)
 #define ISA_BCLK        0x00000001  // Bus Clock
@@ -50,34 +53,25 @@ using namespace std;
 // Data Lines
 #define ISA_DATA_MASK   0x0000FFFF  // 16-bit data bus
 
-// ISA state machine states
-enum ISA_STATE {
-    ISA_STATE_IDLE,
-    ISA_STATE_T1,         // First clock cycle of bus cycle
-    ISA_STATE_T2,         // Second clock cycle of bus cycle - data transfer
-    ISA_STATE_TW,         // Wait states
-    ISA_STATE_T3,         // Third and final clock cycle of bus cycle
-    ISA_STATE_REFRESH     // Memory refresh cycle
-};
+// Feature detection prescan
+#define ISA_PRESCAN_SAMPLES  65536      // Samples examined before the main pass
+#define ISA_PRESCAN_CTRL     (ISA_SBHE | ISA_REFRESH | ISA_IOCHRDY)  // Optional lines looked for
+#define ISA_ADDR_20BIT_LINES 0x000F0000 // A16-A19
+#define ISA_ADDR_24BIT_LINES 0x00F00000 // A20-A23
 
-// ISA transaction types
-enum ISA_TRANSACTION_TYPE {
-    ISA_TRANS_NONE,
-    ISA_TRANS_IO_READ_BYTE,    // 8-bit I/O read
-    ISA_TRANS_IO_READ_WORD,    // 16-bit I/O read
-    ISA_TRANS_IO_WRITE_BYTE,   // 8-bit I/O write
-    ISA_TRANS_IO_WRITE_WORD,   // 16-bit I/O write
-    ISA_TRANS_MEM_READ_BYTE,   // 8-bit memory read
-    ISA_TRANS_MEM_READ_WORD,   // 16-bit memory read
-    ISA_TRANS_MEM_WRITE_BYTE,  // 8-bit memory write
-    ISA_TRANS_MEM_WRITE_WORD,  // 16-bit memory write
-    ISA_TRANS_DMA_READ_BYTE,   // 8-bit DMA read
-    ISA_TRANS_DMA_READ_WORD,   // 16-bit DMA read
-    ISA_TRANS_DMA_WRITE_BYTE,  // 8-bit DMA write
-    ISA_TRANS_DMA_WRITE_WORD,  // 16-bit DMA write
-    ISA_TRANS_REFRESH,         // Memory refresh cycle
-    ISA_TRANS_ERROR            // Error condition
-};
+// Result rows
+#define ISA_RENDER_CACHE     256        // Rendered rows kept for the display (power of 2)
+
+// Trigger-first decoding
+#define ISA_RESYNC_WINDOW    65536      // Samples searched back from the trigger for a resync point
+#define ISA_COMMAND_MASK     (ISA_IOR | ISA_IOW | ISA_MEMR | ISA_MEMW)
+
+// Background decoding
+#define ISA_DECODE_CHUNK     65536      // Samples decoded per published chunk
+
+// Glitch filter: the control lines it applies to. BCLK is left out, its
+// pulses are only a few samples wide at a slow sample rate.
+#define ISA_GLITCH_LINES     ((ISA_CORE_MASK | ISA_OPT_MASK) & ~ISA_BCLK)
 
 /*********************************************************
         TLA Types
@@ -133,6 +127,8 @@ struct pctx_functable {
     void (*rda_free)(void *p);
     void *(*rda_calloc)(int memb, int size);
     int (*LAInfo)(struct lactx *, enum TLA_INFO, int16_t bus);
+    int (*LABusModTrigSample)(struct lactx *, int16_t bus);
+    int (*LAProgAbort)(struct lactx *);
 };
 
 struct pctx {
@@ -196,14 +192,14 @@ struct lafunc {
     void (*LAWhichBusMod_)(void);                       /* 84 */
     void (*LASeqDisplayFormat_)(void);                  /* 88 */
     void (*LAInteractiveUI2_)(void);                    /* 8c */
-    void (*LAProgAbort_)(void);                         /* 90 */
+    int  (*LAProgAbort)(struct lactx *);                /* 90 */
     void (*LATimestamp_ps_ToText)(void);                /* 94 */
     void (*LATimeStampDisplayFormat)(void);             /* 98 */
     void (*LAReferenceTime_ps_)(void);                  /* 9c */
     void (*LABusModSysTrigTime_ps_)(void);              /* a0 */
     void (*LABusModFrameOffset_ps_)(void);              /* a4 */
     void (*LABusModTimeToUserAlignedTime_ps_)(void);    /* a8 */
-    void (*LABusModTrigSample)(void);                   /* ac */
+    int  (*LABusModTrigSample)(struct lactx *, int16_t bus); /* ac */
     void (*LABusModWallClockStart_)(void);              /* b0 */
     void *field_B4;                                     /* b4 */
     void (*LAReferenceTime_ps_2)(void);                 /* b8 */
@@ -217,71 +213,55 @@ struct lafunc {
     void *field_DC;                                     /* d8 */
 };
 
-// Data structures
-typedef struct TISAData
+// Signal layout for the shared decoder in isaengine.h. There are no DMA or
+// IRQ groups, DACK and DRQ are single any-channel lines, and IOCHK# and
+// MASTER# are probed but not decoded.
+struct TISAMinimalLayout
 {
-    // Transaction information
-    int sequence;             // Starting sequence number
-    int last_sequence;        // Ending sequence number
-    int state;                // Current state in ISA state machine
-    int transaction_type;     // Type of ISA transaction
-    uint32_t address;         // ISA bus address (up to 20 bits)
-    uint16_t data;            // ISA bus data (8 or 16 bits)
-    
-    // Signal state tracking
-    int ior_active;           // IOR# is active (low)
-    int iow_active;           // IOW# is active (low)
-    int memr_active;          // MEMR# is active (low)
-    int memw_active;          // MEMW# is active (low)
-    int refresh_active;       // REFRESH# is active (low)
-    int sbhe_active;          // SBHE# is active (low)
-    int iochrdy_active;       // IOCHRDY is active (high)
-    int aen_active;           // AEN is active (high)
-    int master_active;        // MASTER# is active (low)
-    int tc_active;            // TC is active (high)
-    
-    // Transaction attributes
-    int wait_states;          // Number of wait states in current transaction
-    int is_16bit;             // Is this a 16-bit transaction?
-    
-    // Address decoding
-    int use_io_space;         // I/O space (vs memory space)
-    
-    // Timing and error tracking
-    int bus_timing_cycles;    // Bus cycles for timing verification
-    int timed_out;            // Transaction timed out
-    int protocol_error;       // Protocol violation detected
-    char error_message[64];   // Error message if applicable
-    
-} TISAData;
-
-// ISA address and data structure for tracking component states
-typedef struct TISABusData {
-    int addr_latch_state;     // 0 = not latched, 1 = partially latched, 2 = fully latched
-    uint32_t partial_addr;    // Address accumulator during latching
-    uint32_t latched_addr;    // Fully latched address
-    uint16_t pending_data;    // Data accumulator during data phase
-    uint16_t data;            // Completed data transfer
-    int addr_valid;           // Address has been validated
-    int data_valid;           // Data has been validated
-    int bus_width;            // Current bus width (8 or 16 bits)
-} TISABusData;
-
-typedef struct TSeqData
+    enum
+    {
+        CONTROL_GROUP = 0, ADDR_GROUP = 1, DATA_GROUP = 2, DMA_GROUP = -1, IRQ_GROUP = -1,
+        
+        BCLK = ISA_BCLK, ALE = ISA_ALE, IOR = ISA_IOR, IOW = ISA_IOW,
+        MEMR = ISA_MEMR, MEMW = ISA_MEMW, REFRESH = ISA_REFRESH, MASTER = 0,
+        SBHE = ISA_SBHE, IOCHRDY = ISA_IOCHRDY, AEN = ISA_AEN, IOCHK = 0,
+        RESET = ISA_RESET,
+        
+        DACK0 = 0, DACK1 = 0, DACK2 = 0, DACK3 = 0, DACK5 = 0, DACK6 = 0, DACK7 = 0, TC = 0,
+        
+        IRQ2 = 0, IRQ3 = 0, IRQ4 = 0, IRQ5 = 0, IRQ6 = 0, IRQ7 = 0,
+        IRQ9 = 0, IRQ10 = 0, IRQ11 = 0, IRQ12 = 0, IRQ14 = 0, IRQ15 = 0
+    };
+};
+
+// Packed result row; the text is rendered only when the host asks for it
+typedef struct TISARecord
 {
-    int seq_number;
-    struct sequence seq_data;
-} TSeqData;
+    int seq_number;           // Sequence the row is shown at
+    uint32_t address;         // Latched address (up to 24 bits)
+    uint16_t data;            // Transferred data, 0xFF/0xFFFF if not captured
+    uint8_t kind;             // ISA_ROW_KIND
+    uint8_t trans_type;       // ISA_TRANSACTION_TYPE (features for ISA_ROW_FEATURES)
+    uint8_t count;            // Wait states, bus cycles or state, depending on kind
+    uint8_t flags;            // Display flags, as in struct sequence
+    uint8_t addr_valid;       // Address was latched (ISA_ROW_INCOMPLETE)
+    uint8_t reserved;
+} TISARecord;                 // 16 bytes
+
+typedef vector<TISARecord> TVISARecord;
 
-typedef vector<TSeqData> TVSeqData;
+// Rendered row handed to the host
+typedef struct TISARenderSlot
+{
+    int record;               // Index of the rendered record, -1 if empty
+    struct sequence seq_data;
+} TISARenderSlot;
 
 typedef struct TISAFeatureConfig {
     int enabled_features;     // Bitmap of enabled features
     int addr_width;           // Address width in bits (16, 20, or 24)
     int data_width;           // Data width in bits (8 or 16)
-    int addr_group;           // Group number for address signals
-    int data_group;           // Group number for data signals
-    int control_group;        // Group number for control signals
+    int auto_detect;          // Detect features from the capture before decoding
 } TISAFeatureConfig;
 
 // Configuration structure for TLA 7L2
@@ -301,20 +281,20 @@ typedef struct T7L2Config {
 *********************************************************/
 extern "C"
 {
-__declspec(dllexport) struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *func);
-__declspec(dllexport) int ParseFinish(struct pctx *pctx);
-__declspec(dllexport) int ParseInfo(struct pctx *pctx, unsigned int request);
-__declspec(dllexport) int ParseMarkMenu(struct pctx *, int, int, int, int);
-__declspec(dllexport) int ParseMarkGet(struct pctx *pctx, int seq);
-__declspec(dllexport) int ParseMarkSet(struct pctx *pctx, int seq, int);
-__declspec(dllexport) int ParseMarkNext(struct pctx *pctx, int seq, int);
-__declspec(dllexport) int ParseModeGetPut(struct pctx *pctx, int mode, int, int request);
-__declspec(dllexport) struct sequence *ParseSeq(struct pctx *, int seq);
-__declspec(dllexport) struct businfo *ParseBusInfo(struct pctx *, uint16_t bus);
-__declspec(dllexport) struct modeinfo *ParseModeInfo(struct pctx *pctx, uint16_t mode);
-__declspec(dllexport) struct groupinfo *ParseGroupInfo(struct pctx *pctx, uint16_t group);
-__declspec(dllexport) int ParseDisasmReinit(struct pctx *, int request);
-__declspec(dllexport) int ParseExtInfo_(struct pctx *pctx);
+PARSE_EXPORT struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *func);
+PARSE_EXPORT int ParseFinish(struct pctx *pctx);
+PARSE_EXPORT int ParseInfo(struct pctx *pctx, unsigned int request);
+PARSE_EXPORT int ParseMarkMenu(struct pctx *, int, int, int, int);
+PARSE_EXPORT int ParseMarkGet(struct pctx *pctx, int seq);
+PARSE_EXPORT int ParseMarkSet(struct pctx *pctx, int seq, int);
+PARSE_EXPORT int ParseMarkNext(struct pctx *pctx, int seq, int);
+PARSE_EXPORT int ParseModeGetPut(struct pctx *pctx, int mode, int, int request);
+PARSE_EXPORT struct sequence *ParseSeq(struct pctx *, int seq);
+PARSE_EXPORT struct businfo *ParseBusInfo(struct pctx *, uint16_t bus);
+PARSE_EXPORT struct modeinfo *ParseModeInfo(struct pctx *pctx, uint16_t mode);
+PARSE_EXPORT struct groupinfo *ParseGroupInfo(struct pctx *pctx, uint16_t group);
+PARSE_EXPORT int ParseDisasmReinit(struct pctx *, int request);
+PARSE_EXPORT int ParseExtInfo_(struct pctx *pctx);
 }
 
 #endif // ISA_Minimal
\ No newline at end of file
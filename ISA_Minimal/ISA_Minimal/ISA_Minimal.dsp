@@ -98,6 +98,34 @@ SOURCE=..\ISA_Minimal.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=..\..\ISA\bitplane.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\ISA\chanmap.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\ISA\checkpoint.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\ISA\deglitch.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\ISA\isaengine.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\ISA\mirror.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\ISA\pipeline.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\ISA_Minimal.h
 # End Source File
 # End Group
@@ -2,10 +2,7 @@
 using namespace std;
 #include "PCI.h"
 #include <stdio.h>
-#include <fcntl.h>
-#include <io.h>
 #include <stdarg.h>
-#include <windows.h>
 #include <time.h>
 #include <errno.h>
 //#define WITH_DEBUG
@@ -13,7 +10,6 @@ using namespace std;
 /*********************************************************
         Globals signal setup
 *********************************************************/
-static FILE *logfile = NULL;
 const char *modeinfo_names[MODEINFO_MAX] = {
     "MAX_BUS",
     "MAX_GROUP",
@@ -26,11 +22,14 @@ const int bustable[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
 
 // Define groups
 const struct groupinfo groupinfo[] = { 
-    { "PCI", 0, 0, 0, 0, 0xFFFFFF, 0 },        // All PCI signals
+    { "PCI", 0, 0, 0, 0, (unsigned short)0xFFFFFF, 0 }, // All PCI signals
     { "PCISig", 0, 0, 0, 0, 0xFFFF, 0 },       // PCI control signals
-    { "PCIAD", 0, 0, 0, 0, 0xFF0000, 0 },      // PCI address/data signals
+    { "PCIAD", 0, 0, 0, 0, (unsigned short)0xFF0000, 0 }, // PCI address/data signals
     { "PCIInt", 0, 0, 0, 0, 0x3C00, 0 },       // PCI interrupt signals
-    { "Traffic", 0, 0, 2, 1, 0x80, sizeof("Traffic")-1 } 
+    { "Traffic", 0, 0, 2, 1, 0x80, sizeof("Traffic")-1 },
+    // Groups added after PCI.tla was made go last so the indices above stay put
+    { "PCIAD64", 0, 0, 0, 0, 0xFFFF, 0 },      // AD[63:32] (64-bit mode only)
+    { "PCI64", 0, 0, 0, 0, 0x7F, 0 }           // 64-bit extension signals
 };
 
 const struct businfo businfo[] = { { 0, 0, 0, 0, 0, 0x20000, NULL, 0 } };
@@ -42,6 +41,8 @@ const char *pci_arb_mode[] = { "Simple", "Fairness", "Priority", NULL };
 const char *pci_cache_line_size[] = { "Disabled", "16 Bytes", "32 Bytes", "64 Bytes", NULL };
 const char *pci_latency[] = { "Minimal", "Standard", "Extended", NULL };
 const char *pci_retry_policy[] = { "Immediate Retry", "Delayed Retry", NULL };
+const char *pci_result_ram[] = { "4 MB", "16 MB", "64 MB", "Unlimited", NULL };
+const char *pci_glitch_filter[] = { "Off", "2 Samples", "3 Samples", "4 Samples", "8 Samples", NULL };
 
 const struct modeinfo modeinfo[] = { 
     { "BUS_WIDTH", pci_bus_width, 0, 1 },
@@ -49,7 +50,45 @@ const struct modeinfo modeinfo[] = {
     { "ARB_MODE", pci_arb_mode, 0, 2 },
     { "CACHELINE", pci_cache_line_size, 0, 3 },
     { "LATENCY", pci_latency, 0, 2 },
-    { "RETRY_POLICY", pci_retry_policy, 0, 1 }
+    { "RETRY_POLICY", pci_retry_policy, 0, 1 },
+    { "RESULT_RAM", pci_result_ram, 1, 3 },
+    { "GLITCH_FILTER", pci_glitch_filter, 0, 4 }
+};
+
+// RAM budget of the result store for each RESULT_RAM choice, 0 = no limit
+const size_t pci_result_ram_bytes[] = { 4 << 20, 16 << 20, 64 << 20, 0 };
+
+// Shortest pulse kept for each GLITCH_FILTER choice, 0 = filter off
+const int pci_glitch_filter_width[] = { 0, 2, 3, 4, 8 };
+
+// Channels the decoder tests, by the .tla user group they are wired in
+const TChannelGroupDef pci_channel_groups[] = {
+    { PCI_GROUP_ALL, "PCI" },
+    { PCI_GROUP_AD, "PCIAD" }
+};
+
+const TChannelDef pci_channels[] = {
+    { PCI_GROUP_ALL, "PCI_CLK", PCI_CLK, 0 },
+    { PCI_GROUP_ALL, "PCI_RST", PCI_RST, 0 },
+    { PCI_GROUP_ALL, "PCI_FRAME", PCI_FRAME, 0 },
+    { PCI_GROUP_ALL, "PCI_IRDY", PCI_IRDY, 0 },
+    { PCI_GROUP_ALL, "PCI_TRDY", PCI_TRDY, 0 },
+    { PCI_GROUP_ALL, "PCI_STOP", PCI_STOP, 0 },
+    { PCI_GROUP_ALL, "PCI_DEVSEL", PCI_DEVSEL, 0 },
+    { PCI_GROUP_ALL, "PCI_PAR", PCI_PAR, 0 },
+    { PCI_GROUP_ALL, "PCI_PERR", PCI_PERR, 0 },
+    { PCI_GROUP_ALL, "PCI_SERR", PCI_SERR, 0 },
+    { PCI_GROUP_ALL, "PCI_INTA", PCI_INTA, 0 },
+    { PCI_GROUP_ALL, "PCI_INTB", PCI_INTB, 0 },
+    { PCI_GROUP_ALL, "PCI_INTC", PCI_INTC, 0 },
+    { PCI_GROUP_ALL, "PCI_INTD", PCI_INTD, 0 },
+    { PCI_GROUP_ALL, "PCI_GNT", PCI_GNT, 0 },
+    { PCI_GROUP_ALL, "PCI_REQ", PCI_REQ, 0 },
+    { PCI_GROUP_ALL, "PCI_C_BE", PCI_C_BE, 1 },
+    { PCI_GROUP_ALL, "PCI_IDSEL", PCI_IDSEL, 0 },
+    { PCI_GROUP_ALL, "PCI_LOCK", PCI_LOCK, 0 },
+    { PCI_GROUP_ALL, "PCI_AD", PCI_AD, 1 },
+    { PCI_GROUP_AD, "PCI_AD", 0xFFFFFFFF, 1 }
 };
 
 // PCI Command names for better readability
@@ -89,12 +128,43 @@ const char* pci_burst_names[] = {
     "Continuous"         // 3
 };
 
+// Status row texts, indexed by PCI_STATUS_ROW
+const char* pci_status_names[] = {
+    "",
+    "PCI Reset during transaction",
+    "PCI Reset",
+    "Request for bus",
+    "Bus grant without request",
+    "Bus granted to requestor",
+    "End of bus parking",
+    "INTA# Asserted",
+    "INTB# Asserted",
+    "INTC# Asserted",
+    "INTD# Asserted",
+    "INTA# Deasserted",
+    "INTB# Deasserted",
+    "INTC# Deasserted",
+    "INTD# Deasserted",
+    "Glitch filter"
+};
+
 /*********************************************************
         PCI analysis data
 *********************************************************/
 static TPCIData PCIData;     // Current transaction being processed
-static vector<TPCIData> PCITransactions; // All completed transactions
-static TVSeqData SeqDataVector;    // Vector with sequence results
+static TPageArena result_arena; // Pages of the stores below, from the host's heap
+static TPagedStore<TPCIData> PCITransactions; // All completed transactions
+static TSeqDataStore SeqDataVector; // Sequence results
+static TRowIndex SeqDataIndex;     // Sequence number -> SeqDataVector row
+
+// Configuration space shadow, built from Config Read/Write transactions
+static vector<TPCIConfigShadow> ConfigShadows;   // One entry per function seen
+static vector< vector<TPCIConfigVersion> > ConfigHistories; // Versions of each register, by sequence
+static int ConfigShadowIndex[0x10000];           // BDF -> ConfigShadows index + 1
+
+// Interval index of programmed BARs, each sorted by base address
+static vector<TPCIBarWindow> MemWindows;         // Memory space windows
+static vector<TPCIBarWindow> IOWindows;          // I/O space windows
 
 // Settings
 static int set_bus_width;          // 32-bit or 64-bit
@@ -103,6 +173,8 @@ static int set_arb_mode;           // Arbitration mode
 static int set_cache_line_size;    // Cache line size
 static int set_latency;            // Latency timer
 static int set_retry_policy;       // Retry policy
+static int set_result_ram;         // RAM budget of the result store
+static int set_glitch_filter;      // Minimum pulse width on the control lines
 static int processing_done;        // Flag to avoid reprocessing
 
 // State machine variables
@@ -111,15 +183,79 @@ static bool in_transaction = false;    // Currently processing a transaction?
 static uint8_t current_command = 0;    // Current PCI command
 static uint32_t current_state = PCI_IDLE; // Current state machine state
 
+// Parity pipeline: PAR/PAR64 cover the AD and C/BE# driven on the previous clock
+static bool par_pending = false;       // Previous clock was an address or data phase
+static bool par64_pending = false;     // ...and it was a 64-bit phase
+static uint32_t par_expected = 0;      // Expected PAR level for the pending phase
+static uint32_t par64_expected = 0;    // Expected PAR64 level for the pending phase
+static int par_phase = 0;              // Phase the pending parity belongs to (-1 = address)
+static int parity_mismatches = 0;      // PAR/PAR64 mismatches in this pass
+
+// Samples are fetched a block at a time, ahead of the state machine, and
+// only clock edges are decoded
+#define PCI_EDGE_BLOCK 4096
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PCI_EDGE_SSE2
+#endif
+struct TPCISampleBlock
+{
+    int first;                             // Sequence of samples[0]
+    int count;
+    uint32_t previous;                     // Sample before the block, as the glitch filter passed it
+    uint32_t samples[PCI_EDGE_BLOCK + DEGLITCH_MAX_WIDTH]; // Group 0
+    int edge_count;
+    int edges[PCI_EDGE_BLOCK];             // Block offsets of CLK edges and resets
+    uint32_t ad[PCI_EDGE_BLOCK];           // AD at each edge out of reset
+    uint32_t ad_hi[PCI_EDGE_BLOCK];        // AD[63:32] at each edge, 64-bit bus
+    uint32_t signals64[PCI_EDGE_BLOCK];    // 64-bit extension at each edge, 64-bit bus
+};
+
+// Where the fetch stage of a pass is
+struct TPCIFetchState
+{
+    struct pctx *pctx;
+    int next_seq;                          // First sample of the next block
+    int lastseq;                           // Last sample of the pass
+    uint32_t previous;                     // Last sample of the block before
+};
+static TPipeline<TPCISampleBlock> sample_pipeline; // Blocks fetched ahead of the state machine
+
+// Trigger-first ordering: the worker starts at an idle clock up to
+// PCI_RESYNC_WINDOW samples ahead of the trigger and publishes from there to
+// the end of the capture. It then decodes the samples before that point on
+// its own, merges them in front and publishes them in one go; until then
+// they read as the placeholder row.
+#define PCI_RESYNC_WINDOW 65536
+static int resync_seq = 0;             // First sample of the trigger-first pass
+static int early_first = 0;            // First sample of the deferred early pass
+static bool early_pending = false;     // Early pass still to be decoded
+static bool early_overrun = false;     // Early pass is past resync_seq, where the late pass has the rows
+static bool early_running = false;     // Early pass is decoding; its rows are indexed once merged in front
+static int resume_seq = 0;             // First sample the host asked for
+static TCheckpoints<TPCICheckpoint> checkpoints; // Decoder state after each chunk
+
+// Background decode: a worker thread decodes the capture a chunk at a time
+// and publishes each chunk as it completes; ParseSeq only reads what has
+// been published and hands out copies of the rows
+#define PCI_DECODE_CHUNK 65536         // Samples per published chunk
+#define PCI_ROW_SLOTS 256              // Rows formatted for the host (power of 2)
+static TThread decode_thread;          // Running worker
+static volatile long decode_cancel = 0; // Ask the worker to stop at the next chunk
+static TLock decode_lock;              // Guards the rows and the published range
+static int decode_last = 0;            // Last sample of the capture
+static int late_done = 0;              // Last published sample of the trigger-first pass
+static bool decode_aborted = false;    // Pass stopped by the host's abort request
+static struct sequence RowSlots[PCI_ROW_SLOTS]; // Rows formatted for the host
+static struct sequence PendingRow;     // Placeholder for samples not decoded yet
+static TMarkSet user_marks;            // Sequences marked by the user
+static TChannelMap channel_map;        // Probe wiring read from PCI.tla
+static TSampleMirror sample_mirror;    // Compressed copy of the samples read from the host
+static TGlitchFilter glitch_filter;    // Removes short pulses ahead of the state machine
+
 /*********************************************************
         Helper Functions
 *********************************************************/
-// Extract specific signal from value
-static bool signal_active(uint32_t value, uint32_t signal_mask)
-{
-    return (value & signal_mask) != 0;
-}
-
 // Convert PCI command code to string
 static const char* get_command_string(uint8_t command)
 {
@@ -130,6 +266,21 @@ static const char* get_command_string(uint8_t command)
     }
 }
 
+// Group values with the channels moved to the PCI.h layout, used in place
+// of the host's LAGroupValue when PCI.tla wires a group differently. The
+// extract_ helpers below can then keep their constant masks and shifts.
+static int mapped_group_value(struct lactx *lactx, int seqno, int group)
+{
+    return channel_map.value(lactx, seqno, group);
+}
+
+// Group values through the sample mirror, so a re-decode of the same
+// capture does not read them from the host again
+static int mirrored_group_value(struct lactx *lactx, int seqno, int group)
+{
+    return (int)sample_mirror.value(lactx, seqno, group);
+}
+
 // Extract C/BE# signals (Command/Byte Enable)
 static uint8_t extract_command(uint32_t value)
 {
@@ -142,41 +293,148 @@ static uint8_t extract_byte_enables(uint32_t value)
     return (value & PCI_C_BE) >> 16;
 }
 
-// Extract address/data from AD signals
-static uint32_t extract_ad(uint32_t value)
-{
-    return (value & PCI_AD) >> 22;
-}
-
 // Check if a signal transition occurred (rising edge)
 static bool signal_rose(uint32_t current, uint32_t previous, uint32_t signal_mask)
 {
     return ((current & signal_mask) != 0) && ((previous & signal_mask) == 0);
 }
 
-// Check if a signal transition occurred (falling edge)
-static bool signal_fell(uint32_t current, uint32_t previous, uint32_t signal_mask)
-{
-    return ((current & signal_mask) == 0) && ((previous & signal_mask) != 0);
-}
-
 // Check if PCI reset occurred
 static bool reset_active(uint32_t value)
 {
     return (value & PCI_RST) == 0; // RST# is active low
 }
 
-// Check for parity error
-static bool check_parity(uint32_t value)
+// Parity of a 32-bit word: 1 if an odd number of bits are set.
+// The TLA controller CPUs have no POPCNT, so outside GCC this folds the word
+// down to a nibble and finishes with a 16-entry parity lookup held in 0x6996.
+static uint32_t parity32(uint32_t x)
 {
-    // Simplified parity check - real implementation would compute parity over AD and C/BE
-    return (value & PCI_PERR) == 0; // PERR# is active low
+#if defined(__GNUC__)
+    return (uint32_t)__builtin_parity(x);
+#else
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    return (0x6996 >> (x & 0xF)) & 1;
+#endif
 }
 
-// Check for system error
-static bool system_error(uint32_t value)
+// Latch the even parity PAR (and PAR64) must carry on the next clock.
+// AD and C/BE# are folded together first: parity(a ^ b) == parity(a) ^ parity(b).
+static void latch_parity(uint32_t ad, uint8_t cbe, uint32_t ad_hi, uint8_t cbe_hi, bool is_64bit, int phase)
 {
-    return (value & PCI_SERR) == 0; // SERR# is active low
+    par_expected = parity32(ad ^ cbe);
+    par64_expected = is_64bit ? parity32(ad_hi ^ cbe_hi) : 0;
+    par64_pending = is_64bit;
+    par_phase = phase;
+    par_pending = true;
+}
+
+// Compare PAR/PAR64 against the parity latched on the previous clock
+static void verify_parity(uint32_t signals, uint32_t signals64, TPCIData& transaction)
+{
+    bool bad = ((signals & PCI_PAR) != 0) != (par_expected != 0);
+    bool bad64 = par64_pending && (((signals64 & PCI64_PAR64) != 0) != (par64_expected != 0));
+    
+    if (bad || bad64)
+    {
+        if (!transaction.par_mismatch && !transaction.par64_mismatch)
+        {
+            transaction.par_mismatch_phase = par_phase;
+        }
+        transaction.par_mismatch |= bad;
+        transaction.par64_mismatch |= bad64;
+        parity_mismatches++;
+    }
+    
+    par_pending = false;
+    par64_pending = false;
+}
+
+// Index of the lowest set bit of a non-zero word
+static int lowest_bit(uint32_t x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#else
+    static const int debruijn[32] =
+    {
+        0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+        31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+    };
+    return debruijn[((x & (0 - x)) * 0x077CB531) >> 27];
+#endif
+}
+
+#ifdef PCI_EDGE_SSE2
+// CLK and RST# levels of 16 samples, one bit per sample. Each line is
+// shifted up to the sign bit and the signs are packed down to one byte per
+// sample, so one movemask picks up 16 samples.
+static void pack_clock_lines(const uint32_t *samples, uint32_t& clk, uint32_t& rst_high)
+{
+    __m128i s0 = _mm_loadu_si128((const __m128i *)(samples + 0));
+    __m128i s1 = _mm_loadu_si128((const __m128i *)(samples + 4));
+    __m128i s2 = _mm_loadu_si128((const __m128i *)(samples + 8));
+    __m128i s3 = _mm_loadu_si128((const __m128i *)(samples + 12));
+    
+    __m128i c01 = _mm_packs_epi32(_mm_slli_epi32(s0, 31), _mm_slli_epi32(s1, 31));
+    __m128i c23 = _mm_packs_epi32(_mm_slli_epi32(s2, 31), _mm_slli_epi32(s3, 31));
+    clk = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(c01, c23));
+    
+    __m128i r01 = _mm_packs_epi32(_mm_slli_epi32(s0, 30), _mm_slli_epi32(s1, 30));
+    __m128i r23 = _mm_packs_epi32(_mm_slli_epi32(s2, 30), _mm_slli_epi32(s3, 30));
+    rst_high = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(r01, r23));
+}
+#endif
+
+// Find the samples the state machine has to look at: CLK rising edges and
+// samples with RST# asserted. CLK and RST# are packed 32 samples to a word so
+// the edge test runs on a whole word at once; the CLK bit of the last sample
+// is carried into the next word. Where the compiler targets SSE2, full words
+// are packed 16 samples per instruction. Returns the number of indices in edges.
+static int extract_clock_edges(const uint32_t *samples, int count, uint32_t previous, int *edges)
+{
+    int edge_count = 0;
+    uint32_t carry = previous & PCI_CLK;
+
+    for (int base = 0; base < count; base += 32)
+    {
+        int width = count - base;
+        if (width > 32)
+            width = 32;
+
+        uint32_t clk = 0;
+        uint32_t rst = 0;
+#ifdef PCI_EDGE_SSE2
+        if (width == 32)
+        {
+            uint32_t clk_hi, rst_lo, rst_hi;
+            pack_clock_lines(samples + base, clk, rst_lo);
+            pack_clock_lines(samples + base + 16, clk_hi, rst_hi);
+            clk |= clk_hi << 16;
+            rst = ~(rst_lo | (rst_hi << 16)); // RST# is active low
+        }
+        else
+#endif
+        for (int bit = 0; bit < width; bit++)
+        {
+            uint32_t sample = samples[base + bit];
+            clk |= (sample & PCI_CLK) << bit;
+            rst |= ((~sample & PCI_RST) >> 1) << bit; // RST# is active low
+        }
+
+        uint32_t hits = (clk & ~((clk << 1) | carry)) | rst;
+        carry = (clk >> (width - 1)) & 1;
+
+        while (hits != 0)
+        {
+            edges[edge_count++] = base + lowest_bit(hits);
+            hits &= hits - 1;
+        }
+    }
+
+    return edge_count;
 }
 
 // Determine if a master abort occurred
@@ -187,14 +445,6 @@ static bool is_master_abort(uint32_t value)
     return ((value & PCI_FRAME) == 0) && ((value & PCI_DEVSEL) != 0);
 }
 
-// Determine if a target abort occurred
-static bool is_target_abort(uint32_t value)
-{
-    // Target abort occurs when DEVSEL# is deasserted during a transaction
-    // This is a simplified check
-    return ((value & PCI_TRDY) != 0) && ((value & PCI_STOP) == 0) && ((value & PCI_DEVSEL) != 0);
-}
-
 // Determine if this is a configuration transaction
 static bool is_config_transaction(uint8_t command)
 {
@@ -222,48 +472,517 @@ static bool is_burst_transaction(uint8_t command)
             command == PCI_CMD_MEM_WRITE_AND_INV);
 }
 
-// Format a transaction into a readable string
+// Decode the address phase of a configuration cycle. AD[1:0] give the type.
+// A Type 1 cycle carries bus and device; a Type 0 cycle is for the local
+// bus and selects its target through an IDSEL line, usually one of
+// AD[31:11], so the device is keyed by that line (AD11 = 0).
+static void decode_config_address(TPCIData& transaction, uint32_t ad)
+{
+    transaction.is_type1_config = (ad & 0x3) == 0x1;
+    if (transaction.is_type1_config)
+    {
+        transaction.bus_num = (uint8_t)((ad >> 16) & 0xFF);    // AD[23:16]
+        transaction.device_num = (uint8_t)((ad >> 11) & 0x1F); // AD[15:11]
+    }
+    else
+    {
+        transaction.bus_num = 0;
+        transaction.device_num = PCI_CFG_NO_IDSEL;
+        for (int line = 11; line < 32; line++)
+        {
+            if (ad & (1u << line))
+            {
+                transaction.device_num = (uint8_t)(line - 11);
+                break;
+            }
+        }
+    }
+    transaction.function_num = (uint8_t)((ad >> 8) & 0x7);     // AD[10:8]
+    transaction.config_reg = (uint8_t)(ad & 0xFC);             // AD[7:2]
+}
+
+// Convert C/BE# (active low) into a mask of the enabled data bytes
+static uint32_t byte_enable_mask(uint8_t byte_enables)
+{
+    uint32_t mask = 0;
+    if ((byte_enables & 0x1) == 0) mask |= 0x000000FF;
+    if ((byte_enables & 0x2) == 0) mask |= 0x0000FF00;
+    if ((byte_enables & 0x4) == 0) mask |= 0x00FF0000;
+    if ((byte_enables & 0x8) == 0) mask |= 0xFF000000;
+    return mask;
+}
+
+// Drop all shadowed configuration state
+static void config_shadow_clear()
+{
+    vector<TPCIConfigShadow>::iterator it;
+    for (it = ConfigShadows.begin(); it != ConfigShadows.end(); ++it)
+    {
+        ConfigShadowIndex[it->bdf] = 0;
+    }
+    ConfigShadows.clear();
+    ConfigHistories.clear();
+    MemWindows.clear();
+    IOWindows.clear();
+}
+
+// Find the shadow of a function, optionally creating it
+static TPCIConfigShadow *config_shadow_find(uint16_t bdf, bool create)
+{
+    if (ConfigShadowIndex[bdf] != 0)
+    {
+        return &ConfigShadows[ConfigShadowIndex[bdf] - 1];
+    }
+    if (!create)
+    {
+        return NULL;
+    }
+    
+    TPCIConfigShadow shadow;
+    memset(&shadow, 0, sizeof(shadow));
+    shadow.bdf = bdf;
+    for (int i = 0; i < PCI_CFG_DWORDS; i++)
+    {
+        shadow.history[i] = PCI_CFG_NO_VERSION;
+    }
+    ConfigShadows.push_back(shadow);
+    ConfigShadowIndex[bdf] = (int)ConfigShadows.size();
+    return &ConfigShadows.back();
+}
+
+// Index of the version of a register in effect at a sequence number, -1 if
+// the register was not seen before it (binary search on the sequences)
+static int config_version_at(const vector<TPCIConfigVersion>& history, int seq)
+{
+    int lo = 0;
+    int hi = (int)history.size();
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (history[mid].sequence <= seq)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo - 1;
+}
+
+// Merge one configuration data phase into the shadow. Writes always add a
+// register version; reads only when they show a value not known yet, so a
+// register polled over and over does not grow its history.
+static void config_shadow_record(uint16_t bdf, int reg, uint32_t data, uint8_t byte_enables, bool write, int seq)
+{
+    uint32_t mask = byte_enable_mask(byte_enables);
+    if (mask == 0)
+    {
+        return; // No bytes transferred
+    }
+    
+    TPCIConfigShadow *shadow = config_shadow_find(bdf, true);
+    int dword = (reg >> 2) & (PCI_CFG_DWORDS - 1);
+    if (shadow->history[dword] == PCI_CFG_NO_VERSION)
+    {
+        shadow->history[dword] = (int)ConfigHistories.size();
+        ConfigHistories.push_back(vector<TPCIConfigVersion>());
+    }
+    vector<TPCIConfigVersion>& history = ConfigHistories[shadow->history[dword]];
+    
+    TPCIConfigVersion version;
+    version.sequence = seq;
+    version.written = write ? 1 : 0;
+    version.value = data & mask;
+    version.valid_bytes = (uint8_t)((byte_enables ^ 0xF) & 0xF);
+    int older = config_version_at(history, seq);
+    if (older >= 0)
+    {
+        version.value |= history[older].value & ~mask;
+        version.valid_bytes |= history[older].valid_bytes;
+        if (!write && version.value == history[older].value &&
+            version.valid_bytes == history[older].valid_bytes)
+        {
+            return; // Read back what the shadow already holds
+        }
+    }
+    
+    history.insert(history.begin() + (older + 1), version);
+}
+
+// Value of a configuration register as of a sequence number; valid_bytes
+// (bit n = byte n) tells which bytes of it have been seen
+static bool config_shadow_lookup(uint16_t bdf, int reg, int seq, uint32_t *value, uint8_t *valid_bytes = NULL)
+{
+    TPCIConfigShadow *shadow = config_shadow_find(bdf, false);
+    if (shadow == NULL)
+    {
+        return false;
+    }
+    
+    int dword = (reg >> 2) & (PCI_CFG_DWORDS - 1);
+    if (shadow->history[dword] == PCI_CFG_NO_VERSION)
+    {
+        return false;
+    }
+    const vector<TPCIConfigVersion>& history = ConfigHistories[shadow->history[dword]];
+    int version = config_version_at(history, seq);
+    if (version < 0)
+    {
+        return false;
+    }
+    
+    *value = history[version].value;
+    if (valid_bytes != NULL)
+    {
+        *valid_bytes = history[version].valid_bytes;
+    }
+    return true;
+}
+
+// Drop the window decoded by one BAR
+static void bar_window_remove(vector<TPCIBarWindow>& windows, uint16_t bdf, int bar)
+{
+    vector<TPCIBarWindow>::iterator it = windows.begin();
+    while (it != windows.end())
+    {
+        if (it->bdf == bdf && it->bar == bar)
+            it = windows.erase(it);
+        else
+            ++it;
+    }
+}
+
+// Insert a window in base order. The newest programming wins over any
+// overlap, except that a window whose size is only guessed never pushes out
+// one with a measured size.
+static void bar_window_insert(const TPCIBarWindow& window)
+{
+    vector<TPCIBarWindow>& windows = window.is_io ? IOWindows : MemWindows;
+    vector<TPCIBarWindow>::iterator it;
+    if (!window.sized)
+    {
+        for (it = windows.begin(); it != windows.end(); ++it)
+        {
+            if (it->sized && it->base <= window.limit && window.base <= it->limit)
+            {
+                return;
+            }
+        }
+    }
+    
+    it = windows.begin();
+    while (it != windows.end())
+    {
+        if (it->base <= window.limit && window.base <= it->limit)
+            it = windows.erase(it);
+        else
+            ++it;
+    }
+    
+    it = windows.begin();
+    while (it != windows.end() && it->base < window.base)
+    {
+        ++it;
+    }
+    windows.insert(it, window);
+}
+
+// Find the window decoding an address (binary search on the window bases)
+static const TPCIBarWindow *bar_window_find(uint64_t address, bool is_io)
+{
+    const vector<TPCIBarWindow>& windows = is_io ? IOWindows : MemWindows;
+    int lo = 0;
+    int hi = (int)windows.size();
+    
+    // Find the first window starting above the address
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (windows[mid].base <= address)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    
+    if (lo == 0 || address > windows[lo - 1].limit)
+    {
+        return NULL;
+    }
+    return &windows[lo - 1];
+}
+
+// Re-derive the window of a programmed BAR from the shadowed registers
+static void bar_window_refresh(uint16_t bdf, int bar, int seq)
+{
+    bar_window_remove(MemWindows, bdf, bar);
+    bar_window_remove(IOWindows, bdf, bar);
+    
+    TPCIConfigShadow *shadow = config_shadow_find(bdf, false);
+    uint32_t value;
+    if (shadow == NULL || shadow->bar_state[bar] != PCI_BAR_PROGRAMMED ||
+        !config_shadow_lookup(bdf, PCI_CFG_BAR0 + bar * 4, seq, &value))
+    {
+        return;
+    }
+    
+    TPCIBarWindow window;
+    window.bdf = bdf;
+    window.bar = (uint8_t)bar;
+    window.is_io = (value & 0x1) != 0;
+    window.base = value & (window.is_io ? 0xFFFFFFFC : 0xFFFFFFF0);
+    
+    // 64-bit memory BARs take the upper address from the next register
+    uint32_t upper;
+    if (!window.is_io && (value & 0x6) == 0x4 && bar + 1 < PCI_CFG_BARS &&
+        config_shadow_lookup(bdf, PCI_CFG_BAR0 + (bar + 1) * 4, seq, &upper))
+    {
+        window.base |= (uint64_t)upper << 32;
+    }
+    
+    if (window.base == 0)
+    {
+        return; // Unassigned
+    }
+    
+    // Without a sizing probe, fall back to the natural alignment of the base.
+    // That can be far too large, so the window is marked as a guess.
+    uint64_t size = shadow->bar_size[bar];
+    window.sized = size != 0;
+    if (size == 0)
+    {
+        size = window.base & (~window.base + 1);
+    }
+    window.limit = window.base + size - 1;
+    
+    bar_window_insert(window);
+}
+
+// Follow the sizing and programming of one BAR through a config data phase
+static void bar_track(uint16_t bdf, int bar, uint32_t data, uint8_t byte_enables, bool write, int seq)
+{
+    TPCIConfigShadow *shadow = config_shadow_find(bdf, false);
+    if (shadow == NULL)
+    {
+        return;
+    }
+    
+    // Bridges (header type 1) only implement BAR0 and BAR1
+    uint32_t header;
+    if (bar >= 2 && config_shadow_lookup(bdf, PCI_CFG_HEADER_TYPE, seq, &header) &&
+        ((header >> 16) & 0x7F) == 1)
+    {
+        return;
+    }
+    
+    // Upper half of a 64-bit memory BAR: just re-derive the lower BAR's window
+    uint32_t lower;
+    if (bar > 0 && config_shadow_lookup(bdf, PCI_CFG_BAR0 + (bar - 1) * 4, seq, &lower) &&
+        (lower & 0x7) == 0x4)
+    {
+        bar_window_refresh(bdf, bar - 1, seq);
+        return;
+    }
+    
+    if (write)
+    {
+        if (data == 0xFFFFFFFF && byte_enable_mask(byte_enables) == 0xFFFFFFFF)
+        {
+            // All-ones write: the BAR is being sized, it stops decoding its old window
+            shadow->bar_state[bar] = PCI_BAR_SIZING;
+        }
+        else
+        {
+            shadow->bar_state[bar] = PCI_BAR_PROGRAMMED;
+        }
+        bar_window_refresh(bdf, bar, seq);
+    }
+    else if (shadow->bar_state[bar] == PCI_BAR_SIZING)
+    {
+        // Read-back of the probe: the writable bits give the decode size
+        uint32_t mask = (data & 0x1) ? ((data | 0xFFFF0000) & 0xFFFFFFFC) : (data & 0xFFFFFFF0);
+        shadow->bar_size[bar] = mask ? (~mask + 1) : 0;
+        shadow->bar_state[bar] = PCI_BAR_SIZED;
+    }
+}
+
+// Feed a completed configuration transaction into the shadow
+static void config_shadow_update(const TPCIData& transaction)
+{
+    if (!is_config_transaction(transaction.command) || transaction.master_abort || transaction.target_abort)
+    {
+        return;
+    }
+    
+    uint16_t bdf = PCI_BDF(transaction.bus_num, transaction.device_num, transaction.function_num);
+    bool write = transaction.command == PCI_CMD_CONFIG_WRITE;
+    for (int phase = 0; phase < transaction.data_phase_count && phase < PCI_MAX_DATA_PHASES; phase++)
+    {
+        int reg = transaction.config_reg + phase * 4;
+        config_shadow_record(bdf, reg, transaction.data[phase],
+                             transaction.byte_enables[phase], write, transaction.sequence_start);
+        
+        if (reg >= PCI_CFG_BAR0 && reg < PCI_CFG_BAR0 + PCI_CFG_BARS * 4)
+        {
+            bar_track(bdf, (reg - PCI_CFG_BAR0) / 4, transaction.data[phase],
+                      transaction.byte_enables[phase], write, transaction.sequence_start);
+        }
+    }
+}
+
+// Attribute a memory or I/O transaction to the function and BAR decoding it
+static void attribute_transaction(TPCIData& transaction)
+{
+    bool is_io = is_io_transaction(transaction.command);
+    if (!is_io && !is_memory_transaction(transaction.command))
+    {
+        return;
+    }
+    
+    const TPCIBarWindow *window = bar_window_find(is_io ? transaction.address : (transaction.address & ~(uint64_t)0x3), is_io);
+    if (window == NULL)
+    {
+        return;
+    }
+    
+    // A function with the space turned off in its Command register does not
+    // decode it; if the register was never seen it is taken to be on
+    uint32_t command;
+    uint8_t known;
+    if (config_shadow_lookup(window->bdf, PCI_CFG_COMMAND, transaction.sequence_start, &command, &known) &&
+        (known & 0x1) != 0 && (command & (is_io ? PCI_CFG_CMD_IO : PCI_CFG_CMD_MEMORY)) == 0)
+    {
+        return;
+    }
+    
+    transaction.has_target = true;
+    transaction.target_bdf = window->bdf;
+    transaction.target_bar = window->bar;
+    
+    TPCIConfigShadow *shadow = config_shadow_find(window->bdf, false);
+    if (shadow != NULL)
+    {
+        shadow->transactions++;
+        shadow->data_phases += transaction.data_phase_count;
+    }
+}
+
+// Format a transaction into a readable string. The fields are separated by
+// one space each, empty ones included.
 static void format_transaction(char* buffer, size_t buffer_size, const TPCIData& transaction)
 {
-    const char* cmd_str = get_command_string(transaction.command);
-    char addr_str[32];
-    char data_str[64] = {0};
-    char detail_str[128] = {0};
+    TTextOut text(buffer, buffer_size);
+    text.put(get_command_string(transaction.command)).put(' ');
     
     // Format the address
+    text.put("0x");
     if (transaction.is_64bit) {
-        snprintf(addr_str, sizeof(addr_str), "0x%016llX", transaction.address);
-    } else {
-        snprintf(addr_str, sizeof(addr_str), "0x%08X", (uint32_t)transaction.address);
+        text.hex((uint32_t)(transaction.address >> 32), 8);
+    }
+    text.hex((uint32_t)transaction.address, 8).put(' ');
+    
+    // Owning function of a memory/I/O transaction
+    if (transaction.has_target) {
+        text.put("->").hex(transaction.target_bdf >> 8, 2).put(':');
+        text.hex((transaction.target_bdf >> 3) & 0x1F, 2).put('.').hex(transaction.target_bdf & 0x7, 1);
+        text.put(" BAR").dec(transaction.target_bar);
     }
+    text.put(' ');
     
     // Format data (first data phase only in summary)
     if (transaction.data_phase_count > 0) {
-        snprintf(data_str, sizeof(data_str), "Data:0x%08X", transaction.data[0]);
+        text.put("Data:0x");
+        if (transaction.is_64bit_data) {
+            text.hex(transaction.data_hi[0], 8);
+        }
+        text.hex(transaction.data[0], 8);
+    }
+    text.put(' ');
+    
+    // Format byte enables if available
+    if (transaction.data_phase_count > 0) {
+        text.put("BE:0x").hex(transaction.byte_enables[0], 1);
     }
+    text.put(' ');
     
     // Add additional details based on transaction type
     if (is_config_transaction(transaction.command)) {
-        snprintf(detail_str, sizeof(detail_str), "Dev:%d Func:%d %s", 
-                 transaction.device_num, transaction.function_num,
-                 transaction.is_type1_config ? "Type1" : "Type0");
+        if (transaction.is_type1_config) {
+            text.put("Bus:").dec(transaction.bus_num).put(" Dev:").dec(transaction.device_num);
+        } else if (transaction.device_num != PCI_CFG_NO_IDSEL) {
+            text.put("IDSEL:AD").dec(transaction.device_num + 11);
+        } else {
+            text.put("IDSEL:-");
+        }
+        text.put(" Func:").dec(transaction.function_num);
+        text.put(" Reg:0x").hex(transaction.config_reg, 2);
+        text.put(transaction.is_type1_config ? " Type1" : " Type0");
     } else if (transaction.completion_type != PCI_COMP_NORMAL) {
-        snprintf(detail_str, sizeof(detail_str), "Completion:%s", 
-                 pci_comp_names[transaction.completion_type]);
+        text.put("Completion:").put(pci_comp_names[transaction.completion_type]);
     } else if (transaction.data_phase_count > 1) {
-        snprintf(detail_str, sizeof(detail_str), "Burst:%s Phases:%d", 
-                 pci_burst_names[transaction.burst_type], transaction.data_phase_count);
+        text.put("Burst:").put(pci_burst_names[transaction.burst_type]);
+        text.put(" Phases:").dec(transaction.data_phase_count);
     }
+    text.put(' ');
     
-    // Format byte enables if available
-    char be_str[16] = {0};
-    if (transaction.data_phase_count > 0) {
-        snprintf(be_str, sizeof(be_str), "BE:0x%X", transaction.byte_enables[0]);
+    // Computed parity mismatches are reported separately from PERR#
+    if (transaction.par_mismatch || transaction.par64_mismatch) {
+        text.put(transaction.par_mismatch ? "PAR!:" : "PAR64!:");
+        if (transaction.par_mismatch_phase < 0) {
+            text.put("Addr");
+        } else {
+            text.put('D').dec(transaction.par_mismatch_phase);
+        }
+        if (transaction.parity_error) {
+            text.put(" PERR#");
+        }
+    } else if (transaction.parity_error) {
+        text.put("PERR#");
+    }
+}
+
+// Append a result row and index it by sequence number
+// Add a result row; false if the late pass has added it already
+static bool add_row(int seq, int transaction, int status, int flags)
+{
+    if (early_overrun && seq >= resync_seq)
+    {
+        return false;
     }
     
-    // Combine all components
-    snprintf(buffer, buffer_size, "%s %s %s %s %s", 
-             cmd_str, addr_str, data_str, be_str, detail_str);
+    TSeqData SeqData;
+    SeqData.seq_number = seq;
+    SeqData.transaction = transaction;
+    SeqData.status = (uint8_t)status;
+    SeqData.flags = (uint8_t)flags;
+    
+    if (!early_running)
+    {
+        SeqDataIndex.add(seq, SeqDataVector.size());
+    }
+    SeqDataVector.push_back(SeqData);
+    return true;
+}
+
+// Fill a host row from a result row. Transaction rows are formatted from
+// the stored transaction, status rows point at their shared text.
+static void render_row(struct sequence *seqinfo, const TSeqData& SeqData)
+{
+    memset(seqinfo, 0, sizeof(*seqinfo));
+    if (SeqData.transaction != 0)
+    {
+        format_transaction(seqinfo->text, sizeof(seqinfo->text), PCITransactions[SeqData.transaction - 1]);
+    }
+    else
+    {
+        TTextOut text(seqinfo->text, sizeof(seqinfo->text));
+        text.put(pci_status_names[SeqData.status]);
+        if (SeqData.status == PCI_STATUS_GLITCHES)
+        {
+            text.put(": ").udec(glitch_filter.removed).put(" pulses shorter than ");
+            text.dec(glitch_filter.width()).put(" samples removed");
+        }
+    }
+    seqinfo->flags = SeqData.flags;
+    seqinfo->textp = seqinfo->text;
+    seqinfo->text2 = seqinfo->text2_buf;
 }
 
 /*********************************************************
@@ -282,106 +1001,123 @@ static void LogDebug(struct pctx *pctx, int level, const char *fmt, ...)
 #endif
 
 /*********************************************************
-        DLL functions
+        PCI decoder
 *********************************************************/
-struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *func)
+// Count a completed data phase of the current transaction, keeping its data
+// if it is one of the first PCI_MAX_DATA_PHASES
+static void add_data_phase(uint32_t ad, uint8_t byte_enables, uint32_t ad_hi, bool is_64bit)
 {
-    // Called upon DLL startup and refreshing the data
-    struct pctx *ret;
-    SeqDataVector.clear();
-    PCITransactions.clear();
-    processing_done = 0;
-    
-    // Check if already initialized
-    if (pctx != NULL)
+    int phase = PCIData.data_phase_count++;
+    if (phase < PCI_MAX_DATA_PHASES)
     {
-        return pctx;    // already initialized -> exit
+        PCIData.byte_enables[phase] = byte_enables;
+        PCIData.data[phase] = ad;
     }
-    
-    if (!(ret = (struct pctx*) func->rda_calloc(1, sizeof(struct pctx))))
+    if (is_64bit)
     {
-        func->LAError(0, 9, "Out of Memory");
-        return NULL;
+        // 64-bit data phase, upper half on AD[63:32]
+        if (phase < PCI_MAX_DATA_PHASES)
+        {
+            PCIData.data_hi[phase] = ad_hi;
+        }
+        PCIData.is_64bit_data = true;
     }
-    
-    ret->lactx = lactx;
-    ret->func.LAGroupValue = func->LAGroupValue;
-    ret->func.rda_calloc = func->rda_calloc;
-    ret->func.rda_free = func->rda_free;
-    ret->func.LAInfo = func->LAInfo;
-    
-    // defaults
-    set_bus_width = 0;           // 32-bit
-    set_bus_speed = 0;           // 33 MHz
-    set_arb_mode = 0;            // Simple
-    set_cache_line_size = 0;     // Disabled
-    set_latency = 1;             // Standard
-    set_retry_policy = 0;        // Immediate
-    
-    // Initialize state machine
-    in_transaction = false;
-    current_state = PCI_IDLE;
-    previous_signals = 0;
-    
-    // Reset current transaction data
-    memset(&PCIData, 0, sizeof(PCIData));
-    
-    LogDebug(ret, 0, "PCI Protocol Analyzer Initialization finished");
-    return ret;
 }
 
-int ParseExtInfo_(struct pctx *pctx)
+// One decode pass over the capture. BUS64 selects the bus width at compile
+// time so the 32-bit instance carries no AD[63:32], REQ64#/ACK64# or PAR64
+// handling; ParseSeq picks the instance once per pass from BUS_WIDTH.
+template <int BUS64>
+struct TPCIDecoder
 {
-    LogDebug(pctx, 0, "%s", "ParseExtInfo_");
-    return 0;
-}
+    static void decode(struct pctx *pctx, int firstseq, int lastseq);
 
-int ParseFinish(struct pctx *pctx)
-{
-    LogDebug(pctx, 0, "%s", "ParseFinish");
-    SeqDataVector.clear();
-    PCITransactions.clear();
-    pctx->func.rda_free(pctx);
-    return 0;
-}
+    // Fetch stage: read and filter the next block of a pass and find its edges
+    static bool fetch(void *arg, TPCISampleBlock& block);
+};
 
-struct sequence *ParseSeq(struct pctx *pctx, int initseq)
+template <int BUS64>
+bool TPCIDecoder<BUS64>::fetch(void *arg, TPCISampleBlock& block)
 {
-    TVSeqData::iterator it;
-    struct sequence *seqinfo = NULL;
-    
-    if (pctx == NULL)
+    TPCIFetchState& state = *(TPCIFetchState *)arg;
+    struct pctx *pctx = state.pctx;
+    int block_first = state.next_seq;
+    if (block_first > state.lastseq)
     {
-        LogDebug(pctx, 0, "pctx NULL");
-        return NULL;
+        return false;
     }
-    
-    if (processing_done == 0)
+    int block_count = state.lastseq - block_first + 1;
+    if (block_count > PCI_EDGE_BLOCK)
+        block_count = PCI_EDGE_BLOCK;
+
+    // The glitch filter looks a few samples past the block
+    int ahead = glitch_filter.lookahead();
+    if (ahead > decode_last - (block_first + block_count - 1))
+        ahead = decode_last - (block_first + block_count - 1);
+
+    int index;
+    for (index = 0; index < block_count + ahead; index++)
     {
-        processing_done = 1;
-        
-        // Get sequence range
-        int firstseq = pctx->func.LAInfo(pctx->lactx, TLA_INFO_FIRST_SEQUENCE, -1);
-        int lastseq = pctx->func.LAInfo(pctx->lactx, TLA_INFO_LAST_SEQUENCE, -1);
-        LogDebug(pctx, 0, "initseq: %d, firstseq: %d, last seq: %d", initseq, firstseq, lastseq);
-        
-        // Initialize state
-        current_state = PCI_IDLE;
-        in_transaction = false;
-        memset(&PCIData, 0, sizeof(PCIData));
-        
-        // Clear previous data
-        PCITransactions.clear();
-        SeqDataVector.clear();
-        
-        // Now loop through all the samples to find PCI transactions
-        for (int seq = firstseq; seq <= lastseq; seq++)
+        block.samples[index] = pctx->func.LAGroupValue(pctx->lactx, block_first + index, 0);
+    }
+
+    block.first = block_first;
+    block.count = block_count;
+    block.previous = state.previous;
+    if (glitch_filter.enabled())
+    {
+        block.previous = glitch_filter.previous(block_first, state.previous);
+        glitch_filter.filter(block.samples, block_count, ahead, block_first, state.previous);
+    }
+    block.edge_count = extract_clock_edges(block.samples, block_count, block.previous, block.edges);
+
+    // The state machine samples the AD bus on each of them
+    for (int edge = 0; edge < block.edge_count; edge++)
+    {
+        index = block.edges[edge];
+        if (reset_active(block.samples[index]))
+        {
+            continue;
+        }
+        block.ad[edge] = pctx->func.LAGroupValue(pctx->lactx, block_first + index, PCI_GROUP_AD);
+        if (BUS64)
         {
-            uint32_t signals = pctx->func.LAGroupValue(pctx->lactx, seq, 0);
+            block.ad_hi[edge] = pctx->func.LAGroupValue(pctx->lactx, block_first + index, PCI_GROUP_AD64);
+            block.signals64[edge] = pctx->func.LAGroupValue(pctx->lactx, block_first + index, PCI_GROUP_SIG64);
+        }
+    }
+
+    state.next_seq = block_first + block_count;
+    state.previous = block.samples[block_count - 1];
+    return true;
+}
+
+template <int BUS64>
+void TPCIDecoder<BUS64>::decode(struct pctx *pctx, int firstseq, int lastseq)
+{
+    // With asynchronous sampling there are many samples per PCI clock, so
+    // the fetch stage scans each block for clock edges first and the state
+    // machine only runs on those.
+    TPCIFetchState fetch_state;
+    fetch_state.pctx = pctx;
+    fetch_state.next_seq = firstseq;
+    fetch_state.lastseq = lastseq;
+    fetch_state.previous = previous_signals;
+    sample_pipeline.start(fetch, &fetch_state);
+
+    for (const TPCISampleBlock *block = sample_pipeline.next(); block != NULL;
+         sample_pipeline.release(), block = sample_pipeline.next())
+    {
+        for (int edge = 0; edge < block->edge_count; edge++)
+        {
+            int index = block->edges[edge];
+            int seq = block->first + index;
+            uint32_t signals = block->samples[index];
+            previous_signals = (index > 0) ? block->samples[index - 1] : block->previous;
             bool clock_edge = signal_rose(signals, previous_signals, PCI_CLK);
-            
+
             LogDebug(pctx, 9, "Seq %d: Signals=0x%08X State=%d", seq, signals, current_state);
-            
+
             // Only process on rising edge of clock or when reset is active
             if (clock_edge || reset_active(signals))
             {
@@ -392,13 +1128,7 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                     if (in_transaction)
                     {
                         // Create an entry for the aborted transaction
-                        TSeqData SeqData;
-                        memset(&SeqData, 0, sizeof(SeqData));
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), 
-                                "PCI Reset during transaction");
-                        SeqData.seq_data.flags = 4; // Red background for error
-                        SeqData.seq_number = seq;
-                        SeqDataVector.push_back(SeqData);
+                        add_row(seq, 0, PCI_STATUS_RESET_ABORT, 4); // Red background for error
                         
                         // Reset state machine
                         in_transaction = false;
@@ -408,17 +1138,32 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                     else
                     {
                         // Create a reset indicator
-                        TSeqData SeqData;
-                        memset(&SeqData, 0, sizeof(SeqData));
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), 
-                                "PCI Reset");
-                        SeqData.seq_data.flags = 2; // Grey background for status
-                        SeqData.seq_number = seq;
-                        SeqDataVector.push_back(SeqData);
+                        add_row(seq, 0, PCI_STATUS_RESET, 2); // Grey background for status
                     }
                     
-                    previous_signals = signals;
-                    continue; // Skip to next sample
+                    par_pending = false;
+                    continue; // Skip to next edge
+                }
+                
+                // Sample the full AD bus, plus the 64-bit extension on a 64-bit bus.
+                // In the 32-bit instance the extension stays deasserted, so REQ64#,
+                // ACK64# and PAR64 fold away at compile time.
+                uint32_t ad = block->ad[edge];
+                uint32_t ad_hi = 0;
+                uint32_t signals64 = 0xFFFFFFFF; // 64-bit extension deasserted
+                if (BUS64)
+                {
+                    ad_hi = block->ad_hi[edge];
+                    signals64 = block->signals64[edge];
+                }
+                uint8_t cbe_hi = (uint8_t)(signals64 & PCI64_C_BE_HI);
+                bool req64 = (signals64 & PCI64_REQ64) == 0; // REQ64# is active low
+                bool ack64 = (signals64 & PCI64_ACK64) == 0; // ACK64# is active low
+                
+                // PAR/PAR64 on this clock cover the address or data phase of the previous clock
+                if (par_pending)
+                {
+                    verify_parity(signals, signals64, PCIData);
                 }
                 
                 // Process based on current state
@@ -436,7 +1181,8 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                             memset(&PCIData, 0, sizeof(PCIData));
                             PCIData.sequence_start = seq;
                             PCIData.command = extract_command(signals);
-                            PCIData.address = extract_ad(signals) << 2; // Lower 2 bits always 0
+                            PCIData.address = ad;
+                            latch_parity(ad, PCIData.command, ad_hi, cbe_hi, req64, -1);
                             
                             // Check for dual address cycle (64-bit address)
                             if (PCIData.command == PCI_CMD_DUAL_ADDR_CYCLE)
@@ -455,21 +1201,8 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                             {
                                 current_state = PCI_CONFIG_CYCLE;
                                 
-                                // Decode device/function for configuration cycles
-                                if (signals & PCI_IDSEL)
-                                {
-                                    // Type 0 configuration
-                                    PCIData.is_type1_config = false;
-                                    PCIData.device_num = (extract_ad(signals) >> 11) & 0x1F; // AD[15:11]
-                                    PCIData.function_num = (extract_ad(signals) >> 8) & 0x7; // AD[10:8]
-                                }
-                                else
-                                {
-                                    // Type 1 configuration
-                                    PCIData.is_type1_config = true;
-                                    PCIData.device_num = (extract_ad(signals) >> 11) & 0x1F; // AD[15:11]
-                                    PCIData.function_num = (extract_ad(signals) >> 8) & 0x7; // AD[10:8]
-                                }
+                                // Decode bus/device/function/register for configuration cycles
+                                decode_config_address(PCIData, ad);
                             }
                             
                             // Check for arbitration
@@ -486,32 +1219,26 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                         else if (((signals & PCI_REQ) != (previous_signals & PCI_REQ)) ||
                                 ((signals & PCI_GNT) != (previous_signals & PCI_GNT)))
                         {
-                            TSeqData SeqData;
-                            memset(&SeqData, 0, sizeof(SeqData));
+                            int status = PCI_STATUS_NONE;
                             
                             if ((signals & PCI_REQ) == 0 && (signals & PCI_GNT) != 0)
                             {
                                 // REQ# asserted, GNT# not asserted
-                                snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), 
-                                        "Request for bus");
+                                status = PCI_STATUS_BUS_REQUEST;
                             }
                             else if ((signals & PCI_REQ) != 0 && (signals & PCI_GNT) == 0)
                             {
                                 // REQ# not asserted, GNT# asserted
-                                snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), 
-                                        "Bus grant without request");
+                                status = PCI_STATUS_GRANT_NO_REQUEST;
                             }
                             else if ((signals & PCI_REQ) == 0 && (signals & PCI_GNT) == 0)
                             {
                                 // Both REQ# and GNT# asserted
-                                snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), 
-                                        "Bus granted to requestor");
+                                status = PCI_STATUS_BUS_GRANTED;
                                 current_state = PCI_BUS_PARKING;
                             }
                             
-                            SeqData.seq_data.flags = 2; // Grey background for status
-                            SeqData.seq_number = seq;
-                            SeqDataVector.push_back(SeqData);
+                            add_row(seq, 0, status, 2); // Grey background for status
                         }
                         break;
                         
@@ -526,7 +1253,12 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                             memset(&PCIData, 0, sizeof(PCIData));
                             PCIData.sequence_start = seq;
                             PCIData.command = extract_command(signals);
-                            PCIData.address = extract_ad(signals) << 2; // Lower 2 bits always 0
+                            PCIData.address = ad;
+                            latch_parity(ad, PCIData.command, ad_hi, cbe_hi, req64, -1);
+                            if (is_config_transaction(PCIData.command))
+                            {
+                                decode_config_address(PCIData, ad);
+                            }
                             
                             LogDebug(pctx, 1, "Starting transaction from bus parking: CMD=%s, Addr=0x%08X", 
                                     get_command_string(PCIData.command), (uint32_t)PCIData.address);
@@ -536,13 +1268,7 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                             // REQ# or GNT# deasserted, return to idle
                             current_state = PCI_IDLE;
                             
-                            TSeqData SeqData;
-                            memset(&SeqData, 0, sizeof(SeqData));
-                            snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), 
-                                    "End of bus parking");
-                            SeqData.seq_data.flags = 2; // Grey background for status
-                            SeqData.seq_number = seq;
-                            SeqDataVector.push_back(SeqData);
+                            add_row(seq, 0, PCI_STATUS_PARKING_END, 2); // Grey background for status
                         }
                         break;
                         
@@ -560,13 +1286,12 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                                 if ((signals & PCI_TRDY) == 0) // TRDY# is active low
                                 {
                                     // Target ready, data phase can complete
-                                    PCIData.byte_enables[PCIData.data_phase_count] = extract_byte_enables(signals);
-                                    PCIData.data[PCIData.data_phase_count] = extract_ad(signals);
-                                    PCIData.data_phase_count++;
+                                    uint8_t byte_enables = extract_byte_enables(signals);
+                                    add_data_phase(ad, byte_enables, ad_hi, BUS64 && req64 && ack64);
+                                    latch_parity(ad, byte_enables, ad_hi, cbe_hi, req64 && ack64, PCIData.data_phase_count);
                                     
                                     LogDebug(pctx, 2, "Data phase %d: Data=0x%08X, BE=0x%X", 
-                                            PCIData.data_phase_count, PCIData.data[PCIData.data_phase_count-1],
-                                            PCIData.byte_enables[PCIData.data_phase_count-1]);
+                                            PCIData.data_phase_count, ad, byte_enables);
                                 }
                             }
                             else if (is_master_abort(signals))
@@ -594,7 +1319,10 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                     case PCI_DUAL_ADDRESS_PHASE:
                         // Second address phase for 64-bit addressing
                         PCIData.is_64bit = true;
-                        PCIData.address |= ((uint64_t)extract_ad(signals) << 34); // Upper 32 bits of address
+                        // AD[31:0] now carries the upper 32 address bits and C/BE# the real command
+                        PCIData.address |= ((uint64_t)ad << 32);
+                        PCIData.command = extract_command(signals);
+                        latch_parity(ad, PCIData.command, ad_hi, cbe_hi, req64, -1);
                         current_state = PCI_ADDRESS_PHASE;
                         
                         LogDebug(pctx, 1, "Dual address phase: 64-bit address=0x%016llX", PCIData.address);
@@ -605,13 +1333,12 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                         if ((signals & PCI_TRDY) == 0 && (signals & PCI_IRDY) == 0)
                         {
                             // Both TRDY# and IRDY# asserted, data transfer
-                            PCIData.byte_enables[PCIData.data_phase_count] = extract_byte_enables(signals);
-                            PCIData.data[PCIData.data_phase_count] = extract_ad(signals);
-                            PCIData.data_phase_count++;
+                            uint8_t byte_enables = extract_byte_enables(signals);
+                            add_data_phase(ad, byte_enables, ad_hi, BUS64 && req64 && ack64);
+                            latch_parity(ad, byte_enables, ad_hi, cbe_hi, req64 && ack64, PCIData.data_phase_count);
                             
                             LogDebug(pctx, 2, "Data phase %d: Data=0x%08X, BE=0x%X", 
-                                    PCIData.data_phase_count, PCIData.data[PCIData.data_phase_count-1],
-                                    PCIData.byte_enables[PCIData.data_phase_count-1]);
+                                    PCIData.data_phase_count, ad, byte_enables);
                         }
                         
                         // Check for target abort
@@ -641,7 +1368,7 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                             // STOP# and TRDY# both asserted - disconnect with data
                             PCIData.completion_type = PCI_COMP_DISCONNECT;
                             
-                            if (PCIData.data_phase_count >= 16)
+                            if (PCIData.data_phase_count >= PCI_MAX_DATA_PHASES)
                             {
                                 // Maximum data phases reached
                                 current_state = PCI_COMPLETION_PHASE;
@@ -730,35 +1457,37 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                             // Both IRDY# and FRAME# deasserted, bus is idle
                             PCIData.sequence_end = seq;
                             
-                            // Now create a sequence entry for this transaction
-                            TSeqData SeqData;
-                            memset(&SeqData, 0, sizeof(SeqData));
+                            // Attribute memory/I/O transactions to the BAR that decodes them
+                            attribute_transaction(PCIData);
                             
-                            // Format transaction details into text
-                            format_transaction(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), PCIData);
+                            // Now create a sequence entry for this transaction; its
+                            // text is formatted from PCITransactions when shown
+                            int flags;
                             
                             // Set flags based on transaction status
                             if (PCIData.parity_error || PCIData.system_error || 
+                                PCIData.par_mismatch || PCIData.par64_mismatch ||
                                 PCIData.master_abort || PCIData.target_abort ||
                                 PCIData.completion_type == PCI_COMP_RETRY || 
                                 PCIData.completion_type == PCI_COMP_TARGET_ABORT)
                             {
-                                SeqData.seq_data.flags = 4; // Red background for errors
+                                flags = 4; // Red background for errors
                             }
                             else if (PCIData.completion_type == PCI_COMP_DISCONNECT)
                             {
-                                SeqData.seq_data.flags = 8; // Yellow background for warnings
+                                flags = 8; // Yellow background for warnings
                             }
                             else
                             {
-                                SeqData.seq_data.flags = 1; // Normal display
+                                flags = 1; // Normal display
                             }
                             
-                            SeqData.seq_number = PCIData.sequence_start;
-                            SeqDataVector.push_back(SeqData);
-                            
-                            // Save the transaction for future reference
-                            PCITransactions.push_back(PCIData);
+                            if (add_row(PCIData.sequence_start, PCITransactions.size() + 1, PCI_STATUS_NONE, flags))
+                            {
+                                // Save the transaction for future reference
+                                PCITransactions.push_back(PCIData);
+                                config_shadow_update(PCIData);
+                            }
                             
                             // Reset for next transaction
                             in_transaction = false;
@@ -775,82 +1504,622 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
                     (previous_signals & (PCI_INTA | PCI_INTB | PCI_INTC | PCI_INTD)))
                 {
                     // Interrupt state changed
-                    TSeqData SeqData;
-                    memset(&SeqData, 0, sizeof(SeqData));
+                    int status = PCI_STATUS_NONE;
                     
                     if ((signals & PCI_INTA) == 0 && (previous_signals & PCI_INTA) != 0)
                     {
                         // INTA# asserted
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), "INTA# Asserted");
+                        status = PCI_STATUS_INT_ASSERTED + 0;
                     }
                     else if ((signals & PCI_INTB) == 0 && (previous_signals & PCI_INTB) != 0)
                     {
                         // INTB# asserted
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), "INTB# Asserted");
+                        status = PCI_STATUS_INT_ASSERTED + 1;
                     }
                     else if ((signals & PCI_INTC) == 0 && (previous_signals & PCI_INTC) != 0)
                     {
                         // INTC# asserted
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), "INTC# Asserted");
+                        status = PCI_STATUS_INT_ASSERTED + 2;
                     }
                     else if ((signals & PCI_INTD) == 0 && (previous_signals & PCI_INTD) != 0)
                     {
                         // INTD# asserted
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), "INTD# Asserted");
+                        status = PCI_STATUS_INT_ASSERTED + 3;
                     }
                     else if ((signals & PCI_INTA) != 0 && (previous_signals & PCI_INTA) == 0)
                     {
                         // INTA# deasserted
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), "INTA# Deasserted");
+                        status = PCI_STATUS_INT_DEASSERTED + 0;
                     }
                     else if ((signals & PCI_INTB) != 0 && (previous_signals & PCI_INTB) == 0)
                     {
                         // INTB# deasserted
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), "INTB# Deasserted");
+                        status = PCI_STATUS_INT_DEASSERTED + 1;
                     }
                     else if ((signals & PCI_INTC) != 0 && (previous_signals & PCI_INTC) == 0)
                     {
                         // INTC# deasserted
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), "INTC# Deasserted");
+                        status = PCI_STATUS_INT_DEASSERTED + 2;
                     }
                     else if ((signals & PCI_INTD) != 0 && (previous_signals & PCI_INTD) == 0)
                     {
                         // INTD# deasserted
-                        snprintf(SeqData.seq_data.text, sizeof(SeqData.seq_data.text), "INTD# Deasserted");
+                        status = PCI_STATUS_INT_DEASSERTED + 3;
                     }
                     
-                    SeqData.seq_data.flags = 2; // Grey background for status events
-                    SeqData.seq_number = seq;
-                    SeqDataVector.push_back(SeqData);
+                    add_row(seq, 0, status, 2); // Grey background for status events
                     
                     LogDebug(pctx, 1, "Interrupt state change detected");
                 }
             }
-            
-            // Save signals for edge detection
-            previous_signals = signals;
         }
+
+        // Carry the last sample into the next block's edge scan
+        previous_signals = block->samples[block->count - 1];
+    }
+    sample_pipeline.finish();
+}
+
+// Return the state machine to idle ahead of a decode pass
+static void reset_decoder()
+{
+    current_state = PCI_IDLE;
+    in_transaction = false;
+    memset(&PCIData, 0, sizeof(PCIData));
+    previous_signals = 0;
+    par_pending = false;
+    par64_pending = false;
+}
+
+// Decode a range with the instance built for the configured bus width
+static void decode_range(struct pctx *pctx, int firstseq, int lastseq)
+{
+    if (set_bus_width == 1)
+    {
+        TPCIDecoder<1>::decode(pctx, firstseq, lastseq);
+    }
+    else
+    {
+        TPCIDecoder<0>::decode(pctx, firstseq, lastseq);
+    }
+}
+
+// Settings the decoder state depends on; checkpoints taken with any of them
+// set differently are dropped
+static uint32_t checkpoint_key()
+{
+    return (uint32_t)set_bus_width | ((uint32_t)set_glitch_filter << 16);
+}
+
+// Snapshot of the decoder state before the next sample
+static void save_checkpoint(TPCICheckpoint& checkpoint)
+{
+    checkpoint.transaction = PCIData;
+    checkpoint.state = current_state;
+    checkpoint.in_transaction = in_transaction;
+    checkpoint.command = current_command;
+    checkpoint.previous_signals = previous_signals;
+    checkpoint.par_pending = par_pending;
+    checkpoint.par64_pending = par64_pending;
+    checkpoint.par_expected = par_expected;
+    checkpoint.par64_expected = par64_expected;
+    checkpoint.par_phase = par_phase;
+    glitch_filter.save(checkpoint.glitch_out, checkpoint.glitch_dev);
+}
+
+// Put the decoder back into the state saved before sample seq
+static void resume_checkpoint(const TPCICheckpoint& checkpoint, int seq)
+{
+    PCIData = checkpoint.transaction;
+    current_state = checkpoint.state;
+    in_transaction = checkpoint.in_transaction;
+    current_command = checkpoint.command;
+    previous_signals = checkpoint.previous_signals;
+    par_pending = checkpoint.par_pending;
+    par64_pending = checkpoint.par64_pending;
+    par_expected = checkpoint.par_expected;
+    par64_expected = checkpoint.par64_expected;
+    par_phase = checkpoint.par_phase;
+    if (glitch_filter.enabled())
+    {
+        glitch_filter.resume(seq, checkpoint.glitch_out, checkpoint.glitch_dev);
+    }
+}
+
+// Bus idle and out of reset: FRAME# and IRDY# both deasserted
+static bool bus_idle(uint32_t signals)
+{
+    return (signals & (PCI_FRAME | PCI_IRDY)) == (PCI_FRAME | PCI_IRDY) && !reset_active(signals);
+}
+
+// Find where the trigger-first pass starts: the second of two idle clock
+// edges in a row at or before the trigger. The first idle edge completes any
+// transaction in flight, so the early pass ends with the bus idle and the
+// state machine can start from PCI_IDLE at the second. Falls back to firstseq
+// when the host has no trigger or no such point is near it.
+static int find_resync_point(struct pctx *pctx, int firstseq, int lastseq)
+{
+    if (pctx->func.LABusModTrigSample == NULL)
+    {
+        return firstseq;
+    }
+    
+    int trigger = pctx->func.LABusModTrigSample(pctx->lactx, -1);
+    if (trigger <= firstseq || trigger > lastseq)
+    {
+        return firstseq;
+    }
+    
+    int limit = trigger - PCI_RESYNC_WINDOW;
+    if (limit < firstseq)
+        limit = firstseq;
+    
+    int later_edge = -1;
+    uint32_t signals = pctx->func.LAGroupValue(pctx->lactx, trigger, 0);
+    for (int seq = trigger; seq > limit; seq--)
+    {
+        uint32_t previous = pctx->func.LAGroupValue(pctx->lactx, seq - 1, 0);
+        if (signal_rose(signals, previous, PCI_CLK))
+        {
+            if (!bus_idle(signals))
+            {
+                later_edge = -1;
+            }
+            else if (later_edge >= 0)
+            {
+                return later_edge;
+            }
+            else
+            {
+                later_edge = seq;
+            }
+        }
+        signals = previous;
+    }
+    return firstseq;
+}
+
+// Stop at the next chunk if the pass was cancelled or the host asked to abort
+static bool decode_stopped(struct pctx *pctx)
+{
+    if (decode_cancel)
+    {
+        return true;
+    }
+    if (pctx->func.LAProgAbort != NULL && pctx->func.LAProgAbort(pctx->lactx))
+    {
+        decode_aborted = true;
+        return true;
+    }
+    return false;
+}
+
+// A transaction has started and not completed yet
+static bool in_flight()
+{
+    return current_state != PCI_IDLE && current_state != PCI_BUS_PARKING && current_state != PCI_ARB_PHASE;
+}
+
+// Last sample of a decoded chunk whose rows are all in. A transaction still
+// in flight adds its row, at its first sample, only once it completes. One
+// resumed from a checkpoint may have started ahead of the resync point,
+// where the early pass covers it.
+static int publish_limit(int chunk_last)
+{
+    if (in_flight() && PCIData.sequence_start <= chunk_last)
+    {
+        return PCIData.sequence_start > resync_seq ? PCIData.sequence_start - 1 : resync_seq - 1;
+    }
+    return chunk_last;
+}
+
+// Decode a range a chunk at a time, holding the lock only while a chunk is
+// decoded. With publish set, each chunk becomes visible once it is done.
+static bool decode_chunks(struct pctx *pctx, int firstseq, int lastseq, bool publish)
+{
+    for (int seq = firstseq; seq <= lastseq; seq += PCI_DECODE_CHUNK)
+    {
+        if (decode_stopped(pctx))
+        {
+            return false;
+        }
+        
+        int chunk_last = lastseq - seq < PCI_DECODE_CHUNK ? lastseq : seq + PCI_DECODE_CHUNK - 1;
+        decode_lock.enter();
+        decode_range(pctx, seq, chunk_last);
+        if (chunk_last < decode_last)
+        {
+            TPCICheckpoint checkpoint;
+            save_checkpoint(checkpoint);
+            checkpoints.record(chunk_last + 1, checkpoint);
+        }
+        if (publish)
+            late_done = publish_limit(chunk_last);
+        decode_lock.leave();
+    }
+    return true;
+}
+
+// Carry the early pass on past the resync point until the transaction in
+// flight there completes. Its row stays with the early ones; rows and
+// transactions from the resync point on are the late pass's and are not
+// added twice, and neither are the glitches the filter removes there. One
+// cut off by the end of the capture gets no row, as in the late pass.
+static bool finish_early_transaction(struct pctx *pctx)
+{
+    unsigned long removed = glitch_filter.removed;
+    early_overrun = true;
+    for (int seq = resync_seq; seq <= decode_last && in_flight(); seq += PCI_EDGE_BLOCK)
+    {
+        if (decode_stopped(pctx))
+        {
+            early_overrun = false;
+            return false;
+        }
+        
+        int last = decode_last - seq < PCI_EDGE_BLOCK ? decode_last : seq + PCI_EDGE_BLOCK - 1;
+        decode_lock.enter();
+        decode_range(pctx, seq, last);
+        decode_lock.leave();
+    }
+    glitch_filter.removed = removed;
+    early_overrun = false;
+    return true;
+}
+
+// Decode the samples ahead of the resync point and put their rows first.
+// Memory/I/O attribution depends on the configuration cycles before each
+// transaction, so the shadow is rebuilt over the merged transaction list and
+// the transaction rows are pointed at the moved transactions.
+static bool decode_early(struct pctx *pctx)
+{
+    size_t late_rows = SeqDataVector.size();
+    size_t late_count = PCITransactions.size();
+    reset_decoder();
+    early_running = true;
+    bool done = decode_chunks(pctx, early_first, resync_seq - 1, false) && finish_early_transaction(pctx);
+    early_running = false;
+    if (!done)
+    {
+        return false;
+    }
+    
+    decode_lock.enter();
+    size_t early_count = PCITransactions.size() - late_count;
+    
+    SeqDataVector.rotate(late_rows);
+    PCITransactions.rotate(late_count);
+    
+    config_shadow_clear();
+    for (size_t trans = 0; trans < PCITransactions.size(); trans++)
+    {
+        TPCIData& transaction = PCITransactions[trans];
+        transaction.has_target = false;
+        attribute_transaction(transaction);
+        config_shadow_update(transaction);
+    }
+    
+    SeqDataIndex.clear();
+    for (size_t row = 0; row < SeqDataVector.size(); row++)
+    {
+        TSeqData& SeqData = SeqDataVector[row];
+        if (SeqData.transaction != 0)
+        {
+            size_t index = SeqData.transaction - 1;
+            index = (index < late_count) ? index + early_count : index - late_count;
+            SeqData.transaction = index + 1;
+        }
+        SeqDataIndex.add(SeqData.seq_number, row);
+    }
+    early_pending = false;
+    decode_lock.leave();
+    
+    LogDebug(pctx, 0, "Early pass: %d PCI transactions before seq %d", early_count, resync_seq);
+    return true;
+}
+
+// Report what the glitch filter removed as a grey row on the last sample,
+// once the whole capture has been through it
+static void add_glitch_summary()
+{
+    if (glitch_filter.enabled())
+    {
+        add_row(decode_last, 0, PCI_STATUS_GLITCHES, 2); // Grey background for status
+    }
+}
+
+// Worker thread: the pass from the resync point on is published a chunk at
+// a time, the early pass in one go once it has been merged in front. A
+// re-decode of the same capture resumes from the checkpoint before the
+// first sample asked for, so the rows there are back first and exact.
+static unsigned THREAD_CALL decode_worker(void *arg)
+{
+    struct pctx *pctx = (struct pctx *)arg;
+    
+    int resync;
+    const TPCICheckpoint *checkpoint = checkpoints.nearest(resume_seq, resync);
+    if (checkpoint == NULL)
+    {
+        resync = find_resync_point(pctx, early_first, decode_last);
+    }
+    decode_lock.enter();
+    resync_seq = resync;
+    late_done = resync - 1;
+    early_pending = resync > early_first;
+    decode_lock.leave();
+    
+    if (checkpoint != NULL)
+    {
+        resume_checkpoint(*checkpoint, resync);
+        LogDebug(pctx, 0, "Resuming at checkpoint seq %d", resync);
+    }
+    else if (early_pending)
+    {
+        previous_signals = pctx->func.LAGroupValue(pctx->lactx, resync - 1, 0);
+    }
+    if (!decode_chunks(pctx, resync, decode_last, true))
+    {
+        return 0;
+    }
+    
+    // A transaction cut off by the end of the capture gets no row. The
+    // filter's count is complete only after the early pass.
+    decode_lock.enter();
+    if (!early_pending)
+    {
+        add_glitch_summary();
+    }
+    late_done = (early_pending && glitch_filter.enabled()) ? decode_last - 1 : decode_last;
+    decode_lock.leave();
+    
+    LogDebug(pctx, 0, "Found %d PCI transactions, %d parity mismatches", 
+            PCITransactions.size(), parity_mismatches);
+    
+    if (early_pending && decode_early(pctx))
+    {
+        decode_lock.enter();
+        add_glitch_summary();
+        late_done = decode_last;
+        decode_lock.leave();
+    }
+    return 0;
+}
+
+// Start a decode pass over the whole capture in the background
+static void start_decode(struct pctx *pctx)
+{
+    if (!decode_thread.start(decode_worker, pctx))
+    {
+        // No thread available, decode in the caller instead
+        decode_worker(pctx);
+    }
+}
+
+// Cancel a running pass and wait for the worker to exit
+static void stop_decode()
+{
+    if (decode_thread.active())
+    {
+        AtomicExchange(&decode_cancel, 1);
+        decode_thread.join();
+        AtomicExchange(&decode_cancel, 0);
+    }
+}
+
+// First sample of the undecoded range holding seq, or -1 once seq is decoded
+static int pending_range(int seq)
+{
+    if (seq >= resync_seq)
+    {
+        return seq > late_done ? late_done + 1 : -1;
+    }
+    return early_pending ? early_first : -1;
+}
+
+/*********************************************************
+        User marks
+*********************************************************/
+// Fingerprint of the capture, so marks survive a re-decode of the same
+// capture but not a new acquisition
+static uint32_t capture_signature(struct pctx *pctx, int firstseq, int lastseq)
+{
+    uint32_t hash = 2166136261UL;   // FNV-1a
+    int step = (lastseq - firstseq) / MARKSET_SIGNATURE_SAMPLES + 1;
+    for (int seq = firstseq; seq <= lastseq; seq += step)
+    {
+        uint32_t values[2];
+        values[0] = sample_mirror.fetch(pctx->lactx, seq, 0);
+        values[1] = sample_mirror.fetch(pctx->lactx, seq, PCI_GROUP_AD);
+        for (int byte = 0; byte < 8; byte++)
+        {
+            hash = (hash ^ ((values[byte / 4] >> ((byte % 4) * 8)) & 0xFF)) * 16777619UL;
+        }
+    }
+    return hash;
+}
+
+/*********************************************************
+        DLL functions
+*********************************************************/
+struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *func)
+{
+    // Called upon DLL startup and refreshing the data
+    struct pctx *ret;
+    stop_decode();
+    SeqDataVector.clear();
+    SeqDataIndex.clear();
+    PCITransactions.clear();
+    result_arena.release();
+    config_shadow_clear();
+    processing_done = 0;
+    
+    // Check if already initialized
+    if (pctx != NULL)
+    {
+        return pctx;    // already initialized -> exit
+    }
+    
+    if (!(ret = (struct pctx*) func->rda_calloc(1, sizeof(struct pctx))))
+    {
+        func->LAError(0, 9, "Out of Memory");
+        return NULL;
+    }
+    
+    ret->lactx = lactx;
+    ret->func.LAGroupValue = func->LAGroupValue;
+    ret->func.rda_calloc = func->rda_calloc;
+    ret->func.rda_free = func->rda_free;
+    ret->func.LAInfo = func->LAInfo;
+    ret->func.LABusModTrigSample = func->LABusModTrigSample;
+    ret->func.LAProgAbort = func->LAProgAbort;
+    result_arena.attach(func->rda_malloc, func->rda_free);
+    SeqDataVector.set_arena(&result_arena);
+    SeqDataIndex.set_arena(&result_arena);
+    PCITransactions.set_arena(&result_arena);
+    
+    // Read the probe wiring once; groups that match PCI.h are read directly
+    char tla_path[512];
+    if (SupportFilePath(tla_path, sizeof(tla_path), func->support_path, func->support_sep,
+                        func->support_name, func->support_ext) &&
+        channel_map.load(tla_path, func->LAGroupValue, pci_channel_groups, ARRAY_SIZE(pci_channel_groups),
+                         pci_channels, ARRAY_SIZE(pci_channels)) > 0)
+    {
+        ret->func.LAGroupValue = mapped_group_value;
+    }
+    sample_mirror.attach(ret->func.LAGroupValue);
+    ret->func.LAGroupValue = mirrored_group_value;
+    
+    // defaults
+    set_bus_width = 0;           // 32-bit
+    set_bus_speed = 0;           // 33 MHz
+    set_arb_mode = 0;            // Simple
+    set_cache_line_size = 0;     // Disabled
+    set_latency = 1;             // Standard
+    set_retry_policy = 0;        // Immediate
+    set_result_ram = 1;          // 16 MB
+    set_glitch_filter = 0;       // Off
+    
+    // Initialize state machine
+    in_transaction = false;
+    current_state = PCI_IDLE;
+    previous_signals = 0;
+    par_pending = false;
+    par64_pending = false;
+    
+    // Reset current transaction data
+    memset(&PCIData, 0, sizeof(PCIData));
+    
+    LogDebug(ret, 0, "PCI Protocol Analyzer Initialization finished");
+    return ret;
+}
+
+int ParseExtInfo_(struct pctx *pctx)
+{
+    LogDebug(pctx, 0, "%s", "ParseExtInfo_");
+    return 0;
+}
+
+int ParseFinish(struct pctx *pctx)
+{
+    LogDebug(pctx, 0, "%s", "ParseFinish");
+    stop_decode();
+    sample_pipeline.close();
+    SeqDataVector.clear();
+    SeqDataIndex.clear();
+    PCITransactions.clear();
+    result_arena.release();
+    config_shadow_clear();
+    user_marks.clear();
+    checkpoints.clear();
+    sample_mirror.clear();
+    pctx->func.rda_free(pctx);
+    return 0;
+}
+
+struct sequence *ParseSeq(struct pctx *pctx, int initseq)
+{
+    struct sequence *seqinfo = NULL;
+    
+    if (pctx == NULL)
+    {
+        LogDebug(pctx, 0, "pctx NULL");
+        return NULL;
+    }
+    
+    if (processing_done == 0)
+    {
+        stop_decode();
+        processing_done = 1;
+        
+        // Get sequence range
+        int firstseq = pctx->func.LAInfo(pctx->lactx, TLA_INFO_FIRST_SEQUENCE, -1);
+        int lastseq = pctx->func.LAInfo(pctx->lactx, TLA_INFO_LAST_SEQUENCE, -1);
+        LogDebug(pctx, 0, "initseq: %d, firstseq: %d, last seq: %d", initseq, firstseq, lastseq);
         
-        // Post-processing: finalize text pointers for all sequences
-        for (it = SeqDataVector.begin(); it != SeqDataVector.end(); ++it)
+        // Keep the user marks if this is the capture they were set on, the
+        // mirrored samples if they still match the host, and the checkpoints
+        // if the decoder state is also the same
+        uint32_t signature = capture_signature(pctx, firstseq, lastseq);
+        user_marks.bind(firstseq, lastseq, signature);
+        if (!sample_mirror.bind(pctx->lactx, firstseq, lastseq, signature))
         {
-            it->seq_data.textp = it->seq_data.text;
-            it->seq_data.text2 = it->seq_data.text2_buf;
+            checkpoints.clear();
         }
+        checkpoints.bind(firstseq, lastseq, signature, checkpoint_key());
         
-        LogDebug(pctx, 0, "Found %d PCI transactions", PCITransactions.size());
+        // Initialize state
+        reset_decoder();
+        parity_mismatches = 0;
+        
+        // Clear previous data
+        PCITransactions.clear();
+        SeqDataVector.clear();
+        SeqDataIndex.clear();
+        config_shadow_clear();
+        memset(RowSlots, 0, sizeof(RowSlots));
+        
+        // Transactions take half the RAM budget, the rows and their index a
+        // quarter each; past it pages spill to disk
+        SeqDataVector.set_budget(pci_result_ram_bytes[set_result_ram] / 4);
+        SeqDataIndex.set_budget(pci_result_ram_bytes[set_result_ram] / 4);
+        PCITransactions.set_budget(pci_result_ram_bytes[set_result_ram] / 2);
+        glitch_filter.configure(pci_glitch_filter_width[set_glitch_filter], PCI_GLITCH_LINES);
+        
+        // Nothing is published until the worker has found the resync point
+        early_first = firstseq;
+        resync_seq = firstseq;
+        resume_seq = initseq;
+        late_done = firstseq - 1;
+        early_pending = false;
+        decode_last = lastseq;
+        decode_aborted = false;
+        start_decode(pctx);
     }
     
-    // Return the requested sequence
-    for (it = SeqDataVector.begin(); it != SeqDataVector.end(); ++it)
+    decode_lock.enter();
+    if (pending_range(initseq) >= 0)
+    {
+        // Every sample not decoded yet reads as the placeholder, so the
+        // host asks again for each of them when it next draws the rows
+        memset(&PendingRow, 0, sizeof(PendingRow));
+        snprintf(PendingRow.text, sizeof(PendingRow.text), decode_aborted ? "Decode aborted" : "Decoding...");
+        PendingRow.textp = PendingRow.text;
+        PendingRow.text2 = PendingRow.text2_buf;
+        PendingRow.flags = 2; // Grey background for status
+        seqinfo = &PendingRow;
+    }
+    else
     {
-        if (it->seq_number == initseq)
+        // Format the requested sequence into one of the host row slots
+        int row = SeqDataIndex.find(initseq);
+        if (row >= 0)
         {
-            seqinfo = &(it->seq_data);
+            seqinfo = &RowSlots[initseq & (PCI_ROW_SLOTS - 1)];
+            render_row(seqinfo, SeqDataVector[row]);
             LogDebug(pctx, 9, "%s: seq: %d text: [%s]", "ParseSeq", initseq, seqinfo->textp);
-            break;
         }
     }
+    decode_lock.leave();
     
     return seqinfo;
 }
@@ -858,19 +2127,26 @@ struct sequence *ParseSeq(struct pctx *pctx, int initseq)
 int ParseMarkNext(struct pctx *pctx, int seq, int a3)
 {
     LogDebug(pctx, 9, "%s: sequence %d, a3 %d", "ParseMarkNext", seq, a3);
-    return 0;
+    
+    // Next user mark; if there is none this is the current one
+    int next = seq;
+    user_marks.next(seq, next);
+    return next;
 }
 
 int ParseMarkSet(struct pctx *pctx, int seq, int a3)
 {
-    LogDebug(pctx, 9, "%s", "ParseMarkSet");
+    LogDebug(pctx, 9, "%s: sequence %d, a3 %d", "ParseMarkSet", seq, a3);
+    
+    // A nonzero a3 marks the sequence, zero clears the mark
+    user_marks.set(seq, a3 != 0);
     return 0;
 }
 
 int ParseMarkGet(struct pctx *pctx, int seq)
 {
     LogDebug(pctx, 9, "%s: sequence %d", "ParseMarkGet", seq);
-    return seq;
+    return user_marks.test(seq) ? 1 : 0;
 }
 
 int ParseMarkMenu(struct pctx *pctx, int seq, int a3, int a4, int a5)
@@ -890,7 +2166,7 @@ int ParseInfo(struct pctx *pctx, unsigned int request)
         case MODEINFO_MAX_GROUP:
             return ARRAY_SIZE(groupinfo);
         case MODEINFO_GETNAME:
-            return (int)"PCI";
+            return (int)(size_t)"PCI";
         case 3:
             return 1;
         case MODEINFO_MAX_MODE:
@@ -907,7 +2183,9 @@ struct businfo *ParseBusInfo(struct pctx *pctx, uint16_t bus)
 {
     LogDebug(pctx, 6, "%s: %08x", "ParseBusInfo", bus);
     // Reset for parsing data
+    stop_decode();
     SeqDataVector.clear();
+    SeqDataIndex.clear();
     PCITransactions.clear();
     processing_done = 0;
     
@@ -975,6 +2253,14 @@ int ParseModeGetPut(struct pctx *pctx, int mode, int value, int request)
                 // RETRY_POLICY setting
                 set_retry_policy = value;
                 break;
+            case 6:
+                // RESULT_RAM setting
+                set_result_ram = value;
+                break;
+            case 7:
+                // GLITCH_FILTER setting
+                set_glitch_filter = value;
+                break;
             default:
                 break;
         }
@@ -1011,6 +2297,14 @@ int ParseModeGetPut(struct pctx *pctx, int mode, int value, int request)
                 // RETRY_POLICY setting
                 value = set_retry_policy;
                 break;
+            case 6:
+                // RESULT_RAM setting
+                value = set_result_ram;
+                break;
+            case 7:
+                // GLITCH_FILTER setting
+                value = set_glitch_filter;
+                break;
             default:
                 value = 0;
                 break;
@@ -100,16 +100,52 @@ SOURCE=.\PCI.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=..\ISA\chanmap.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\ISA\checkpoint.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\ISA\compat.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\ISA\deglitch.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\ISA\markset.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\ISA\mirror.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\ISA\pagestore.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\ISA\pipeline.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\ISA\platform.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\PCI.h
 # End Source File
 # Begin Source File
 
 SOURCE=..\ISA\stdint.h
 # End Source File
+# Begin Source File
+
+SOURCE=..\ISA\textout.h
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 
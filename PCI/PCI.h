@@ -1,8 +1,17 @@
 #ifndef PCI_H
 #define PCI_H
 
-#include "..\ISA\stdint.h"
-#include "..\ISA\compat.h"
+#include "../ISA/stdint.h"
+#include "../ISA/compat.h"
+#include "../ISA/platform.h"
+#include "../ISA/pagestore.h"
+#include "../ISA/markset.h"
+#include "../ISA/chanmap.h"
+#include "../ISA/checkpoint.h"
+#include "../ISA/mirror.h"
+#include "../ISA/deglitch.h"
+#include "../ISA/pipeline.h"
+#include "../ISA/textout.h"
 #include <vector>
 using namespace std;
 
@@ -33,6 +42,23 @@ using namespace std;
 #define PCI_LOCK        0x00200000  // LOCK# signal
 #define PCI_AD          0xFFC00000  // AD signals (Address/Data) - 10 bits for simplicity
 
+// Control lines the glitch filter applies to. CLK and RST# are left out: a
+// clock pulse of a few samples is a real edge the data phases are taken on.
+#define PCI_GLITCH_LINES (PCI_FRAME | PCI_IRDY | PCI_TRDY | PCI_STOP | \
+                          PCI_DEVSEL | PCI_GNT | PCI_REQ | PCI_LOCK)
+
+// PCI 64-bit extension signals (PCI64 group, only sampled in 64-bit mode)
+#define PCI64_C_BE_HI   0x0000000F  // C/BE[7:4]# signals - 4 bits
+#define PCI64_PAR64     0x00000010  // PAR64 signal (Parity for upper DWORD)
+#define PCI64_REQ64     0x00000020  // REQ64# signal (Request 64-bit transfer)
+#define PCI64_ACK64     0x00000040  // ACK64# signal (Acknowledge 64-bit transfer)
+
+// Group numbers (index into groupinfo[] in PCI.cpp)
+#define PCI_GROUP_ALL   0           // All PCI signals
+#define PCI_GROUP_AD    2           // Full AD[31:0]
+#define PCI_GROUP_AD64  5           // AD[63:32]
+#define PCI_GROUP_SIG64 6           // C/BE[7:4]#, PAR64, REQ64#, ACK64#
+
 // PCI Commands (C/BE# during address phase)
 #define PCI_CMD_INTERRUPT_ACK     0x0
 #define PCI_CMD_SPECIAL_CYCLE     0x1
@@ -68,6 +94,20 @@ enum PCI_BURST_TYPE {
     PCI_BURST_CONTINUOUS
 };
 
+// Status rows, each shown with a fixed text from pci_status_names
+enum PCI_STATUS_ROW {
+    PCI_STATUS_NONE,
+    PCI_STATUS_RESET_ABORT,
+    PCI_STATUS_RESET,
+    PCI_STATUS_BUS_REQUEST,
+    PCI_STATUS_GRANT_NO_REQUEST,
+    PCI_STATUS_BUS_GRANTED,
+    PCI_STATUS_PARKING_END,
+    PCI_STATUS_INT_ASSERTED,     // + interrupt pin (INTA# = 0 ... INTD# = 3)
+    PCI_STATUS_INT_DEASSERTED = PCI_STATUS_INT_ASSERTED + 4,
+    PCI_STATUS_GLITCHES = PCI_STATUS_INT_DEASSERTED + 4  // Pulses removed by the glitch filter
+};
+
 /*********************************************************
         TLA Types
 *********************************************************/
@@ -121,6 +161,8 @@ struct pctx_functable {
         void (*rda_free)(void *p);
         void *(*rda_calloc)(int memb, int size);
         int (*LAInfo)(struct lactx *, enum TLA_INFO, int16_t bus);
+        int (*LABusModTrigSample)(struct lactx *, int16_t bus);
+        int (*LAProgAbort)(struct lactx *);
 };
 
 struct pctx {
@@ -184,14 +226,14 @@ struct lafunc {
         void (*LAWhichBusMod_)(void);              /* 84 */
         void (*LASeqDisplayFormat_)(void);         /* 88 */
         void (*LAInteractiveUI2_)(void);           /* 8c */
-        void (*LAProgAbort_)(void);                /* 90 */
+        int  (*LAProgAbort)(struct lactx *);       /* 90 */
         void (*LATimestamp_ps_ToText)(void);       /* 94 */
         void (*LATimeStampDisplayFormat)(void);    /* 98 */
         void (*LAReferenceTime_ps_)(void);         /* 9c */
         void (*LABusModSysTrigTime_ps_)(void);     /* a0 */
         void (*LABusModFrameOffset_ps_)(void);     /* a4 */
         void (*LABusModTimeToUserAlignedTime_ps_)(void); /* a8 */
-        void (*LABusModTrigSample)(void);          /* ac */
+        int  (*LABusModTrigSample)(struct lactx *, int16_t bus); /* ac */
         void (*LABusModWallClockStart_)(void);     /* b0 */
         void *field_B4;                            /* b4 */
         void (*LAReferenceTime_ps_2)(void);        /* b8 */
@@ -231,6 +273,10 @@ enum PCI_ADDR_TYPE {
     PCI_ADDR_CONFIG_TYPE1
 };
 
+// Data phases whose data and byte enables are kept per transaction; a longer
+// burst is counted but the phases past this are not stored
+#define PCI_MAX_DATA_PHASES 16
+
 // Data structure for PCI transactions
 typedef struct TPCIData
 {
@@ -248,21 +294,33 @@ typedef struct TPCIData
     
     // Address and data
     uint64_t address;            // 64-bit address (for 32-bit, high 32 bits are 0)
-    uint32_t data[16];           // Up to 16 data phases in a burst
-    uint8_t byte_enables[16];    // Byte enables for each data phase
+    uint32_t data[PCI_MAX_DATA_PHASES];    // First data phases of a burst
+    uint32_t data_hi[PCI_MAX_DATA_PHASES]; // AD[63:32] of each 64-bit data phase
+    bool is_64bit_data;          // REQ64#/ACK64# negotiated 64-bit data phases
+    uint8_t byte_enables[PCI_MAX_DATA_PHASES]; // Byte enables for each data phase
     int data_phase_count;        // Number of data phases
     
     // Configuration cycle specific
+    uint8_t bus_num;             // Bus number for type 1 config cycles
     uint8_t device_num;          // Device number for config cycles
     uint8_t function_num;        // Function number for config cycles
+    uint8_t config_reg;          // Register offset (AD[7:2], dword aligned)
     bool is_type1_config;        // Is this a type 1 config cycle
     
+    // Target attribution (memory and I/O transactions)
+    bool has_target;             // Address fell inside a programmed BAR
+    uint16_t target_bdf;         // Owning bus/device/function (PCI_BDF)
+    uint8_t target_bar;          // Owning BAR number (0-5)
+    
     // Arbitration
     bool req_asserted;           // REQ# asserted during this transaction
     bool gnt_asserted;           // GNT# asserted during this transaction
     
     // Error conditions
     bool parity_error;           // PERR# asserted
+    bool par_mismatch;           // PAR does not match AD[31:0] + C/BE[3:0]#
+    bool par64_mismatch;         // PAR64 does not match AD[63:32] + C/BE[7:4]#
+    int par_mismatch_phase;      // First mismatching phase (-1 = address, n = data phase n)
     bool system_error;           // SERR# asserted
     bool master_abort;           // Master abort condition
     bool target_abort;           // Target abort condition
@@ -279,33 +337,109 @@ typedef struct TPCIData
     bool is_cache_line;          // Is this a cache line transaction
 } TPCIData;
 
-// Data structure for sequence entries
+// Whole decoder state before sample next_seq (see checkpoint.h)
+typedef struct TPCICheckpoint
+{
+    TPCIData transaction;       // Transaction in flight
+    uint32_t state;             // State machine state
+    bool in_transaction;
+    uint8_t command;
+    uint32_t previous_signals;  // Last sample, as the glitch filter passed it
+    bool par_pending;           // Parity pipeline
+    bool par64_pending;
+    uint32_t par_expected;
+    uint32_t par64_expected;
+    int par_phase;
+    uint32_t glitch_out;        // Glitch filter carry, when the filter is on
+    uint32_t glitch_dev;
+} TPCICheckpoint;
+
+// Configuration space shadow
+#define PCI_CFG_DWORDS      64      // 256-byte configuration space
+#define PCI_CFG_NO_VERSION  -1      // Register never observed
+#define PCI_CFG_COMMAND     0x04    // Command register (low half of the dword)
+#define PCI_CFG_CMD_IO      0x0001  // Command: I/O space enable
+#define PCI_CFG_CMD_MEMORY  0x0002  // Command: memory space enable
+#define PCI_CFG_BAR0        0x10    // Offset of the first Base Address Register
+#define PCI_CFG_BARS        6       // Base Address Registers in a type 0 header
+#define PCI_CFG_HEADER_TYPE 0x0C    // Dword holding the header type (byte 2)
+#define PCI_CFG_NO_IDSEL    0x1F    // Type 0 device when no AD[31:11] line was set
+
+// BAR enumeration states, as seen from configuration traffic
+enum PCI_BAR_STATE {
+    PCI_BAR_UNKNOWN,                // Nothing observed yet
+    PCI_BAR_SIZING,                 // All-ones written, size read pending
+    PCI_BAR_SIZED,                  // Size read back, address not yet written
+    PCI_BAR_PROGRAMMED              // Address written, window decoded
+};
+
+// Make a Bus[15:8] Device[7:3] Function[2:0] key
+#define PCI_BDF(bus, dev, func) ((uint16_t)(((bus) << 8) | (((dev) & 0x1F) << 3) | ((func) & 0x7)))
+
+// One observed value of a configuration register
+typedef struct TPCIConfigVersion
+{
+    int sequence;                // Sequence of the config transaction
+    uint32_t value;              // Register value after byte-enable merge
+    uint8_t valid_bytes;         // Bytes known so far (bit n = byte n)
+    uint8_t written;             // Set by a Config Write, clear for a Config Read
+} TPCIConfigVersion;
+
+// Shadow of one function's configuration space
+typedef struct TPCIConfigShadow
+{
+    uint16_t bdf;                // Bus/device/function key (PCI_BDF)
+    int history[PCI_CFG_DWORDS]; // Version list of each register, PCI_CFG_NO_VERSION if never seen
+    
+    // BAR sizing
+    uint32_t bar_size[PCI_CFG_BARS];  // Decode size from a sizing probe, 0 if not seen
+    uint8_t bar_state[PCI_CFG_BARS];  // PCI_BAR_STATE of each BAR
+    
+    // Statistics for transactions attributed to this function
+    int transactions;            // Memory and I/O transactions
+    int data_phases;             // Data phases in those transactions
+} TPCIConfigShadow;
+
+// Address window decoded by one programmed BAR
+typedef struct TPCIBarWindow
+{
+    uint64_t base;               // First decoded address
+    uint64_t limit;              // Last decoded address
+    uint16_t bdf;                // Owning bus/device/function (PCI_BDF)
+    uint8_t bar;                 // BAR number (0-5)
+    bool is_io;                  // I/O space (vs memory space)
+    bool sized;                  // Size read back from a probe, not guessed from the base
+} TPCIBarWindow;
+
+// Packed result row; the text is formatted only when the host asks for it
 typedef struct TSeqData
 {
     int seq_number;
-    struct sequence seq_data;
-} TSeqData;
+    int transaction;             // PCITransactions index + 1, 0 for status rows
+    uint8_t status;              // PCI_STATUS_ROW of a status row
+    uint8_t flags;               // Display flags, as in struct sequence
+} TSeqData;                      // 12 bytes
 
-typedef vector<TSeqData> TVSeqData;
+typedef TPagedStore<TSeqData> TSeqDataStore;
 
 /*********************************************************
         DLL prototypes
 *********************************************************/
 extern "C"
 {
-__declspec(dllexport) struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *func);
-__declspec(dllexport) int ParseFinish(struct pctx *pctx);
-__declspec(dllexport) int ParseInfo(struct pctx *pctx, unsigned int request);
-__declspec(dllexport) int ParseMarkMenu(struct pctx *, int, int, int, int);
-__declspec(dllexport) int ParseMarkGet(struct pctx *pctx, int seq);
-__declspec(dllexport) int ParseMarkSet(struct pctx *pctx, int seq, int);
-__declspec(dllexport) int ParseMarkNext(struct pctx *pctx, int seq, int);
-__declspec(dllexport) int ParseModeGetPut(struct pctx *pctx, int mode, int, int request);
-__declspec(dllexport) struct sequence *ParseSeq(struct pctx *, int seq);
-__declspec(dllexport) struct businfo *ParseBusInfo(struct pctx *, uint16_t bus);
-__declspec(dllexport) struct modeinfo *ParseModeInfo(struct pctx *pctx, uint16_t mode);
-__declspec(dllexport) struct groupinfo *ParseGroupInfo(struct pctx *pctx, uint16_t group);
-__declspec(dllexport) int ParseDisasmReinit(struct pctx *, int request);
+PARSE_EXPORT struct pctx *ParseReinit(struct pctx *pctx, struct lactx *lactx, struct lafunc *func);
+PARSE_EXPORT int ParseFinish(struct pctx *pctx);
+PARSE_EXPORT int ParseInfo(struct pctx *pctx, unsigned int request);
+PARSE_EXPORT int ParseMarkMenu(struct pctx *, int, int, int, int);
+PARSE_EXPORT int ParseMarkGet(struct pctx *pctx, int seq);
+PARSE_EXPORT int ParseMarkSet(struct pctx *pctx, int seq, int);
+PARSE_EXPORT int ParseMarkNext(struct pctx *pctx, int seq, int);
+PARSE_EXPORT int ParseModeGetPut(struct pctx *pctx, int mode, int, int request);
+PARSE_EXPORT struct sequence *ParseSeq(struct pctx *, int seq);
+PARSE_EXPORT struct businfo *ParseBusInfo(struct pctx *, uint16_t bus);
+PARSE_EXPORT struct modeinfo *ParseModeInfo(struct pctx *pctx, uint16_t mode);
+PARSE_EXPORT struct groupinfo *ParseGroupInfo(struct pctx *pctx, uint16_t group);
+PARSE_EXPORT int ParseDisasmReinit(struct pctx *, int request);
 }
 
 #endif // PCI_H
\ No newline at end of file
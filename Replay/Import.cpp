@@ -0,0 +1,1408 @@
+// Import.cpp - Stream VCD and sigrok traces into capture files
+//
+// A trace is read twice, once to count the samples and once to fill the
+// capture, so memory use does not grow with the trace. Every point in
+// time where a mapped signal changes becomes one capture sample, stamped
+// with its time in picoseconds.
+#include "import.h"
+#include "capfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+
+#define IMPORT_READ_BUFFER  65536
+#define IMPORT_NAME_LEN     64
+#define INFLATE_WINDOW      32768
+#define SIGROK_METADATA_MAX (1 << 20)
+
+/*********************************************************
+        Package layouts
+*********************************************************/
+// ISA.h: ISA_Control, ISA_Addr, ISA_Data, ISA_DMA, ISA_IRQ
+static const TLayoutGroup isa_groups[] = {
+    { "ISA_Control", 14, 0x00000BFC },  // Strobes, MASTER#, SBHE#, IOCHK# high, IOCHRDY ready
+    { "ISA_Addr", 24, 0 },
+    { "ISA_Data", 16, 0 },
+    { "ISA_DMA", 31, 0x007F0000 },      // DACKn# high
+    { "ISA_IRQ", 12, 0 }
+};
+
+static const TLayoutSignal isa_signals[] = {
+    { "BCLK", 0, 0, 1, 0, 1 },          // ISA_BCLK
+    { "SYSCLK", 0, 0, 1, 0, 1 },
+    { "ALE", 0, 0, 1, 1, 0 },           // ISA_ALE
+    { "BALE", 0, 0, 1, 1, 0 },
+    { "IOR", 0, 0, 1, 2, 0 },           // ISA_IOR
+    { "IOW", 0, 0, 1, 3, 0 },           // ISA_IOW
+    { "MEMR", 0, 0, 1, 4, 0 },          // ISA_MEMR
+    { "SMEMR", 0, 0, 1, 4, 0 },
+    { "MEMW", 0, 0, 1, 5, 0 },          // ISA_MEMW
+    { "SMEMW", 0, 0, 1, 5, 0 },
+    { "REFRESH", 0, 0, 1, 6, 0 },       // ISA_REFRESH
+    { "MASTER", 0, 0, 1, 7, 0 },        // ISA_MASTER
+    { "SBHE", 0, 0, 1, 8, 0 },          // ISA_SBHE
+    { "IOCHRDY", 0, 0, 1, 9, 0 },       // ISA_IOCHRDY
+    { "CHRDY", 0, 0, 1, 9, 0 },
+    { "AEN", 0, 0, 1, 10, 0 },          // ISA_AEN
+    { "IOCHK", 0, 0, 1, 11, 0 },        // ISA_IOCHK
+    { "RESET", 0, 0, 1, 12, 0 },        // ISA_RESET
+    { "RESETDRV", 0, 0, 1, 12, 0 },
+    { "OSC", 0, 0, 1, 13, 0 },          // ISA_OSC
+    { "SA", 1, 0, 20, 0, 0 },           // ISA_ADDR_MASK
+    { "LA", 1, 17, 7, 17, 0 },
+    { "SD", 2, 0, 16, 0, 0 },           // ISA_DATA_MASK
+    { "DACK", 3, 0, 4, 16, 0 },         // ISA_DACK0..3
+    { "DACK", 3, 5, 3, 20, 0 },         // ISA_DACK5..7
+    { "DRQ", 3, 0, 4, 23, 0 },          // ISA_DRQ0..3
+    { "DRQ", 3, 5, 3, 27, 0 },          // ISA_DRQ5..7
+    { "TC", 3, 0, 1, 30, 0 },           // ISA_TC
+    { "IRQ", 4, 2, 6, 0, 0 },           // ISA_IRQ2..7
+    { "IRQ", 4, 10, 3, 6, 0 },          // ISA_IRQ10..12
+    { "IRQ", 4, 14, 2, 9, 0 },          // ISA_IRQ14..15
+    { "IRQ", 4, 9, 1, 11, 0 }           // ISA_IRQ9
+};
+
+// ISA_Minimal.h: control, address and data only, MASTER#/DRQ/DACK#/TC in the control group
+static const TLayoutGroup isa_minimal_groups[] = {
+    { "ISA_Control", 20, 0x000511FC },  // Strobes, SBHE#, IOCHK#, MASTER#, DACK# high, IOCHRDY ready
+    { "ISA_Addr", 20, 0 },
+    { "ISA_Data", 16, 0 }
+};
+
+static const TLayoutSignal isa_minimal_signals[] = {
+    { "BCLK", 0, 0, 1, 0, 1 },          // ISA_BCLK
+    { "SYSCLK", 0, 0, 1, 0, 1 },
+    { "ALE", 0, 0, 1, 1, 0 },           // ISA_ALE
+    { "BALE", 0, 0, 1, 1, 0 },
+    { "IOR", 0, 0, 1, 2, 0 },           // ISA_IOR
+    { "IOW", 0, 0, 1, 3, 0 },           // ISA_IOW
+    { "MEMR", 0, 0, 1, 4, 0 },          // ISA_MEMR
+    { "SMEMR", 0, 0, 1, 4, 0 },
+    { "MEMW", 0, 0, 1, 5, 0 },          // ISA_MEMW
+    { "SMEMW", 0, 0, 1, 5, 0 },
+    { "REFRESH", 0, 0, 1, 6, 0 },       // ISA_REFRESH
+    { "SBHE", 0, 0, 1, 7, 0 },          // ISA_SBHE
+    { "IOCHRDY", 0, 0, 1, 8, 0 },       // ISA_IOCHRDY
+    { "CHRDY", 0, 0, 1, 8, 0 },
+    { "AEN", 0, 0, 1, 9, 0 },           // ISA_AEN
+    { "RESET", 0, 0, 1, 10, 0 },        // ISA_RESET
+    { "RESETDRV", 0, 0, 1, 10, 0 },
+    { "OSC", 0, 0, 1, 11, 0 },          // ISA_OSC
+    { "IOCHK", 0, 0, 1, 12, 0 },        // ISA_IOCHK
+    { "MASTER", 0, 0, 1, 16, 0 },       // ISA_MASTER
+    { "DRQ", 0, 0, 1, 17, 0 },          // ISA_DRQ
+    { "DACK", 0, 0, 1, 18, 0 },         // ISA_DACK
+    { "TC", 0, 0, 1, 19, 0 },           // ISA_TC
+    { "SA", 1, 0, 20, 0, 0 },           // ISA_ADDR_MASK
+    { "SD", 2, 0, 16, 0, 0 }            // ISA_DATA_MASK
+};
+
+// PCI.h: PCI, PCIAD, PCIAD64 and PCI64 (the groups the decoder reads)
+static const TLayoutGroup pci_groups[] = {
+    { "PCI", 32, 0x0020FF7E },          // RST#, FRAME#..DEVSEL#, PERR#, SERR#, INTx#, GNT#, REQ#, LOCK# high
+    { "PCIAD", 32, 0 },
+    { "PCIAD64", 32, 0 },
+    { "PCI64", 7, 0x0000007F }          // C/BE[7:4]#, PAR64, REQ64#, ACK64# high
+};
+
+static const TLayoutSignal pci_signals[] = {
+    { "CLK", 0, 0, 1, 0, 1 },           // PCI_CLK
+    { "RST", 0, 0, 1, 1, 0 },           // PCI_RST
+    { "FRAME", 0, 0, 1, 2, 0 },         // PCI_FRAME
+    { "IRDY", 0, 0, 1, 3, 0 },          // PCI_IRDY
+    { "TRDY", 0, 0, 1, 4, 0 },          // PCI_TRDY
+    { "STOP", 0, 0, 1, 5, 0 },          // PCI_STOP
+    { "DEVSEL", 0, 0, 1, 6, 0 },        // PCI_DEVSEL
+    { "PAR", 0, 0, 1, 7, 0 },           // PCI_PAR
+    { "PERR", 0, 0, 1, 8, 0 },          // PCI_PERR
+    { "SERR", 0, 0, 1, 9, 0 },          // PCI_SERR
+    { "INTA", 0, 0, 1, 10, 0 },         // PCI_INTA
+    { "INTB", 0, 0, 1, 11, 0 },         // PCI_INTB
+    { "INTC", 0, 0, 1, 12, 0 },         // PCI_INTC
+    { "INTD", 0, 0, 1, 13, 0 },         // PCI_INTD
+    { "GNT", 0, 0, 1, 14, 0 },          // PCI_GNT
+    { "REQ", 0, 0, 1, 15, 0 },          // PCI_REQ
+    { "CBE", 0, 0, 4, 16, 0 },          // PCI_C_BE
+    { "CBE", 3, 4, 4, 0, 0 },           // PCI64_C_BE_HI
+    { "IDSEL", 0, 0, 1, 20, 0 },        // PCI_IDSEL
+    { "LOCK", 0, 0, 1, 21, 0 },         // PCI_LOCK
+    { "AD", 0, 0, 10, 22, 0 },          // PCI_AD
+    { "AD", 1, 0, 32, 0, 0 },           // PCI_GROUP_AD
+    { "AD", 2, 32, 32, 0, 0 },          // PCI_GROUP_AD64
+    { "PAR64", 3, 0, 1, 4, 0 },         // PCI64_PAR64
+    { "REQ64", 3, 0, 1, 5, 0 },         // PCI64_REQ64
+    { "ACK64", 3, 0, 1, 6, 0 }          // PCI64_ACK64
+};
+
+#define LAYOUT(name, groups, signals) \
+    { name, groups, sizeof(groups) / sizeof(groups[0]), signals, sizeof(signals) / sizeof(signals[0]) }
+
+static const TTraceLayout layouts[] = {
+    LAYOUT("ISA", isa_groups, isa_signals),
+    LAYOUT("ISA_Minimal", isa_minimal_groups, isa_minimal_signals),
+    LAYOUT("PCI", pci_groups, pci_signals)
+};
+
+const TTraceLayout *FindLayout(const char *name)
+{
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++)
+    {
+        if (strcmp(layouts[i].name, name) == 0)
+            return &layouts[i];
+    }
+    return NULL;
+}
+
+const TTraceLayout *MatchLayout(const char *const *group_names, int count)
+{
+    const TTraceLayout *best = NULL;
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++)
+    {
+        int found = 0;
+        for (int g = 0; g < layouts[i].group_count; g++)
+        {
+            for (int n = 0; n < count; n++)
+            {
+                if (strcmp(layouts[i].groups[g].name, group_names[n]) == 0)
+                {
+                    found++;
+                    break;
+                }
+            }
+        }
+        if (found == layouts[i].group_count && (best == NULL || found > best->group_count))
+            best = &layouts[i];
+    }
+    return best;
+}
+
+/*********************************************************
+        Signal names
+*********************************************************/
+// Upper case letters and digits only, so "IOR#", "ior" and "C/BE" compare
+// as "IOR" and "CBE"
+static void normalize_name(const char *name, char *out, size_t size)
+{
+    size_t n = 0;
+    for (; *name != '\0' && n + 1 < size; name++)
+    {
+        if (isalnum((unsigned char)*name))
+            out[n++] = (char)toupper((unsigned char)*name);
+    }
+    out[n] = '\0';
+}
+
+// Split "SA5" into "SA" and 5. Returns false if the name has no index.
+static bool split_index(char *name, int& index)
+{
+    size_t len = strlen(name);
+    size_t digits = len;
+    while (digits > 0 && isdigit((unsigned char)name[digits - 1]))
+        digits--;
+    if (digits == 0 || digits == len)
+    {
+        return false;
+    }
+    index = atoi(name + digits);
+    name[digits] = '\0';
+    return true;
+}
+
+/*********************************************************
+        Sample builder
+*********************************************************/
+// Collects the signal changes of one point in time and turns them into
+// capture samples. Clock edges are sampled before the other changes at the
+// same time, the way a logic analyzer sees signals that change on the edge.
+class TSampleBuilder
+{
+public:
+    TSampleBuilder(const TTraceLayout *layout, const char *const *renames, int rename_count)
+        : layout(layout), renames(renames), rename_count(rename_count), capture(NULL) {}
+
+    // Start a pass; without a capture the samples are only counted
+    void begin(TCaptureFile *file)
+    {
+        capture = file;
+        sources.clear();
+        targets.clear();
+        count = 0;
+        mapped = 0;
+        time = 0;
+        pending = false;
+        for (int g = 0; g < CAPFILE_MAX_GROUPS; g++)
+        {
+            current[g] = g < layout->group_count ? layout->groups[g].idle : 0;
+            pend_value[g] = 0;
+            pend_mask[g] = 0;
+            clock_mask[g] = 0;
+        }
+    }
+
+    // Register a trace signal of width bits, bit 0 being index lsb (or
+    // counting down from it when msb < lsb). Without a range the index
+    // comes from the name. Returns the id used for its changes.
+    int add_signal(const char *name, int width, int msb, int lsb)
+    {
+        char base[IMPORT_NAME_LEN];
+        normalize_name(rename(name), base, sizeof(base));
+
+        TSource source;
+        source.first_target = (int)targets.size();
+        source.target_count = 0;
+
+        int index = -1;
+        resolve(base, width == 1 && msb < 0 ? &index : NULL);
+        if (index >= 0)
+        {
+            msb = lsb = index;
+        }
+        else if (msb < 0 || lsb < 0)
+        {
+            lsb = 0;
+            msb = width - 1;
+        }
+
+        for (int k = 0; k < width && k < 64; k++)
+        {
+            int at = msb >= lsb ? lsb + k : lsb - k;
+            for (int i = 0; i < layout->signal_count; i++)
+            {
+                const TLayoutSignal& s = layout->signals[i];
+                if (strcmp(s.name, base) != 0 || at < s.first || at >= s.first + s.count)
+                    continue;
+
+                TTarget target;
+                target.source_bit = k;
+                target.group = s.group;
+                target.mask = 1UL << (s.bit + at - s.first);
+                targets.push_back(target);
+                source.target_count++;
+                if (s.clock)
+                    clock_mask[s.group] |= target.mask;
+            }
+        }
+        if (source.target_count > 0)
+            mapped++;
+        sources.push_back(source);
+        return (int)sources.size() - 1;
+    }
+
+    void set_time(int64_t ps)
+    {
+        if (ps != time)
+        {
+            flush();
+            time = ps;
+        }
+    }
+
+    void change(int id, uint64_t value)
+    {
+        const TSource& source = sources[id];
+        for (int i = 0; i < source.target_count; i++)
+        {
+            const TTarget& target = targets[source.first_target + i];
+            pend_mask[target.group] |= target.mask;
+            if ((value >> target.source_bit) & 1)
+                pend_value[target.group] |= target.mask;
+            else
+                pend_value[target.group] &= ~target.mask;
+            pending = true;
+        }
+    }
+
+    void finish()
+    {
+        flush();
+    }
+
+    int samples() const { return count; }
+    int mapped_signals() const { return mapped; }
+    bool full() const { return count == 0x7FFFFFFF; }
+
+private:
+    struct TTarget
+    {
+        int source_bit;             // Bit of the trace value
+        int group;                  // Layout group and bit it lands on
+        uint32_t mask;
+    };
+
+    struct TSource
+    {
+        int first_target;
+        int target_count;
+    };
+
+    const char *rename(const char *name) const
+    {
+        char want[IMPORT_NAME_LEN];
+        char have[IMPORT_NAME_LEN];
+        normalize_name(name, want, sizeof(want));
+        for (int i = 0; i < rename_count; i++)
+        {
+            const char *eq = strchr(renames[i], '=');
+            if (eq == NULL || (size_t)(eq - renames[i]) >= sizeof(have))
+                continue;
+            memcpy(have, renames[i], eq - renames[i]);
+            have[eq - renames[i]] = '\0';
+            normalize_name(have, have, sizeof(have));
+            if (strcmp(want, have) == 0)
+                return eq + 1;
+        }
+        return name;
+    }
+
+    bool known(const char *base) const
+    {
+        for (int i = 0; i < layout->signal_count; i++)
+        {
+            if (strcmp(layout->signals[i].name, base) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    // Turn a normalized trace name into a layout name: tried as is, without
+    // a package prefix ("ISA_IOR"), without an active-low suffix ("IOR_N")
+    // and, for scalars, with a bit index split off ("SA5", "PCI_AD5").
+    // Leaves the name alone if nothing matches.
+    void resolve(char *base, int *index) const
+    {
+        static const char *const prefixes[] = { "", "ISA", "PCI" };
+        char name[IMPORT_NAME_LEN];
+        for (int p = 0; p < 3; p++)
+        {
+            size_t skip = strlen(prefixes[p]);
+            if (strncmp(base, prefixes[p], skip) != 0 || base[skip] == '\0')
+                continue;
+            for (int strip = 0; strip < 2; strip++)
+            {
+                strcpy(name, base + skip);
+                size_t len = strlen(name);
+                if (strip && (len < 3 || name[len - 1] != 'N'))
+                    continue;
+                if (strip)
+                    name[len - 1] = '\0';
+
+                if (known(name) || (index != NULL && split_index(name, *index) && known(name)))
+                {
+                    strcpy(base, name);
+                    return;
+                }
+                if (index != NULL)
+                    *index = -1;
+            }
+        }
+    }
+
+    void flush()
+    {
+        if (!pending)
+        {
+            return;
+        }
+
+        // Clock edges first, with the other signals still at their old levels
+        uint32_t next[CAPFILE_MAX_GROUPS];
+        bool changed = false;
+        int g;
+        for (g = 0; g < layout->group_count; g++)
+        {
+            uint32_t edge = pend_mask[g] & clock_mask[g];
+            next[g] = (current[g] & ~edge) | (pend_value[g] & edge);
+            changed = changed || next[g] != current[g];
+        }
+        if (changed && count > 0)
+            emit(next);
+
+        changed = false;
+        for (g = 0; g < layout->group_count; g++)
+        {
+            next[g] = (current[g] & ~pend_mask[g]) | (pend_value[g] & pend_mask[g]);
+            changed = changed || next[g] != current[g];
+            pend_mask[g] = 0;
+        }
+        if (changed || count == 0)
+            emit(next);
+        pending = false;
+    }
+
+    void emit(const uint32_t *values)
+    {
+        if (full())
+        {
+            return;
+        }
+        for (int g = 0; g < layout->group_count; g++)
+        {
+            current[g] = values[g];
+            if (capture != NULL)
+                capture->set_value(count, g, values[g]);
+        }
+        if (capture != NULL)
+            capture->set_timestamp(count, time);
+        count++;
+    }
+
+    const TTraceLayout *layout;
+    const char *const *renames;
+    int rename_count;
+    TCaptureFile *capture;              // NULL while counting
+    std::vector<TSource> sources;       // By signal id
+    std::vector<TTarget> targets;
+    uint32_t current[CAPFILE_MAX_GROUPS];   // Group values of the last sample
+    uint32_t pend_value[CAPFILE_MAX_GROUPS];// Changes at the current time
+    uint32_t pend_mask[CAPFILE_MAX_GROUPS];
+    uint32_t clock_mask[CAPFILE_MAX_GROUPS];
+    int64_t time;                       // Current time, ps
+    bool pending;                       // Changes not yet sampled
+    int count;                          // Samples emitted
+    int mapped;                         // Trace signals that feed a group
+};
+
+/*********************************************************
+        Buffered input
+*********************************************************/
+class TReader
+{
+public:
+    TReader() : file(NULL), pos(0), len(0), limit(0) {}
+    ~TReader() { close(); }
+
+    bool open(const char *path)
+    {
+        close();
+        file = fopen(path, "rb");
+        return file != NULL;
+    }
+
+    void close()
+    {
+        if (file != NULL)
+            fclose(file);
+        file = NULL;
+        pos = len = 0;
+    }
+
+    // Restrict reads to the next size bytes from offset
+    bool seek(long offset, uint32_t size)
+    {
+        pos = len = 0;
+        limit = size;
+        return fseek(file, offset, SEEK_SET) == 0;
+    }
+
+    void unlimit() { limit = 0xFFFFFFFFUL; }
+
+    // Next byte, -1 at the end
+    int get()
+    {
+        if (pos == len)
+        {
+            size_t want = limit < sizeof(buffer) ? limit : sizeof(buffer);
+            len = want > 0 ? fread(buffer, 1, want, file) : 0;
+            pos = 0;
+            if (len == 0)
+                return -1;
+            if (limit != 0xFFFFFFFFUL)
+                limit -= (uint32_t)len;
+        }
+        return buffer[pos++];
+    }
+
+    size_t read(uint8_t *out, size_t size)
+    {
+        size_t n = 0;
+        while (n < size)
+        {
+            if (pos == len && get() >= 0)
+                pos--;
+            if (pos == len)
+                break;
+            size_t take = len - pos < size - n ? len - pos : size - n;
+            memcpy(out + n, buffer + pos, take);
+            pos += take;
+            n += take;
+        }
+        return n;
+    }
+
+    FILE *handle() { return file; }
+
+private:
+    FILE *file;
+    uint8_t buffer[IMPORT_READ_BUFFER];
+    size_t pos;
+    size_t len;
+    uint32_t limit;                 // Bytes left to read from the file
+};
+
+/*********************************************************
+        VCD
+*********************************************************/
+// Read the next whitespace separated token, false at the end of the file
+static bool vcd_token(TReader& in, std::string& token)
+{
+    token.erase();
+    int c = in.get();
+    while (c >= 0 && isspace(c))
+        c = in.get();
+    while (c >= 0 && !isspace(c))
+    {
+        token += (char)c;
+        c = in.get();
+    }
+    return !token.empty();
+}
+
+static bool vcd_skip_to_end(TReader& in, std::string& token)
+{
+    while (vcd_token(in, token))
+    {
+        if (token == "$end")
+            return true;
+    }
+    return false;
+}
+
+// Picoseconds per timescale unit as a ratio
+static bool vcd_timescale(const std::string& text, int64_t& mul, int64_t& div)
+{
+    int amount = atoi(text.c_str());
+    size_t unit = text.find_first_not_of("0123456789 \t\r\n");
+    if (amount <= 0 || unit == std::string::npos)
+    {
+        return false;
+    }
+
+    std::string name = text.substr(unit);
+    while (!name.empty() && isspace((unsigned char)name[name.size() - 1]))
+        name.erase(name.size() - 1);
+
+    mul = amount;
+    div = 1;
+    if (name == "s")
+        mul *= (int64_t)1000000000 * 1000;
+    else if (name == "ms")
+        mul *= (int64_t)1000000000;
+    else if (name == "us")
+        mul *= 1000000;
+    else if (name == "ns")
+        mul *= 1000;
+    else if (name == "ps")
+        ;
+    else if (name == "fs")
+        div = 1000;
+    else
+        return false;
+    return true;
+}
+
+// Parse "[19:0]" or "[5]"
+static void vcd_range(const std::string& text, int& msb, int& lsb)
+{
+    size_t open = text.find('[');
+    if (open == std::string::npos)
+    {
+        return;
+    }
+    msb = lsb = atoi(text.c_str() + open + 1);
+    size_t colon = text.find(':', open);
+    if (colon != std::string::npos)
+        lsb = atoi(text.c_str() + colon + 1);
+}
+
+static bool read_vcd(const char *path, TSampleBuilder& out, char *error, size_t error_size)
+{
+    TReader in;
+    if (!in.open(path))
+    {
+        snprintf(error, error_size, "%s: cannot open", path);
+        return false;
+    }
+    in.unlimit();
+
+    std::map<std::string, int> ids;     // Identifier code -> first signal
+    std::vector<int> aliases;           // Next signal sharing the code, -1 at the end
+    int64_t mul = 1000;                 // Default timescale 1 ns
+    int64_t div = 1;
+    std::string token;
+
+    // Header
+    while (true)
+    {
+        if (!vcd_token(in, token))
+        {
+            snprintf(error, error_size, "%s: no $enddefinitions", path);
+            return false;
+        }
+        if (token == "$enddefinitions")
+        {
+            vcd_skip_to_end(in, token);
+            break;
+        }
+        if (token == "$timescale")
+        {
+            std::string text;
+            while (vcd_token(in, token) && token != "$end")
+                text += token;
+            if (!vcd_timescale(text, mul, div))
+            {
+                snprintf(error, error_size, "%s: unsupported timescale %s", path, text.c_str());
+                return false;
+            }
+        }
+        else if (token == "$var")
+        {
+            // $var type width code reference [range] $end
+            std::string fields[6];
+            int n = 0;
+            while (vcd_token(in, token) && token != "$end")
+            {
+                if (n < 6)
+                    fields[n++] = token;
+            }
+            if (n < 4)
+                continue;
+
+            int width = atoi(fields[1].c_str());
+            int msb = -1;
+            int lsb = -1;
+            std::string name = fields[3];
+            size_t bracket = name.find('[');
+            if (bracket != std::string::npos)
+            {
+                vcd_range(name, msb, lsb);
+                name.erase(bracket);
+            }
+            else if (n > 4)
+            {
+                vcd_range(fields[4], msb, lsb);
+            }
+            if (msb >= 0 && width > 1 && msb == lsb)
+                msb = -1;       // A lone index on a vector is not a range
+            if (width == 1 && msb >= 0)
+                lsb = msb;
+
+            int id = out.add_signal(name.c_str(), width, msb, lsb);
+            aliases.push_back(-1);
+            std::map<std::string, int>::iterator it = ids.find(fields[2]);
+            if (it == ids.end())
+            {
+                ids[fields[2]] = id;
+            }
+            else
+            {
+                aliases[id] = it->second;
+                it->second = id;
+            }
+        }
+        else if (token[0] == '$')
+        {
+            vcd_skip_to_end(in, token);
+        }
+    }
+
+    // Value changes
+    while (vcd_token(in, token))
+    {
+        char c = token[0];
+        uint64_t value = 0;
+        std::string code;
+        if (c == '#')
+        {
+            int64_t t = 0;
+            for (size_t i = 1; i < token.size(); i++)
+                t = t * 10 + (token[i] - '0');
+            out.set_time(t * mul / div);
+            continue;
+        }
+        else if (c == '$')
+        {
+            if (token == "$comment")
+                vcd_skip_to_end(in, token);
+            continue;       // $dumpvars, $dumpall, $end, ...
+        }
+        else if (c == 'b' || c == 'B')
+        {
+            // Floating bits read high (pulled up), unknown ones low. A short
+            // vector extends with its leftmost bit if that is z.
+            for (size_t i = 1; i < token.size(); i++)
+                value = (value << 1) | ((token[i] == '1' || token[i] == 'z' || token[i] == 'Z') ? 1 : 0);
+            if (token.size() > 1 && (token[1] == 'z' || token[1] == 'Z') && token.size() - 1 < 64)
+                value |= ~(uint64_t)0 << (token.size() - 1);
+            if (!vcd_token(in, code))
+                break;
+        }
+        else if (c == 'r' || c == 'R')
+        {
+            vcd_token(in, code);    // Real values have no place in a group
+            continue;
+        }
+        else if (c == '0' || c == '1' || c == 'x' || c == 'X' || c == 'z' || c == 'Z')
+        {
+            value = (c == '1' || c == 'z' || c == 'Z') ? ~(uint64_t)0 : 0;
+            code = token.substr(1);
+        }
+        else
+        {
+            continue;
+        }
+
+        std::map<std::string, int>::iterator it = ids.find(code);
+        if (it == ids.end())
+            continue;
+        for (int id = it->second; id >= 0; id = aliases[id])
+            out.change(id, value);
+        if (out.full())
+            break;
+    }
+    return true;
+}
+
+/*********************************************************
+        Inflate
+*********************************************************/
+class TByteSink
+{
+public:
+    virtual ~TByteSink() {}
+    virtual void bytes(const uint8_t *data, size_t size) = 0;
+};
+
+// Huffman code in canonical form: codes per length and symbols by code
+typedef struct THuffman
+{
+    short count[16];
+    short symbol[288];
+} THuffman;
+
+// Deflate decoder (RFC 1951) pulling compressed bytes from a reader and
+// pushing the output to a sink through a 32 KB window
+class TInflate
+{
+public:
+    TInflate(TReader& in, TByteSink& sink) : in(in), sink(sink), bitbuf(0), bitcnt(0),
+                                             truncated(false), wpos(0), filled(0) {}
+
+    bool run()
+    {
+        int last;
+        do
+        {
+            last = bits(1);
+            int type = bits(2);
+            bool ok;
+            if (type == 0)
+                ok = stored();
+            else if (type == 1)
+                ok = fixed();
+            else if (type == 2)
+                ok = dynamic();
+            else
+                ok = false;
+            if (!ok || truncated)
+                return false;
+        } while (!last);
+
+        sink.bytes(window, wpos);
+        return true;
+    }
+
+private:
+    int bits(int need)
+    {
+        while (bitcnt < need)
+        {
+            int c = in.get();
+            if (c < 0)
+            {
+                truncated = true;
+                return 0;
+            }
+            bitbuf |= (uint32_t)c << bitcnt;
+            bitcnt += 8;
+        }
+        int value = (int)(bitbuf & ((1UL << need) - 1));
+        bitbuf >>= need;
+        bitcnt -= need;
+        return value;
+    }
+
+    void put(uint8_t byte)
+    {
+        window[wpos++] = byte;
+        if (filled < INFLATE_WINDOW)
+            filled++;
+        if (wpos == INFLATE_WINDOW)
+        {
+            sink.bytes(window, wpos);
+            wpos = 0;
+        }
+    }
+
+    int decode(const THuffman& h)
+    {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int len = 1; len < 16; len++)
+        {
+            code |= bits(1);
+            int count = h.count[len];
+            if (code - count < first)
+                return h.symbol[index + (code - first)];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    static bool build(THuffman& h, const short *length, int n)
+    {
+        short offs[16];
+        int len;
+        int symbol;
+        for (len = 0; len < 16; len++)
+            h.count[len] = 0;
+        for (symbol = 0; symbol < n; symbol++)
+            h.count[length[symbol]]++;
+
+        int left = 1;
+        for (len = 1; len < 16; len++)
+        {
+            left <<= 1;
+            left -= h.count[len];
+            if (left < 0)
+                return false;   // Over-subscribed
+        }
+
+        offs[1] = 0;
+        for (len = 1; len < 15; len++)
+            offs[len + 1] = offs[len] + h.count[len];
+        for (symbol = 0; symbol < n; symbol++)
+        {
+            if (length[symbol] != 0)
+                h.symbol[offs[length[symbol]]++] = (short)symbol;
+        }
+        return true;
+    }
+
+    bool stored()
+    {
+        bitbuf = 0;
+        bitcnt = 0;
+        int len = bits(16);
+        int nlen = bits(16);
+        if (truncated || len != (~nlen & 0xFFFF))
+            return false;
+        while (len-- > 0)
+        {
+            int c = in.get();
+            if (c < 0)
+                return false;
+            put((uint8_t)c);
+        }
+        return true;
+    }
+
+    bool codes(const THuffman& lencode, const THuffman& distcode)
+    {
+        static const short lbase[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const short lext[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const short dbase[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+            8193, 12289, 16385, 24577 };
+        static const short dext[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        while (!truncated)
+        {
+            int symbol = decode(lencode);
+            if (symbol < 0)
+                return false;
+            if (symbol < 256)
+            {
+                put((uint8_t)symbol);
+                continue;
+            }
+            if (symbol == 256)
+                return true;
+
+            symbol -= 257;
+            if (symbol >= 29)
+                return false;
+            int len = lbase[symbol] + bits(lext[symbol]);
+            symbol = decode(distcode);
+            if (symbol < 0 || symbol >= 30)
+                return false;
+            uint32_t dist = dbase[symbol] + bits(dext[symbol]);
+            if (dist > filled)
+                return false;
+            while (len-- > 0)
+                put(window[(wpos + INFLATE_WINDOW - dist) % INFLATE_WINDOW]);
+        }
+        return false;
+    }
+
+    bool fixed()
+    {
+        static THuffman lencode;
+        static THuffman distcode;
+        static bool built = false;
+        if (!built)
+        {
+            short length[288];
+            int symbol;
+            for (symbol = 0; symbol < 144; symbol++)
+                length[symbol] = 8;
+            for (; symbol < 256; symbol++)
+                length[symbol] = 9;
+            for (; symbol < 280; symbol++)
+                length[symbol] = 7;
+            for (; symbol < 288; symbol++)
+                length[symbol] = 8;
+            build(lencode, length, 288);
+            for (symbol = 0; symbol < 30; symbol++)
+                length[symbol] = 5;
+            build(distcode, length, 30);
+            built = true;
+        }
+        return codes(lencode, distcode);
+    }
+
+    bool dynamic()
+    {
+        static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+        short length[320];
+        THuffman lencode;
+        THuffman distcode;
+
+        int nlen = bits(5) + 257;
+        int ndist = bits(5) + 1;
+        int ncode = bits(4) + 4;
+        if (nlen > 286 || ndist > 30)
+            return false;
+
+        int index;
+        for (index = 0; index < 19; index++)
+            length[order[index]] = (short)(index < ncode ? bits(3) : 0);
+        if (!build(lencode, length, 19))
+            return false;
+
+        index = 0;
+        while (index < nlen + ndist)
+        {
+            int symbol = decode(lencode);
+            if (symbol < 0 || truncated)
+                return false;
+            if (symbol < 16)
+            {
+                length[index++] = (short)symbol;
+                continue;
+            }
+
+            short value = 0;
+            int repeat;
+            if (symbol == 16)
+            {
+                if (index == 0)
+                    return false;
+                value = length[index - 1];
+                repeat = 3 + bits(2);
+            }
+            else if (symbol == 17)
+                repeat = 3 + bits(3);
+            else
+                repeat = 11 + bits(7);
+            if (index + repeat > nlen + ndist)
+                return false;
+            while (repeat-- > 0)
+                length[index++] = value;
+        }
+        if (length[256] == 0)
+            return false;   // No end of block code
+
+        if (!build(lencode, length, nlen) || !build(distcode, length + nlen, ndist))
+            return false;
+        return codes(lencode, distcode);
+    }
+
+    TReader& in;
+    TByteSink& sink;
+    uint32_t bitbuf;
+    int bitcnt;
+    bool truncated;
+    uint8_t window[INFLATE_WINDOW];
+    uint32_t wpos;                  // Next write position in the window
+    uint32_t filled;                // Bytes of history in the window
+};
+
+/*********************************************************
+        sigrok session files
+*********************************************************/
+// A .sr file is a ZIP archive: an INI style "metadata" member describing
+// the probes and sample rate, and the samples in "logic-1-1", "logic-1-2",
+// ... with unitsize bytes per sample, probe n in bit n-1 (little-endian).
+typedef struct TZipEntry
+{
+    std::string name;
+    int method;                     // 0 stored, 8 deflated
+    uint32_t size;                  // Compressed size
+    uint32_t offset;                // Local header offset
+    int chunk;                      // Number after the capture file name
+} TZipEntry;
+
+static uint32_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t get32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static bool zip_directory(TReader& in, std::vector<TZipEntry>& entries)
+{
+    FILE *file = in.handle();
+    if (fseek(file, 0, SEEK_END) != 0)
+        return false;
+    long size = ftell(file);
+    long tail = size < 65557 ? size : 65557;    // End record plus the longest comment
+    std::vector<uint8_t> buf(tail);
+    if (tail < 22 || fseek(file, size - tail, SEEK_SET) != 0 || fread(&buf[0], 1, tail, file) != (size_t)tail)
+        return false;
+
+    long end = tail - 22;
+    while (end >= 0 && get32(&buf[end]) != 0x06054B50UL)
+        end--;
+    if (end < 0)
+        return false;
+    uint32_t count = get16(&buf[end + 10]);
+    uint32_t dir_size = get32(&buf[end + 12]);
+    uint32_t dir_offset = get32(&buf[end + 16]);
+
+    std::vector<uint8_t> dir(dir_size + 1);
+    if (fseek(file, (long)dir_offset, SEEK_SET) != 0 || fread(&dir[0], 1, dir_size, file) != dir_size)
+        return false;
+
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (pos + 46 > dir_size || get32(&dir[pos]) != 0x02014B50UL)
+            return false;
+        uint32_t name_len = get16(&dir[pos + 28]);
+        if (pos + 46 + name_len > dir_size)
+            return false;
+
+        TZipEntry entry;
+        entry.method = (int)get16(&dir[pos + 10]);
+        entry.size = get32(&dir[pos + 20]);
+        entry.offset = get32(&dir[pos + 42]);
+        entry.name.assign((const char *)&dir[pos + 46], name_len);
+        entry.chunk = 0;
+        entries.push_back(entry);
+        pos += 46 + name_len + get16(&dir[pos + 30]) + get16(&dir[pos + 32]);
+    }
+    return true;
+}
+
+// Feed a member's uncompressed bytes to a sink
+static bool zip_extract(TReader& in, const TZipEntry& entry, TByteSink& sink)
+{
+    uint8_t local[30];
+    if (!in.seek((long)entry.offset, sizeof(local)) || in.read(local, sizeof(local)) != sizeof(local) ||
+        get32(local) != 0x04034B50UL)
+    {
+        return false;
+    }
+    long data = (long)entry.offset + 30 + get16(local + 26) + get16(local + 28);
+    if (!in.seek(data, entry.size))
+        return false;
+
+    if (entry.method == 0)
+    {
+        uint8_t buf[IMPORT_READ_BUFFER];
+        size_t n;
+        while ((n = in.read(buf, sizeof(buf))) > 0)
+            sink.bytes(buf, n);
+        return true;
+    }
+    if (entry.method == 8)
+    {
+        TInflate inflate(in, sink);
+        return inflate.run();
+    }
+    return false;
+}
+
+class TStringSink : public TByteSink
+{
+public:
+    void bytes(const uint8_t *data, size_t size)
+    {
+        if (text.size() + size <= SIGROK_METADATA_MAX)
+            text.append((const char *)data, size);
+    }
+    std::string text;
+};
+
+// Samples of the logic members, one builder change per probe that toggled
+class TLogicSink : public TByteSink
+{
+public:
+    TLogicSink(TSampleBuilder& out, const std::vector<int>& ids, int unitsize, double period_ps)
+        : out(out), ids(ids), unitsize(unitsize), period_ps(period_ps), sample(0), have(0),
+          current(unitsize), last(unitsize) {}
+
+    void bytes(const uint8_t *data, size_t size)
+    {
+        for (size_t i = 0; i < size && !out.full(); i++)
+        {
+            current[have++] = data[i];
+            if (have < unitsize)
+                continue;
+            have = 0;
+
+            bool first = sample == 0;
+            if (first || memcmp(&current[0], &last[0], unitsize) != 0)
+            {
+                out.set_time((int64_t)(sample * period_ps));
+                for (int byte = 0; byte < unitsize; byte++)
+                {
+                    int toggled = first ? 0xFF : current[byte] ^ last[byte];
+                    for (int bit = 0; toggled != 0; bit++, toggled >>= 1)
+                    {
+                        size_t probe = byte * 8 + bit;
+                        if ((toggled & 1) && probe < ids.size())
+                            out.change(ids[probe], (current[byte] >> bit) & 1);
+                    }
+                }
+                last.swap(current);
+            }
+            sample++;
+        }
+    }
+
+private:
+    TSampleBuilder& out;
+    const std::vector<int>& ids;
+    int unitsize;
+    double period_ps;
+    double sample;                  // Samples seen, exact up to 2^53
+    int have;                       // Bytes of the sample in current
+    std::vector<uint8_t> current;
+    std::vector<uint8_t> last;      // Last sample that differed
+};
+
+static bool chunk_before(const TZipEntry& a, const TZipEntry& b)
+{
+    return a.chunk < b.chunk;
+}
+
+// Value of "key=value" in the [device 1] section, empty if missing
+static std::string ini_value(const std::string& text, const char *key)
+{
+    bool device = false;
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string line = text.substr(pos, end - pos);
+        pos = end + 1;
+        while (!line.empty() && (line[line.size() - 1] == '\r' || line[line.size() - 1] == ' '))
+            line.erase(line.size() - 1);
+
+        if (!line.empty() && line[0] == '[')
+        {
+            device = line == "[device 1]";
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (device && eq != std::string::npos && line.substr(0, eq) == key)
+            return line.substr(eq + 1);
+    }
+    return "";
+}
+
+static double sigrok_rate(const std::string& text)
+{
+    double rate = atof(text.c_str());
+    if (text.find("GHz") != std::string::npos)
+        rate *= 1e9;
+    else if (text.find("MHz") != std::string::npos)
+        rate *= 1e6;
+    else if (text.find("kHz") != std::string::npos)
+        rate *= 1e3;
+    return rate;
+}
+
+static bool read_sigrok(const char *path, TSampleBuilder& out, char *error, size_t error_size)
+{
+    TReader in;
+    std::vector<TZipEntry> entries;
+    if (!in.open(path) || !zip_directory(in, entries))
+    {
+        snprintf(error, error_size, "%s: not a sigrok session file", path);
+        return false;
+    }
+
+    TStringSink metadata;
+    size_t i;
+    for (i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].name == "metadata")
+            break;
+    }
+    if (i == entries.size() || !zip_extract(in, entries[i], metadata))
+    {
+        snprintf(error, error_size, "%s: no metadata", path);
+        return false;
+    }
+
+    std::string capturefile = ini_value(metadata.text, "capturefile");
+    int unitsize = atoi(ini_value(metadata.text, "unitsize").c_str());
+    int probes = atoi(ini_value(metadata.text, "total probes").c_str());
+    double rate = sigrok_rate(ini_value(metadata.text, "samplerate"));
+    if (capturefile.empty() || unitsize < 1 || probes < 1 || probes > unitsize * 8 || rate <= 0)
+    {
+        snprintf(error, error_size, "%s: unsupported logic data", path);
+        return false;
+    }
+
+    std::vector<int> ids;
+    for (int probe = 1; probe <= probes; probe++)
+    {
+        char key[32];
+        snprintf(key, sizeof(key), "probe%d", probe);
+        std::string name = ini_value(metadata.text, key);
+        ids.push_back(out.add_signal(name.c_str(), 1, -1, -1));
+    }
+
+    // The samples are split over numbered members, older files use one
+    std::vector<TZipEntry> chunks;
+    for (i = 0; i < entries.size(); i++)
+    {
+        const std::string& name = entries[i].name;
+        if (name == capturefile)
+        {
+            chunks.push_back(entries[i]);
+        }
+        else if (name.size() > capturefile.size() + 1 && name.compare(0, capturefile.size(), capturefile) == 0 &&
+                 name[capturefile.size()] == '-')
+        {
+            chunks.push_back(entries[i]);
+            chunks.back().chunk = atoi(name.c_str() + capturefile.size() + 1);
+        }
+    }
+    std::sort(chunks.begin(), chunks.end(), chunk_before);
+
+    TLogicSink logic(out, ids, unitsize, 1e12 / rate);
+    for (i = 0; i < chunks.size() && !out.full(); i++)
+    {
+        if (!zip_extract(in, chunks[i], logic))
+        {
+            snprintf(error, error_size, "%s: corrupt member %s", path, chunks[i].name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/*********************************************************
+        Import
+*********************************************************/
+static bool has_extension(const char *path, const char *ext)
+{
+    size_t len = strlen(path);
+    size_t ext_len = strlen(ext);
+    if (len < ext_len)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < ext_len; i++)
+    {
+        if (tolower((unsigned char)path[len - ext_len + i]) != ext[i])
+            return false;
+    }
+    return true;
+}
+
+bool IsTraceFile(const char *path)
+{
+    return has_extension(path, ".vcd") || has_extension(path, ".sr");
+}
+
+static bool read_trace(const char *path, TSampleBuilder& out, char *error, size_t error_size)
+{
+    if (has_extension(path, ".sr"))
+        return read_sigrok(path, out, error, error_size);
+    return read_vcd(path, out, error, error_size);
+}
+
+bool ImportTrace(const char *trace, const char *capture, const TTraceLayout *layout,
+                 const char *const *renames, int rename_count, char *error, size_t error_size)
+{
+    TSampleBuilder builder(layout, renames, rename_count);
+
+    // Count the samples first, so the capture can be laid out in one go
+    builder.begin(NULL);
+    if (!read_trace(trace, builder, error, error_size))
+    {
+        return false;
+    }
+    builder.finish();
+    if (builder.mapped_signals() == 0)
+    {
+        snprintf(error, error_size, "%s: no signal matches the %s layout", trace, layout->name);
+        return false;
+    }
+    if (builder.full())
+    {
+        snprintf(error, error_size, "%s: too many samples for one capture", trace);
+        return false;
+    }
+
+    TCaptureGroup groups[CAPFILE_MAX_GROUPS];
+    memset(groups, 0, sizeof(groups));
+    for (int g = 0; g < layout->group_count; g++)
+    {
+        strncpy(groups[g].name, layout->groups[g].name, CAPFILE_NAME_LEN);
+        groups[g].width = layout->groups[g].width;
+    }
+
+    TCaptureFile file;
+    int samples = builder.samples();
+    if (!file.create(capture, 0, samples - 1, groups, layout->group_count, true))
+    {
+        snprintf(error, error_size, "%s: %s", capture, file.error());
+        return false;
+    }
+
+    builder.begin(&file);
+    if (!read_trace(trace, builder, error, error_size))
+    {
+        return false;
+    }
+    builder.finish();
+    if (builder.samples() != samples)
+    {
+        snprintf(error, error_size, "%s: changed while it was imported", trace);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,488 @@
+// Replay.cpp - Stand-in TLA host that replays capture files through a decoder
+//
+// Usage: Replay <decoder> <capture> [SETTING=Option ...] [-q] [-tla file]
+//               [-layout NAME] [-map TRACE=SIGNAL ...] [-o capture]
+//
+// Loads a support package DLL (or shared object), maps the capture file and
+// serves it to the decoder through the same lafunc table the TLA application
+// passes to ParseReinit. Every decoded row is printed as "seq<TAB>text";
+// -q only reports the throughput. -tla passes the package's .tla file the
+// way the application does, so a capture taken with changed probe wiring
+// decodes as it would on the TLA.
+//
+// A .vcd or .sr (sigrok) trace in place of the capture is imported first,
+// onto the package layout picked by -layout or by the decoder's groups;
+// -o keeps the converted capture.
+#include "Replay.h"
+#include "capfile.h"
+#include "import.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+/*********************************************************
+        Globals
+*********************************************************/
+struct lactx
+{
+    TCaptureFile *capture;
+};
+
+static TCaptureFile Capture;
+static struct lactx HostContext = { &Capture };
+static int GroupColumn[REPLAY_MAX_GROUPS];      // Decoder group -> capture column, -1 if absent
+static int GroupCount = 0;
+static bool GroupMissed[REPLAY_MAX_GROUPS];     // Decoder read a group the capture lacks
+
+/*********************************************************
+        Host functions
+*********************************************************/
+static int LAGroupValue(struct lactx *lactx, int seqno, int group)
+{
+    if (group < 0 || group >= GroupCount)
+    {
+        return 0;
+    }
+    if (GroupColumn[group] < 0)
+    {
+        GroupMissed[group] = true;
+        return 0;
+    }
+    return (int)lactx->capture->value(seqno, GroupColumn[group]);
+}
+
+static int LAInfo(struct lactx *lactx, enum TLA_INFO info, int16_t bus)
+{
+    switch (info)
+    {
+        case TLA_INFO_FIRST_SEQUENCE:
+            return lactx->capture->first_seq();
+        case TLA_INFO_LAST_SEQUENCE:
+            return lactx->capture->last_seq();
+        default:
+            return 0;
+    }
+}
+
+static int LABusModTrigSample(struct lactx *lactx, int16_t bus)
+{
+    // Without a trigger the decoders start at the first sequence
+    return lactx->capture->has_trigger() ? lactx->capture->trigger_seq() : lactx->capture->first_seq();
+}
+
+static int LAProgAbort(struct lactx *lactx)
+{
+    return 0;
+}
+
+static void LAError(struct lactx *lactx, int level, char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "decoder error %d: ", level);
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+}
+
+static void *rda_malloc(int size)
+{
+    return malloc(size);
+}
+
+static void *rda_calloc(int members, int size)
+{
+    return calloc(members, size);
+}
+
+static void *rda_realloc(void *p, int size)
+{
+    return realloc(p, size);
+}
+
+static void rda_free(void *p)
+{
+    free(p);
+}
+
+/*********************************************************
+        Platform helpers
+*********************************************************/
+static void *load_decoder(const char *path, TDecoder& decoder)
+{
+#ifdef _WIN32
+    HMODULE module = LoadLibrary(path);
+#define DECODER_SYMBOL(name) GetProcAddress(module, name)
+#else
+    void *module = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+#define DECODER_SYMBOL(name) dlsym(module, name)
+#endif
+    if (module == NULL)
+    {
+        return NULL;
+    }
+
+    decoder.ParseReinit = (TParseReinit)DECODER_SYMBOL("ParseReinit");
+    decoder.ParseFinish = (TParseFinish)DECODER_SYMBOL("ParseFinish");
+    decoder.ParseInfo = (TParseInfo)DECODER_SYMBOL("ParseInfo");
+    decoder.ParseModeGetPut = (TParseModeGetPut)DECODER_SYMBOL("ParseModeGetPut");
+    decoder.ParseSeq = (TParseSeq)DECODER_SYMBOL("ParseSeq");
+    decoder.ParseModeInfo = (TParseModeInfo)DECODER_SYMBOL("ParseModeInfo");
+    decoder.ParseGroupInfo = (TParseGroupInfo)DECODER_SYMBOL("ParseGroupInfo");
+#undef DECODER_SYMBOL
+
+    if (decoder.ParseReinit == NULL || decoder.ParseFinish == NULL || decoder.ParseInfo == NULL ||
+        decoder.ParseModeGetPut == NULL || decoder.ParseSeq == NULL || decoder.ParseModeInfo == NULL ||
+        decoder.ParseGroupInfo == NULL)
+    {
+        return NULL;
+    }
+    return (void *)module;
+}
+
+static double now_seconds()
+{
+#ifdef _WIN32
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+static void sleep_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+/*********************************************************
+        Replay
+*********************************************************/
+// Apply a "SETTING=Option" argument, matched against the decoder's mode
+// names and option strings. The option may also be given by index.
+static bool apply_setting(TDecoder& decoder, struct pctx *pctx, const char *arg)
+{
+    const char *eq = strchr(arg, '=');
+    if (eq == NULL)
+    {
+        return false;
+    }
+
+    int modes = decoder.ParseInfo(pctx, MODEINFO_MAX_MODE);
+    for (int mode = 0; mode < modes; mode++)
+    {
+        struct modeinfo *info = decoder.ParseModeInfo(pctx, (uint16_t)mode);
+        if (info == NULL || strlen(info->name) != (size_t)(eq - arg) || strncmp(info->name, arg, eq - arg) != 0)
+        {
+            continue;
+        }
+
+        for (int option = 0; info->options[option] != NULL; option++)
+        {
+            if (strcmp(info->options[option], eq + 1) == 0 ||
+                (eq[1] >= '0' && eq[1] <= '9' && atoi(eq + 1) == option))
+            {
+                decoder.ParseModeGetPut(pctx, mode, option, 1);
+                return true;
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+// Bind each decoder group to the capture column of the same name
+static void map_groups(TDecoder& decoder, struct pctx *pctx)
+{
+    GroupCount = decoder.ParseInfo(pctx, MODEINFO_MAX_GROUP);
+    if (GroupCount > REPLAY_MAX_GROUPS)
+        GroupCount = REPLAY_MAX_GROUPS;
+
+    for (int group = 0; group < GroupCount; group++)
+    {
+        struct groupinfo *info = decoder.ParseGroupInfo(pctx, (uint16_t)group);
+        GroupColumn[group] = (info != NULL) ? Capture.find_group(info->name) : -1;
+        GroupMissed[group] = false;
+    }
+}
+
+// Import a trace into a capture file, a temporary one unless -o named it
+static bool import_trace(TDecoder& decoder, struct pctx *pctx, const char *trace, const char *layout_name,
+                         const char *const *renames, int rename_count, char *capture, size_t capture_size)
+{
+    const TTraceLayout *layout;
+    if (layout_name != NULL)
+    {
+        layout = FindLayout(layout_name);
+    }
+    else
+    {
+        const char *names[REPLAY_MAX_GROUPS];
+        int count = decoder.ParseInfo(pctx, MODEINFO_MAX_GROUP);
+        if (count > REPLAY_MAX_GROUPS)
+            count = REPLAY_MAX_GROUPS;
+        for (int group = 0; group < count; group++)
+        {
+            struct groupinfo *info = decoder.ParseGroupInfo(pctx, (uint16_t)group);
+            names[group] = (info != NULL) ? info->name : "";
+        }
+        layout = MatchLayout(names, count);
+    }
+    if (layout == NULL && layout_name != NULL)
+    {
+        fprintf(stderr, "unknown layout %s, use ISA, ISA_Minimal or PCI\n", layout_name);
+        return false;
+    }
+    if (layout == NULL)
+    {
+        fprintf(stderr, "%s: no signal layout for this decoder, use -layout ISA, ISA_Minimal or PCI\n", trace);
+        return false;
+    }
+
+    if (capture[0] == '\0')
+    {
+#ifdef _WIN32
+        char dir[MAX_PATH];
+        if (capture_size < MAX_PATH || GetTempPath(sizeof(dir), dir) == 0 ||
+            GetTempFileName(dir, "tlc", 0, capture) == 0)
+#else
+        const char *dir = getenv("TMPDIR");
+        snprintf(capture, capture_size, "%s/replay-XXXXXX", dir != NULL ? dir : "/tmp");
+        int fd = mkstemp(capture);
+        if (fd >= 0)
+            close(fd);
+        if (fd < 0)
+#endif
+        {
+            fprintf(stderr, "cannot create a temporary capture file\n");
+            capture[0] = '\0';
+            return false;
+        }
+    }
+
+    char error[IMPORT_ERROR_LEN];
+    if (!ImportTrace(trace, capture, layout, renames, rename_count, error, sizeof(error)))
+    {
+        fprintf(stderr, "%s\n", error);
+        return false;
+    }
+    return true;
+}
+
+// Split a support file path into the folder, separator, name and extension
+// fields of lafunc
+static void split_support_path(const char *path, struct lafunc& func, char *dir, char *name, char *ext)
+{
+    const char *base = path;
+    const char *p;
+    for (p = path; *p != '\0'; p++)
+    {
+        if (*p == '/' || *p == '\\')
+            base = p + 1;
+    }
+    size_t dir_len = base > path ? (size_t)(base - path - 1) : 0;
+    memcpy(dir, path, dir_len);
+    dir[dir_len] = '\0';
+    strcpy(name, base);
+    char *dot = strrchr(name, '.');
+    strcpy(ext, dot != NULL ? dot : "");
+    if (dot != NULL)
+        *dot = '\0';
+
+    func.support_path = dir;
+    func.support_sep = (char *)(base > path ? (base[-1] == '\\' ? "\\" : "/") : "");
+    func.support_name = name;
+    func.support_ext = ext;
+}
+
+static bool is_placeholder(const struct sequence *row, const char *text)
+{
+    return row->textp != NULL && strcmp(row->textp, text) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool quiet = false;
+    const char *paths[2] = { NULL, NULL };
+    int npaths = 0;
+    const char *layout = NULL;
+    const char *output = NULL;
+    const char *tla = NULL;
+    const char *renames[IMPORT_MAX_RENAMES];
+    int rename_count = 0;
+    const char *settings[REPLAY_MAX_SETTINGS];
+    int setting_count = 0;
+    bool usage = false;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        bool value = arg + 1 < argc;
+        if (strcmp(argv[arg], "-q") == 0)
+            quiet = true;
+        else if (strcmp(argv[arg], "-layout") == 0 && value)
+            layout = argv[++arg];
+        else if (strcmp(argv[arg], "-o") == 0 && value)
+            output = argv[++arg];
+        else if (strcmp(argv[arg], "-tla") == 0 && value)
+            tla = argv[++arg];
+        else if (strcmp(argv[arg], "-map") == 0 && value && rename_count < IMPORT_MAX_RENAMES)
+            renames[rename_count++] = argv[++arg];
+        else if (argv[arg][0] == '-')
+            usage = true;
+        else if (strchr(argv[arg], '=') != NULL && setting_count < REPLAY_MAX_SETTINGS)
+            settings[setting_count++] = argv[arg];
+        else if (strchr(argv[arg], '=') == NULL && npaths < 2)
+            paths[npaths++] = argv[arg];
+        else
+            usage = true;
+    }
+    if (npaths != 2 || usage)
+    {
+        fprintf(stderr, "usage: %s <decoder> <capture> [SETTING=Option ...] [-q] [-tla file]\n"
+                        "       [-layout NAME] [-map TRACE=SIGNAL ...] [-o capture]\n", argv[0]);
+        return 2;
+    }
+
+    TDecoder decoder;
+    if (load_decoder(paths[0], decoder) == NULL)
+    {
+        fprintf(stderr, "%s: not a support package decoder\n", paths[0]);
+        return 1;
+    }
+    struct lafunc func;
+    memset(&func, 0, sizeof(func));
+    func.rda_malloc = rda_malloc;
+    func.rda_calloc = rda_calloc;
+    func.rda_realloc = rda_realloc;
+    func.rda_free = rda_free;
+    func.LAInfo = LAInfo;
+    func.LAError = LAError;
+    func.LAGroupValue = LAGroupValue;
+    func.LAProgAbort = LAProgAbort;
+    func.LABusModTrigSample = LABusModTrigSample;
+    char tla_dir[REPLAY_PATH_LEN];
+    char tla_name[REPLAY_PATH_LEN];
+    char tla_ext[REPLAY_PATH_LEN];
+    if (tla != NULL && strlen(tla) < REPLAY_PATH_LEN)
+        split_support_path(tla, func, tla_dir, tla_name, tla_ext);
+
+    struct pctx *pctx = decoder.ParseReinit(NULL, &HostContext, &func);
+    if (pctx == NULL)
+    {
+        fprintf(stderr, "%s: ParseReinit failed\n", paths[0]);
+        return 1;
+    }
+
+    // A trace is converted before the capture is mapped; the temporary
+    // capture goes away again at the end
+    char capture[REPLAY_PATH_LEN];
+    const char *capture_path = paths[1];
+    bool temporary = false;
+    if (IsTraceFile(paths[1]))
+    {
+        snprintf(capture, sizeof(capture), "%s", output != NULL ? output : "");
+        temporary = output == NULL;
+        if (!import_trace(decoder, pctx, paths[1], layout, renames, rename_count, capture, sizeof(capture)))
+        {
+            if (temporary && capture[0] != '\0')
+                remove(capture);
+            decoder.ParseFinish(pctx);
+            return 1;
+        }
+        capture_path = capture;
+    }
+    if (!Capture.open(capture_path))
+    {
+        fprintf(stderr, "%s: %s\n", capture_path, Capture.error());
+        decoder.ParseFinish(pctx);
+        return 1;
+    }
+    if (temporary)
+    {
+#ifdef _WIN32
+        // Windows keeps a mapped file; it is removed after the run below
+#else
+        remove(capture_path);       // The mapping keeps the data
+        temporary = false;
+#endif
+    }
+    map_groups(decoder, pctx);
+
+    for (int setting = 0; setting < setting_count; setting++)
+    {
+        if (!apply_setting(decoder, pctx, settings[setting]))
+        {
+            fprintf(stderr, "unknown setting: %s\n", settings[setting]);
+            decoder.ParseFinish(pctx);
+            Capture.close();
+            if (temporary)
+                remove(capture_path);
+            return 2;
+        }
+    }
+
+    // Walk the capture the way the listing window does. The decode runs in
+    // the background; its placeholder row means "ask again later".
+    double start = now_seconds();
+    int rows = 0;
+    bool aborted = false;
+    int seq = Capture.first_seq();
+    while (seq <= Capture.last_seq())
+    {
+        struct sequence *row = decoder.ParseSeq(pctx, seq);
+        if (row != NULL && is_placeholder(row, REPLAY_PENDING_TEXT))
+        {
+            sleep_ms(1);
+            continue;
+        }
+        if (row != NULL && is_placeholder(row, REPLAY_ABORTED_TEXT))
+        {
+            aborted = true;
+            break;
+        }
+
+        for (; row != NULL; row = row->next)
+        {
+            rows++;
+            if (!quiet)
+                printf("%d\t%s\n", seq, row->textp);
+        }
+        seq++;
+    }
+    double elapsed = now_seconds() - start;
+
+    for (int group = 0; group < GroupCount; group++)
+    {
+        if (GroupMissed[group])
+        {
+            struct groupinfo *info = decoder.ParseGroupInfo(pctx, (uint16_t)group);
+            fprintf(stderr, "warning: capture has no group %s, it read as 0\n", info->name);
+        }
+    }
+    decoder.ParseFinish(pctx);
+    int samples = Capture.samples();
+    Capture.close();
+    if (temporary)
+        remove(capture_path);
+
+    fprintf(stderr, "%d samples, %d rows in %.3f s", samples, rows, elapsed);
+    if (elapsed > 0)
+        fprintf(stderr, " (%.1f Msamples/s)", samples / elapsed / 1000000.0);
+    fprintf(stderr, "%s\n", aborted ? ", decode aborted" : "");
+    return aborted ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+// Replay.h - Stand-in TLA host for replaying capture files
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "stdint.h"
+
+/*********************************************************
+        Defines
+*********************************************************/
+#define REPLAY_MAX_GROUPS   32      // Decoder groups the host can serve
+#define REPLAY_MAX_SETTINGS 32      // SETTING=Option arguments accepted
+#define REPLAY_PATH_LEN     1024
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+
+// Placeholder rows ParseSeq returns while the background decode runs
+#define REPLAY_PENDING_TEXT "Decoding..."
+#define REPLAY_ABORTED_TEXT "Decode aborted"
+
+/*********************************************************
+        TLA Types
+*********************************************************/
+
+enum TLA_INFO {
+        TLA_INFO_FIRST_SEQUENCE,
+        TLA_INFO_LAST_SEQUENCE,
+        TLA_INFO_DISPLAY_ATTRIBUTE,
+        TLA_INFO_3,
+        TLA_INFO_MNEMONICS_WIDTH=5
+};
+
+struct lactx;
+struct businfo {
+        int val0;
+        int val4;
+        int val8;
+        int valc;
+        int val10;
+        int val14;
+        void *val18;
+        int val1c;
+};
+
+struct modeinfo {
+        const char *name;
+        const char **options;
+        int val1;
+        int val2;
+};
+
+struct sequence {
+        struct sequence *next;
+        char *textp;
+        uint8_t flags;  // The flags determine the background
+                        // bit 0= white (blank), bit 1=grey, bit 2=red, bit3=yellow
+        char field_9;
+        char field_A;
+        char field_B;
+        char *text2;
+        int field_10;
+        int field_14;
+        int field_18;
+        int field_1C;
+        char text[128];
+        char text2_buf[8];
+};
+
+struct groupinfo {
+        char *name;
+        char field_4;
+        char field_5;
+        char field_6;
+        char field_7;
+        uint16_t members;
+        uint16_t len;
+};
+
+enum MODEINFO {
+        MODEINFO_MAX_BUS=0,
+        MODEINFO_MAX_GROUP=1,
+        MODEINFO_MAX_MODE=2,
+        MODEINFO_3=3,
+        MODEINFO_GETNAME=4,
+        MODEINFO_MAX,
+};
+
+struct lafunc {
+        int unknown;                               /* 0  */
+        char *support_path;                        /* 4  */
+        char *support_sep;                         /* 8  */
+        char *support_name;                        /* C  */
+        char *support_name2;                       /* 10 */
+        char *support_ext;                         /* 14 */
+        void *(*rda_malloc)(int size);             /* 18 */
+        void *(*rda_calloc)(int members, int size);/* 1C */
+        void *(*rda_realloc)(void *p, int size);   /* 20 */
+        void (*rda_free)(void *p);                 /* 24 */
+        void (*LABus)(void);                       /* 28 */
+        int  (*LAInfo)(struct lactx *, enum TLA_INFO, int16_t bus);       /* 2C */
+        void (*LAError)(struct lactx *, int, char *, ...);                /* 30 */
+        void (*LAFindSeq)(void);                   /* 34 */
+        void (*LAFormatValue)(void);               /* 38 */
+        void (*LAGap)(void);                       /* 3c */
+        int (*LAGroupValue)(struct lactx *lactx, int seqno, int group);   /* 40 */
+        void (*LAInvalidate)(void);                /* 44 */
+        void (*LASeqToText)(void);                 /* 48 */
+        void (*LAGroupWidth_)(void);               /* 4c */
+        void (*LATimeStamp_ps_)(void);             /* 50 */
+        void (*LASysTrigTime_ps_)(void);           /* 54 */
+        void (*LABusModTrigTime_ps_)(void);        /* 58 */
+        void (*LABusModTimeOffset_ps_)(void);      /* 5c */
+        void (*LAGroupInvalidBitMask_)(void);      /* 60 */
+        void (*LAContigLongToSeq_)(void);          /* 64 */
+        void (*LALongToSeq_)(void);                /* 68 */
+        void (*LALongToValidSeq_)(void);           /* 6c */
+        void (*LASeqToContigLong_)(void);          /* 70 */
+        void (*LASeqToLong_)(void);                /* 74 */
+        void (*LASubDisasmLoad)(void);             /* 78 */
+        void (*LASubDisasmUnload)(void);           /* 7c */
+        void (*LASubDisasmFuncTablePtr_)(void);    /* 80 */
+        void (*LAWhichBusMod_)(void);              /* 84 */
+        void (*LASeqDisplayFormat_)(void);         /* 88 */
+        void (*LAInteractiveUI2_)(void);           /* 8c */
+        int  (*LAProgAbort)(struct lactx *);       /* 90 */
+        void (*LATimestamp_ps_ToText)(void);       /* 94 */
+        void (*LATimeStampDisplayFormat)(void);    /* 98 */
+        void (*LAReferenceTime_ps_)(void);         /* 9c */
+        void (*LABusModSysTrigTime_ps_)(void);     /* a0 */
+        void (*LABusModFrameOffset_ps_)(void);     /* a4 */
+        void (*LABusModTimeToUserAlignedTime_ps_)(void); /* a8 */
+        int  (*LABusModTrigSample)(struct lactx *, int16_t bus); /* ac */
+        void (*LABusModWallClockStart_)(void);     /* b0 */
+        void *field_B4;                            /* b4 */
+        void (*LAReferenceTime_ps_2)(void);        /* b8 */
+        void (*LASampleStatusBits)(void);          /* bc */
+        void (*LASampleStatusBitsType_)(void);
+        void (*LAGroupViolationBitMask_)(void);
+        void (*LAGroupViolationBitMaskType_)(void);
+        void (*LABusModVariantName_)(void);
+        void (*LASystemName_)(void);
+        void (*LASystemPath_)(void);
+        void *field_DC;
+};
+
+/*********************************************************
+        Decoder entry points
+*********************************************************/
+// Resolved from the decoder module at run time, so one host serves the
+// ISA, ISA_Minimal and PCI packages unchanged
+struct pctx;
+typedef struct pctx *(*TParseReinit)(struct pctx *pctx, struct lactx *lactx, struct lafunc *func);
+typedef int (*TParseFinish)(struct pctx *pctx);
+typedef int (*TParseInfo)(struct pctx *pctx, unsigned int request);
+typedef int (*TParseModeGetPut)(struct pctx *pctx, int mode, int value, int request);
+typedef struct sequence *(*TParseSeq)(struct pctx *pctx, int seq);
+typedef struct modeinfo *(*TParseModeInfo)(struct pctx *pctx, uint16_t mode);
+typedef struct groupinfo *(*TParseGroupInfo)(struct pctx *pctx, uint16_t group);
+
+typedef struct TDecoder
+{
+    TParseReinit ParseReinit;
+    TParseFinish ParseFinish;
+    TParseInfo ParseInfo;
+    TParseModeGetPut ParseModeGetPut;
+    TParseSeq ParseSeq;
+    TParseModeInfo ParseModeInfo;
+    TParseGroupInfo ParseGroupInfo;
+} TDecoder;
+
+#endif // REPLAY_H
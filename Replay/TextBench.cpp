@@ -0,0 +1,365 @@
+// TextBench.cpp - Row text writer against snprintf, for equivalence and speed
+//
+// Usage: TextBench [rows]
+//
+// The packages write their listing rows with TTextOut (ISA/textout.h)
+// instead of snprintf. This check builds the ISA and PCI transaction rows
+// both ways from random field values, with every buffer size from 1 to
+// TEXTBENCH_MAX_TEXT so truncation is covered too, and prints the rows
+// that differ. It then times both on full-size buffers. The exit code is 1
+// if any row differed.
+//
+// The rows follow the layouts in ISA.cpp (RenderRow) and PCI.cpp
+// (format_transaction); change them here when a layout changes there.
+#include "stdint.h"
+#include "../ISA/textout.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#define TEXTBENCH_MAX_TEXT  128         // Row text size, as in struct sequence
+#define TEXTBENCH_ROWS      1000000     // Rows checked and timed by default
+#define TEXTBENCH_FIELDS    1024        // Random field sets the timing cycles through
+
+/*********************************************************
+        Row fields
+*********************************************************/
+static const char *isa_names[] = {
+    "I/O Read (8-bit)", "I/O Write (16-bit)", "Memory Read (8-bit)", "Memory Write (16-bit)"
+};
+
+static const char *pci_names[] = {
+    "Memory Read", "Memory Write", "Configuration Read", "Memory Read Multiple"
+};
+
+static const char *pci_bursts[] = { "Linear", "Cacheline Wrap" };
+
+struct TISAFields
+{
+    int name;
+    int addr_width;             // 0 = 16-bit, 1 = 20-bit, 2 = 24-bit
+    int is_16bit;
+    uint32_t address;
+    uint16_t data;
+    int wait_states;
+};
+
+struct TPCIFields
+{
+    int name;
+    int is_64bit;
+    uint64_t address;
+    int has_target;
+    int target_bdf;
+    int target_bar;
+    int data_phases;
+    int is_64bit_data;
+    uint32_t data;
+    uint32_t data_hi;
+    int byte_enables;
+    int config;                 // 0 = none, 1 = Type 0, 2 = Type 1
+    int bus;
+    int device;                 // Type 0: -1 when no IDSEL line was found
+    int function;
+    int reg;
+    int burst;
+    int parity;                 // 0 = none, 1 = PAR! in a data phase, 2 = PERR# only
+    int parity_phase;
+    int perr;
+};
+
+static uint32_t random32()
+{
+    return ((uint32_t)rand() << 30) ^ ((uint32_t)rand() << 15) ^ (uint32_t)rand();
+}
+
+static void random_isa(TISAFields& f)
+{
+    f.name = rand() % 4;
+    f.addr_width = rand() % 3;
+    f.is_16bit = f.name & 1;
+    f.address = random32();
+    f.data = (uint16_t)random32();
+    f.wait_states = (int)(random32() % 200000) - 100;
+}
+
+static void random_pci(TPCIFields& f)
+{
+    f.name = rand() % 4;
+    f.is_64bit = rand() & 1;
+    f.address = ((uint64_t)random32() << 32) | random32();
+    f.has_target = rand() & 1;
+    f.target_bdf = random32() & 0xFFFF;
+    f.target_bar = rand() % 6;
+    f.data_phases = rand() % 20;
+    f.is_64bit_data = rand() & 1;
+    f.data = random32();
+    f.data_hi = random32();
+    f.byte_enables = rand() & 0xF;
+    f.config = rand() % 3;
+    f.bus = random32() & 0xFF;
+    f.device = (int)(random32() % 22) - 1;
+    f.function = rand() & 7;
+    f.reg = random32() & 0xFC;
+    f.burst = rand() & 1;
+    f.parity = rand() % 3;
+    f.parity_phase = rand() % 17;
+    f.perr = rand() & 1;
+}
+
+/*********************************************************
+        snprintf rows
+*********************************************************/
+// snprintf that always terminates, as C99 does and VC6's _snprintf does not
+static void format(char *buffer, size_t size, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+#if defined(_MSC_VER) && _MSC_VER < 1900
+    int length = _vsnprintf(buffer, size, fmt, ap);
+#else
+    int length = vsnprintf(buffer, size, fmt, ap);
+#endif
+    va_end(ap);
+    if (length < 0 || (size_t)length >= size)
+    {
+        buffer[size - 1] = '\0';
+    }
+}
+
+static void isa_row_snprintf(char *buffer, size_t size, const TISAFields& f)
+{
+    char addr_str[20];
+    switch (f.addr_width)
+    {
+        case 1: format(addr_str, sizeof(addr_str), "0x%05X", f.address & 0xFFFFF); break;
+        case 2: format(addr_str, sizeof(addr_str), "0x%06X", f.address & 0xFFFFFF); break;
+        default: format(addr_str, sizeof(addr_str), "0x%04X", f.address & 0xFFFF); break;
+    }
+    format(buffer, size, f.is_16bit ? "%s | Addr: %s | Data: 0x%04X | Wait: %d" :
+                                      "%s | Addr: %s | Data: 0x%02X | Wait: %d",
+           isa_names[f.name], addr_str, f.data, f.wait_states);
+}
+
+static void pci_row_snprintf(char *buffer, size_t size, const TPCIFields& f)
+{
+    char addr_str[32];
+    char target_str[24] = "";
+    char data_str[64] = "";
+    char be_str[16] = "";
+    char detail_str[128] = "";
+    char err_str[32] = "";
+
+    if (f.is_64bit)
+        format(addr_str, sizeof(addr_str), "0x%08X%08X", (uint32_t)(f.address >> 32), (uint32_t)f.address);
+    else
+        format(addr_str, sizeof(addr_str), "0x%08X", (uint32_t)f.address);
+    if (f.has_target)
+        format(target_str, sizeof(target_str), "->%02X:%02X.%X BAR%d",
+               f.target_bdf >> 8, (f.target_bdf >> 3) & 0x1F, f.target_bdf & 0x7, f.target_bar);
+    if (f.data_phases > 0 && f.is_64bit_data)
+        format(data_str, sizeof(data_str), "Data:0x%08X%08X", f.data_hi, f.data);
+    else if (f.data_phases > 0)
+        format(data_str, sizeof(data_str), "Data:0x%08X", f.data);
+    if (f.data_phases > 0)
+        format(be_str, sizeof(be_str), "BE:0x%X", f.byte_enables);
+
+    if (f.config == 2)
+        format(detail_str, sizeof(detail_str), "Bus:%d Dev:%d Func:%d Reg:0x%02X Type1",
+               f.bus, f.device & 0x1F, f.function, f.reg);
+    else if (f.config == 1 && f.device >= 0)
+        format(detail_str, sizeof(detail_str), "IDSEL:AD%d Func:%d Reg:0x%02X Type0",
+               f.device + 11, f.function, f.reg);
+    else if (f.config == 1)
+        format(detail_str, sizeof(detail_str), "IDSEL:- Func:%d Reg:0x%02X Type0", f.function, f.reg);
+    else if (f.data_phases > 1)
+        format(detail_str, sizeof(detail_str), "Burst:%s Phases:%d", pci_bursts[f.burst], f.data_phases);
+
+    if (f.parity == 1)
+        format(err_str, sizeof(err_str), "PAR!:D%d%s", f.parity_phase, f.perr ? " PERR#" : "");
+    else if (f.parity == 2)
+        format(err_str, sizeof(err_str), "PERR#");
+
+    format(buffer, size, "%s %s %s %s %s %s %s",
+           pci_names[f.name], addr_str, target_str, data_str, be_str, detail_str, err_str);
+}
+
+/*********************************************************
+        TTextOut rows
+*********************************************************/
+static void isa_row_text(char *buffer, size_t size, const TISAFields& f)
+{
+    TTextOut text(buffer, size);
+    text.put(isa_names[f.name]).put(" | Addr: 0x");
+    switch (f.addr_width)
+    {
+        case 1: text.hex(f.address & 0xFFFFF, 5); break;
+        case 2: text.hex(f.address & 0xFFFFFF, 6); break;
+        default: text.hex(f.address & 0xFFFF, 4); break;
+    }
+    text.put(" | Data: 0x").hex(f.data, f.is_16bit ? 4 : 2);
+    text.put(" | Wait: ").dec(f.wait_states);
+}
+
+static void pci_row_text(char *buffer, size_t size, const TPCIFields& f)
+{
+    TTextOut text(buffer, size);
+    text.put(pci_names[f.name]).put(" 0x");
+    if (f.is_64bit)
+        text.hex((uint32_t)(f.address >> 32), 8);
+    text.hex((uint32_t)f.address, 8).put(' ');
+    if (f.has_target)
+    {
+        text.put("->").hex(f.target_bdf >> 8, 2).put(':');
+        text.hex((f.target_bdf >> 3) & 0x1F, 2).put('.').hex(f.target_bdf & 0x7, 1);
+        text.put(" BAR").dec(f.target_bar);
+    }
+    text.put(' ');
+    if (f.data_phases > 0)
+    {
+        text.put("Data:0x");
+        if (f.is_64bit_data)
+            text.hex(f.data_hi, 8);
+        text.hex(f.data, 8);
+    }
+    text.put(' ');
+    if (f.data_phases > 0)
+        text.put("BE:0x").hex(f.byte_enables, 1);
+    text.put(' ');
+
+    if (f.config != 0)
+    {
+        if (f.config == 2)
+            text.put("Bus:").dec(f.bus).put(" Dev:").dec(f.device & 0x1F);
+        else if (f.device >= 0)
+            text.put("IDSEL:AD").dec(f.device + 11);
+        else
+            text.put("IDSEL:-");
+        text.put(" Func:").dec(f.function).put(" Reg:0x").hex(f.reg, 2);
+        text.put(f.config == 2 ? " Type1" : " Type0");
+    }
+    else if (f.data_phases > 1)
+    {
+        text.put("Burst:").put(pci_bursts[f.burst]).put(" Phases:").dec(f.data_phases);
+    }
+    text.put(' ');
+
+    if (f.parity == 1)
+    {
+        text.put("PAR!:").put('D').dec(f.parity_phase);
+        if (f.perr)
+            text.put(" PERR#");
+    }
+    else if (f.parity == 2)
+    {
+        text.put("PERR#");
+    }
+}
+
+/*********************************************************
+        Check and timing
+*********************************************************/
+static double now_seconds()
+{
+#ifdef _WIN32
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+// Both rows into buffers of the given size; the bytes past the terminator
+// are compared too, so neither side may write beyond it
+static bool same_row(void (*reference)(char *, size_t, const void *),
+                     void (*writer)(char *, size_t, const void *), const void *fields, size_t size)
+{
+    char expected[TEXTBENCH_MAX_TEXT];
+    char actual[TEXTBENCH_MAX_TEXT];
+    memset(expected, 0x55, sizeof(expected));
+    memset(actual, 0x55, sizeof(actual));
+    reference(expected, size, fields);
+    writer(actual, size, fields);
+    if (memcmp(expected, actual, sizeof(expected)) == 0)
+    {
+        return true;
+    }
+    expected[sizeof(expected) - 1] = '\0';
+    actual[sizeof(actual) - 1] = '\0';
+    printf("Rows differ with a %u byte buffer:\n  snprintf: \"%s\"\n  TTextOut: \"%s\"\n",
+           (unsigned)size, expected, actual);
+    return false;
+}
+
+static void isa_snprintf(char *buffer, size_t size, const void *f) { isa_row_snprintf(buffer, size, *(const TISAFields *)f); }
+static void isa_text(char *buffer, size_t size, const void *f) { isa_row_text(buffer, size, *(const TISAFields *)f); }
+static void pci_snprintf(char *buffer, size_t size, const void *f) { pci_row_snprintf(buffer, size, *(const TPCIFields *)f); }
+static void pci_text(char *buffer, size_t size, const void *f) { pci_row_text(buffer, size, *(const TPCIFields *)f); }
+
+// Nanoseconds per row
+static double time_rows(void (*row)(char *, size_t, const void *), const void *fields, size_t field_size, int rows)
+{
+    char buffer[TEXTBENCH_MAX_TEXT];
+    unsigned sink = 0;
+    double start = now_seconds();
+    for (int i = 0; i < rows; i++)
+    {
+        row(buffer, sizeof(buffer), (const char *)fields + (i % TEXTBENCH_FIELDS) * field_size);
+        sink += (unsigned char)buffer[i % 32];
+    }
+    double elapsed = now_seconds() - start;
+    if (sink == 1)
+    {
+        printf("\n");           // Keeps the rows from being optimized away
+    }
+    return elapsed * 1e9 / rows;
+}
+
+int main(int argc, char *argv[])
+{
+    int rows = argc > 1 ? atoi(argv[1]) : TEXTBENCH_ROWS;
+    if (rows <= 0)
+    {
+        printf("Usage: TextBench [rows]\n");
+        return 2;
+    }
+
+    srand(1);
+    int mismatches = 0;
+    for (int i = 0; i < rows && mismatches < 10; i++)
+    {
+        size_t size = 1 + i % TEXTBENCH_MAX_TEXT;
+        TISAFields isa;
+        TPCIFields pci;
+        random_isa(isa);
+        random_pci(pci);
+        if (!same_row(isa_snprintf, isa_text, &isa, size))
+            mismatches++;
+        if (!same_row(pci_snprintf, pci_text, &pci, size))
+            mismatches++;
+    }
+    printf("%d ISA and %d PCI rows compared, %d differed\n", rows, rows, mismatches);
+
+    static TISAFields isa_fields[TEXTBENCH_FIELDS];
+    static TPCIFields pci_fields[TEXTBENCH_FIELDS];
+    for (int i = 0; i < TEXTBENCH_FIELDS; i++)
+    {
+        random_isa(isa_fields[i]);
+        random_pci(pci_fields[i]);
+    }
+    double isa_reference = time_rows(isa_snprintf, isa_fields, sizeof(TISAFields), rows);
+    double isa_writer = time_rows(isa_text, isa_fields, sizeof(TISAFields), rows);
+    double pci_reference = time_rows(pci_snprintf, pci_fields, sizeof(TPCIFields), rows);
+    double pci_writer = time_rows(pci_text, pci_fields, sizeof(TPCIFields), rows);
+    printf("ISA row: snprintf %.0f ns, TTextOut %.0f ns\n", isa_reference, isa_writer);
+    printf("PCI row: snprintf %.0f ns, TTextOut %.0f ns\n", pci_reference, pci_writer);
+    return mismatches != 0 ? 1 : 0;
+}
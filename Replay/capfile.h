@@ -0,0 +1,366 @@
+// capfile.h - Offline capture file shared by the replay host and the importers
+#pragma once
+
+#ifndef CAPFILE_H
+#define CAPFILE_H
+
+#include "stdint.h"
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// File layout, all fields little-endian:
+//   TCaptureHeader
+//   TCaptureGroup[group_count]      Named like the groups in ISA.tla/PCI.tla
+//   column per group                One value per sequence, sample_bytes wide
+//   timestamp column (optional)     int64_t picoseconds per sequence
+// Every column starts on a CAPFILE_ALIGN boundary, so a group's values are
+// one contiguous array the host reads straight out of the mapping.
+#define CAPFILE_MAGIC           0x50434C54UL    // "TLCP"
+#define CAPFILE_VERSION         1
+#define CAPFILE_NAME_LEN        16
+#define CAPFILE_MAX_GROUPS      16
+#define CAPFILE_ALIGN           64
+
+// Header flags
+#define CAPFILE_HAS_TRIGGER     0x01            // trigger_seq is valid
+#define CAPFILE_HAS_TIMESTAMPS  0x02            // Timestamp column present
+
+typedef struct TCaptureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t first_seq;              // Sequence range held by the columns
+    int32_t last_seq;
+    int32_t trigger_seq;
+    uint32_t flags;
+    uint32_t group_count;
+    uint32_t reserved;
+    uint64_t timestamp_offset;      // File offset of the timestamp column
+} TCaptureHeader;
+
+typedef struct TCaptureGroup
+{
+    char name[CAPFILE_NAME_LEN];    // Group name, NUL padded
+    uint32_t width;                 // Signals in the group
+    uint32_t sample_bytes;          // 1, 2 or 4
+    uint64_t offset;                // File offset of the column
+} TCaptureGroup;
+
+/*********************************************************
+        Capture file
+*********************************************************/
+// A capture mapped into memory as a whole. open() maps an existing file
+// read-only, create() lays out a new one of a fixed sequence range and maps
+// it writable so an importer can fill the columns in any order.
+class TCaptureFile
+{
+public:
+    TCaptureFile() : base(NULL), length(0)
+    {
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#else
+        fd = -1;
+#endif
+        error_text = "";
+    }
+    ~TCaptureFile() { close(); }
+
+    bool open(const char *path)
+    {
+        close();
+        if (!map_file(path, 0, false))
+        {
+            return false;
+        }
+        if (length < sizeof(TCaptureHeader) || header().magic != CAPFILE_MAGIC)
+        {
+            return fail("Not a capture file");
+        }
+        if (header().version != CAPFILE_VERSION)
+        {
+            return fail("Unsupported capture file version");
+        }
+        if (header().group_count > CAPFILE_MAX_GROUPS || header().last_seq < header().first_seq ||
+            sizeof(TCaptureHeader) + header().group_count * sizeof(TCaptureGroup) > length)
+        {
+            return fail("Corrupt capture header");
+        }
+        for (int i = 0; i < group_count(); i++)
+        {
+            const TCaptureGroup& g = group(i);
+            if ((g.sample_bytes != 1 && g.sample_bytes != 2 && g.sample_bytes != 4) ||
+                g.offset + (uint64_t)samples() * g.sample_bytes > length)
+            {
+                return fail("Corrupt capture column");
+            }
+        }
+        if ((header().flags & CAPFILE_HAS_TIMESTAMPS) &&
+            header().timestamp_offset + (uint64_t)samples() * sizeof(int64_t) > length)
+        {
+            return fail("Corrupt timestamp column");
+        }
+        return true;
+    }
+
+    // Lay out a new capture. The group offsets and sample_bytes are filled
+    // in from the widths; all values start out zero.
+    bool create(const char *path, int first_seq, int last_seq, const TCaptureGroup *groups,
+                int count, bool timestamps)
+    {
+        close();
+        if (count > CAPFILE_MAX_GROUPS || last_seq < first_seq)
+        {
+            return fail("Invalid capture layout");
+        }
+
+        TCaptureHeader head;
+        TCaptureGroup table[CAPFILE_MAX_GROUPS];
+        memset(&head, 0, sizeof(head));
+        head.magic = CAPFILE_MAGIC;
+        head.version = CAPFILE_VERSION;
+        head.first_seq = first_seq;
+        head.last_seq = last_seq;
+        head.group_count = count;
+
+        uint64_t n = (uint64_t)last_seq - first_seq + 1;
+        uint64_t offset = align(sizeof(head) + count * sizeof(TCaptureGroup));
+        for (int i = 0; i < count; i++)
+        {
+            table[i] = groups[i];
+            table[i].sample_bytes = table[i].width <= 8 ? 1 : (table[i].width <= 16 ? 2 : 4);
+            table[i].offset = offset;
+            offset = align(offset + n * table[i].sample_bytes);
+        }
+        if (timestamps)
+        {
+            head.flags |= CAPFILE_HAS_TIMESTAMPS;
+            head.timestamp_offset = offset;
+            offset += n * sizeof(int64_t);
+        }
+
+        if (!map_file(path, offset, true))
+        {
+            return false;
+        }
+        memcpy(base, &head, sizeof(head));
+        memcpy(base + sizeof(head), table, count * sizeof(TCaptureGroup));
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (base != NULL)
+            UnmapViewOfFile(base);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#else
+        if (base != NULL)
+            munmap(base, (size_t)length);
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+#endif
+        base = NULL;
+        length = 0;
+    }
+
+    bool is_open() const { return base != NULL; }
+    const char *error() const { return error_text; }
+
+    const TCaptureHeader& header() const { return *(const TCaptureHeader *)base; }
+    int first_seq() const { return header().first_seq; }
+    int last_seq() const { return header().last_seq; }
+    int samples() const { return header().last_seq - header().first_seq + 1; }
+    int group_count() const { return (int)header().group_count; }
+    const TCaptureGroup& group(int index) const
+    {
+        return ((const TCaptureGroup *)(base + sizeof(TCaptureHeader)))[index];
+    }
+
+    // Column index of a group by name, -1 if the capture lacks it
+    int find_group(const char *name) const
+    {
+        for (int i = 0; i < group_count(); i++)
+        {
+            if (strncmp(group(i).name, name, CAPFILE_NAME_LEN) == 0)
+                return i;
+        }
+        return -1;
+    }
+
+    // Value of a group at a sequence, 0 outside the captured range
+    uint32_t value(int seq, int index) const
+    {
+        if (seq < header().first_seq || seq > header().last_seq)
+        {
+            return 0;
+        }
+        const TCaptureGroup& g = group(index);
+        const uint8_t *column = base + (size_t)g.offset;
+        size_t i = (size_t)(seq - header().first_seq);
+        switch (g.sample_bytes)
+        {
+            case 1:
+                return column[i];
+            case 2:
+                return ((const uint16_t *)column)[i];
+            default:
+                return ((const uint32_t *)column)[i];
+        }
+    }
+
+    bool has_timestamps() const { return (header().flags & CAPFILE_HAS_TIMESTAMPS) != 0; }
+    int64_t timestamp(int seq) const
+    {
+        if (!has_timestamps() || seq < header().first_seq || seq > header().last_seq)
+        {
+            return 0;
+        }
+        return ((const int64_t *)(base + (size_t)header().timestamp_offset))[seq - header().first_seq];
+    }
+
+    bool has_trigger() const { return (header().flags & CAPFILE_HAS_TRIGGER) != 0; }
+    int trigger_seq() const { return header().trigger_seq; }
+
+    /* Writing, only on a capture made by create() */
+    void set_value(int seq, int index, uint32_t value)
+    {
+        const TCaptureGroup& g = group(index);
+        uint8_t *column = base + (size_t)g.offset;
+        size_t i = (size_t)(seq - header().first_seq);
+        switch (g.sample_bytes)
+        {
+            case 1:
+                column[i] = (uint8_t)value;
+                break;
+            case 2:
+                ((uint16_t *)column)[i] = (uint16_t)value;
+                break;
+            default:
+                ((uint32_t *)column)[i] = value;
+                break;
+        }
+    }
+
+    void set_timestamp(int seq, int64_t ps)
+    {
+        ((int64_t *)(base + (size_t)header().timestamp_offset))[seq - header().first_seq] = ps;
+    }
+
+    void set_trigger(int seq)
+    {
+        TCaptureHeader *head = (TCaptureHeader *)base;
+        head->trigger_seq = seq;
+        head->flags |= CAPFILE_HAS_TRIGGER;
+    }
+
+private:
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + CAPFILE_ALIGN - 1) & ~(uint64_t)(CAPFILE_ALIGN - 1);
+    }
+
+    bool fail(const char *text)
+    {
+        close();
+        error_text = text;
+        return false;
+    }
+
+    // Map the whole file; a size creates (or truncates) it to that length
+    bool map_file(const char *path, uint64_t size, bool write)
+    {
+        error_text = "";
+#ifdef _WIN32
+        file = CreateFile(path, write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ,
+                          NULL, write ? CREATE_ALWAYS : OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return fail("Cannot open capture file");
+        }
+        if (!write)
+        {
+            DWORD high = 0;
+            DWORD low = GetFileSize(file, &high);
+            size = (uint64_t)high << 32 | low;
+        }
+        if (size == 0 || (size_t)size != size)
+        {
+            return fail("Capture file size not supported");
+        }
+        mapping = CreateFileMapping(file, NULL, write ? PAGE_READWRITE : PAGE_READONLY,
+                                    (DWORD)(size >> 32), (DWORD)size, NULL);
+        if (mapping == NULL)
+        {
+            return fail("Cannot map capture file");
+        }
+        base = (uint8_t *)MapViewOfFile(mapping, write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+#else
+        fd = ::open(path, write ? O_RDWR | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+        if (fd < 0)
+        {
+            return fail("Cannot open capture file");
+        }
+        if (write)
+        {
+            if (ftruncate(fd, (off_t)size) != 0)
+            {
+                return fail("Cannot size capture file");
+            }
+        }
+        else
+        {
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+            {
+                return fail("Cannot open capture file");
+            }
+            size = (uint64_t)st.st_size;
+        }
+        if (size == 0 || (size_t)size != size)
+        {
+            return fail("Capture file size not supported");
+        }
+        void *view = mmap(NULL, (size_t)size, write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        base = (view == MAP_FAILED) ? NULL : (uint8_t *)view;
+        if (base != NULL && !write)
+        {
+            // Replay walks the columns front to back
+            madvise(base, (size_t)size, MADV_SEQUENTIAL);
+        }
+#endif
+        if (base == NULL)
+        {
+            return fail("Cannot map capture file");
+        }
+        length = size;
+        return true;
+    }
+
+    uint8_t *base;              // Start of the mapped file
+    uint64_t length;            // Bytes mapped
+    const char *error_text;     // Reason the last open/create failed
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
+#endif // CAPFILE_H
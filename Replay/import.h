@@ -0,0 +1,60 @@
+// import.h - VCD and sigrok trace import into capture files
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include "stdint.h"
+#include <stddef.h>
+
+/*********************************************************
+        Defines
+*********************************************************/
+#define IMPORT_MAX_RENAMES  64      // -map arguments accepted
+#define IMPORT_ERROR_LEN    256
+
+/*********************************************************
+        Package layouts
+*********************************************************/
+// Where a trace signal lands in the package groups: bits [first, first +
+// count) of the named signal go to group bits bit and up. Scalar signals
+// are bit 0 of their name; "SA5", "SA[5]" and a bus SA[19:0] all feed SA.
+typedef struct TLayoutSignal
+{
+    const char *name;
+    int group;
+    int first;
+    int count;
+    int bit;
+    int clock;                      // Edges sample the other signals
+} TLayoutSignal;
+
+typedef struct TLayoutGroup
+{
+    const char *name;               // As in the package's .tla file
+    int width;
+    uint32_t idle;                  // Value of signals the trace lacks
+} TLayoutGroup;
+
+typedef struct TTraceLayout
+{
+    const char *name;               // Package the layout belongs to
+    const TLayoutGroup *groups;
+    int group_count;
+    const TLayoutSignal *signals;
+    int signal_count;
+} TTraceLayout;
+
+// Layout by package name, NULL if unknown
+const TTraceLayout *FindLayout(const char *name);
+
+// Largest layout whose groups the decoder all has, NULL if none fits
+const TTraceLayout *MatchLayout(const char *const *group_names, int count);
+
+// Trace file types the importer reads, judged by the file name
+bool IsTraceFile(const char *path);
+
+// Convert a VCD or sigrok trace into a capture file. renames are
+// "TRACE=SIGNAL" pairs naming trace signals the layout does not know.
+bool ImportTrace(const char *trace, const char *capture, const TTraceLayout *layout,
+                 const char *const *renames, int rename_count, char *error, size_t error_size);
+
+#endif // IMPORT_H